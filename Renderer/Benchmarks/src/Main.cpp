@@ -0,0 +1,621 @@
+
+// Micro-benchmarks for the renderer's CPU hot paths -- No window, device, or GPU is created
+//
+//   Benchmarks [--res <directory>] [--filter <substring>] [--reps <count>] [--warmup <count>]
+//
+// Builds with the Benchmarks project, or on Linux from Renderer/Benchmarks:
+//   g++ -std=c++17 -O2 -I../Skeleton/src -I../Libraries/Include src/Main.cpp -o benchmarks -lpthread
+
+#define SDL_MAIN_HANDLED
+
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "Common.h"
+#include "Mesh.h"
+#include "FileLoader.h"
+#include "Object.h"
+#include "Shaders.h"
+#include "SoftwareOcclusion.h"
+#include "JobSystem.h"
+
+#include "MicroBenchmark.h"
+
+namespace fs = std::filesystem;
+
+// Every file under _directory with the extension, sorted so runs list benchmarks in the same order
+static std::vector<std::string> FindFiles(const std::string& _directory, const char* _extension)
+{
+	std::vector<std::string> files;
+	if (!fs::exists(_directory))
+		return files;
+
+	for (const auto& entry : fs::recursive_directory_iterator(_directory))
+		if (entry.is_regular_file() && entry.path().extension() == _extension)
+			files.push_back(entry.path().generic_string());
+
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+static std::string RelativeName(const std::string& _path, const std::string& _root)
+{
+	return fs::relative(_path, _root).generic_string();
+}
+
+// OBJ parse & vertex deduplication -- The CPU half of LoadMesh
+static void BenchmarkMeshParsing(skel::bench::Runner& _runner, const std::string& _res)
+{
+	std::string root = _res + "models";
+	for (const auto& file : FindFiles(root, ".obj"))
+	{
+		_runner.Run("obj_parse/" + RelativeName(file, root), 1, [&]() {
+			Mesh* mesh = ParseMesh(file.c_str());
+			skel::bench::DoNotOptimize(mesh->indices.size());
+			delete mesh;
+		});
+	}
+}
+
+// std::hash<Vertex> and the deduplication map, fed every index of the largest model
+static void BenchmarkVertexHash(skel::bench::Runner& _runner, const std::string& _res)
+{
+	std::vector<std::string> files = FindFiles(_res + "models", ".obj");
+	if (files.empty())
+		return;
+
+	// The undeduplicated vertex stream, as tinyobj hands it to LoadMesh
+	std::vector<Vertex> stream;
+	for (const auto& file : files)
+	{
+		Mesh* mesh = ParseMesh(file.c_str());
+		if (mesh->indices.size() > stream.size())
+		{
+			stream.clear();
+			for (const auto& index : mesh->indices)
+				stream.push_back(mesh->vertices[index]);
+		}
+		delete mesh;
+	}
+
+	_runner.Run("vertex_hash/hash", stream.size(), [&]() {
+		size_t combined = 0;
+		for (const auto& vertex : stream)
+			combined ^= std::hash<Vertex>()(vertex);
+		skel::bench::DoNotOptimize(combined);
+	});
+
+	_runner.Run("vertex_hash/dedup_map", stream.size(), [&]() {
+		std::unordered_map<Vertex, uint32_t> unique;
+		for (const auto& vertex : stream)
+			if (unique.count(vertex) == 0)
+				unique[vertex] = static_cast<uint32_t>(unique.size());
+		skel::bench::DoNotOptimize(unique.size());
+	});
+}
+
+// PNG decode -- The CPU half of LoadTextureToImage
+static void BenchmarkTextureDecode(skel::bench::Runner& _runner, const std::string& _res)
+{
+	std::string root = _res + "textures";
+	for (const auto& file : FindFiles(root, ".png"))
+	{
+		_runner.Run("png_decode/" + RelativeName(file, root), 1, [&]() {
+			int width, height, channels;
+			stbi_uc* pixels = stbi_load(file.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+			skel::bench::DoNotOptimize(pixels);
+			stbi_image_free(pixels);
+		});
+	}
+}
+
+static const char* PathName(skel::simd::Path _path)
+{
+	switch (_path)
+	{
+	case skel::simd::Path::Scalar:	return "scalar";
+	case skel::simd::Path::Vector4:	return "vec4";
+	default:						return "avx2";
+	}
+}
+
+// Position, rotation, & scale -> model matrix, then model -> model-view-projection
+// glm_euler is the per-object build the batch kernels replaced -- Euler angles converted every frame
+static void BenchmarkModelMatrices(skel::bench::Runner& _runner)
+{
+	const uint32_t counts[] = { 1000, 10000, 100000, 1000000 };
+
+	std::vector<skel::simd::Path> paths = { skel::simd::Path::Scalar, skel::simd::Path::Vector4 };
+	if (skel::simd::BestPath() == skel::simd::Path::Avx2)
+		paths.push_back(skel::simd::Path::Avx2);
+
+	// Fixed seed -- Every run transforms the same values
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+	std::uniform_real_distribution<float> scale(0.1f, 4.0f);
+
+	glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f)
+		* glm::lookAt(glm::vec3(0.0f, 0.0f, 6.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	for (const auto& count : counts)
+	{
+		std::vector<glm::vec3> positions(count);
+		std::vector<glm::vec3> eulers(count);
+		std::vector<glm::quat> rotations(count);
+		std::vector<glm::vec3> scales(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			positions[i] = { position(random), position(random), position(random) };
+			eulers[i] = { angle(random), angle(random), angle(random) };
+			rotations[i] = glm::quat(glm::radians(eulers[i]));
+			scales[i] = { scale(random), scale(random), scale(random) };
+		}
+		std::vector<glm::mat4> matrices(count);
+		std::vector<skel::ObjectData> objects(count);
+
+		_runner.Run("model_matrix/glm_euler/" + std::to_string(count), count, [&]() {
+			for (uint32_t i = 0; i < count; i++)
+			{
+				glm::mat4 model = glm::translate(glm::mat4(1.0f), positions[i]);
+				model *= glm::mat4_cast(glm::quat(glm::radians(eulers[i])));
+				matrices[i] = glm::scale(model, scales[i]);
+			}
+			skel::bench::DoNotOptimize(matrices[count - 1]);
+		});
+
+		for (const auto& path : paths)
+		{
+			_runner.Run("model_matrix/" + std::string(PathName(path)) + "/" + std::to_string(count), count, [&]() {
+				skel::simd::ComposeModelMatrices(positions.data(), rotations.data(), scales.data(), count, matrices.data(), path);
+				skel::bench::DoNotOptimize(matrices[count - 1]);
+			});
+		}
+
+		// Written with the object buffer's stride, as the renderer does
+		for (const auto& path : paths)
+		{
+			_runner.Run("model_view_projection/" + std::string(PathName(path)) + "/" + std::to_string(count), count, [&]() {
+				skel::simd::MultiplyMatrices(viewProjection, matrices.data(), count, &objects[0].modelViewProjection, sizeof(skel::ObjectData), path);
+				skel::bench::DoNotOptimize(objects[count - 1]);
+			});
+		}
+	}
+}
+
+// Job system overhead -- Empty jobs queued and waited on, then a parallel-for over cheap items
+static void BenchmarkJobs(skel::bench::Runner& _runner)
+{
+	const uint32_t counts[] = { 1000, 100000, 1000000 };
+	skel::jobs::GetScheduler();
+
+	_runner.Run("jobs_run_wait/1000", 1000, [&]() {
+		std::atomic<uint32_t> done(0);
+		skel::jobs::Counter counter;
+		for (uint32_t i = 0; i < 1000; i++)
+			skel::jobs::Run([&]() { done.fetch_add(1, std::memory_order_relaxed); }, &counter);
+		skel::jobs::Wait(counter);
+		skel::bench::DoNotOptimize(done);
+	});
+
+	for (const auto& count : counts)
+	{
+		std::vector<float> values(count, 1.0f);
+		_runner.Run("jobs_parallel_for/" + std::to_string(count), count, [&]() {
+			skel::jobs::ParallelFor(count, [&](uint32_t _i) { values[_i] = values[_i] * 0.5f + 1.0f; }, 256);
+			skel::bench::DoNotOptimize(values[0]);
+		});
+	}
+}
+
+// The same transforms stored as entities -- UpdateModelMatrices over chunks, then the renderer's draw query
+static void BenchmarkEcs(skel::bench::Runner& _runner)
+{
+	const uint32_t counts[] = { 1000, 10000, 100000, 1000000 };
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+
+	for (const auto& count : counts)
+	{
+		skel::ecs::World world;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			skel::Position entityPosition;
+			entityPosition.value = { position(random), position(random), position(random) };
+			world.Create(entityPosition, skel::Rotation(), skel::Scale(), skel::LocalToWorld(), skel::MeshRef(), skel::Material(), skel::Bounds(), skel::Visibility());
+		}
+
+		_runner.Run("ecs_model_matrices/" + std::to_string(count), count, [&]() {
+			skel::UpdateModelMatrices(world);
+		});
+
+		_runner.Run("ecs_draw_query/" + std::to_string(count), count, [&]() {
+			float sum = 0.0f;
+			world.Each<skel::LocalToWorld, skel::Material, skel::Visibility>([&](skel::LocalToWorld& _matrix, skel::Material& _material, skel::Visibility& _visibility) {
+				if (_visibility.visible && _material.shaderType == 0)
+					sum += _matrix.model[3][0];
+			});
+			skel::bench::DoNotOptimize(sum);
+		});
+	}
+}
+
+// Scene::Update with groups of 16 -- A root and 15 children
+// static is a frame where nothing moved, 1pct moves every 100th entity, all moves every root
+static void BenchmarkTransformHierarchy(skel::bench::Runner& _runner)
+{
+	const uint32_t counts[] = { 1000, 10000, 100000, 1000000 };
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+
+	for (const auto& count : counts)
+	{
+		skel::Scene scene;
+		std::vector<skel::ecs::Entity> entities(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			skel::Position entityPosition;
+			entityPosition.value = { position(random), position(random), position(random) };
+			entities[i] = scene.world.Create(entityPosition, skel::Rotation(), skel::Scale(), skel::LocalToWorld());
+			scene.transforms.Add(entities[i], i % 16 ? entities[i - i % 16] : skel::ecs::Entity());
+		}
+		scene.Update();
+		scene.changedEntities.clear();
+
+		_runner.Run("transform_hierarchy/static/" + std::to_string(count), count, [&]() {
+			skel::bench::DoNotOptimize(scene.Update());
+		});
+
+		_runner.Run("transform_hierarchy/1pct/" + std::to_string(count), count, [&]() {
+			for (uint32_t i = 0; i < count; i += 100)
+				scene.transforms.MarkDirty(entities[i]);
+			skel::bench::DoNotOptimize(scene.Update());
+			scene.changedEntities.clear();
+		});
+
+		_runner.Run("transform_hierarchy/all/" + std::to_string(count), count, [&]() {
+			for (uint32_t i = 0; i < count; i += 16)
+				scene.transforms.MarkDirty(entities[i]);
+			skel::bench::DoNotOptimize(scene.Update());
+			scene.changedEntities.clear();
+		});
+	}
+}
+
+// BaseShader::GetDescriptorWriteSets for a few binding counts -- Handles are never dereferenced
+// World bounds against the camera's frustum -- Scattered so only a few percent are in view
+static void BenchmarkFrustumCulling(skel::bench::Runner& _runner)
+{
+	const uint32_t counts[] = { 1000, 10000, 100000, 1000000 };
+
+	std::vector<skel::simd::Path> paths = { skel::simd::Path::Scalar, skel::simd::Path::Vector4 };
+	if (skel::simd::BestPath() == skel::simd::Path::Avx2)
+		paths.push_back(skel::simd::Path::Avx2);
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.1f, 4.0f);
+
+	skel::Frustum frustum = skel::Frustum::FromViewProjection(glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f)
+		* glm::lookAt(glm::vec3(0.0f, 0.0f, 6.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+	for (const auto& count : counts)
+	{
+		std::vector<skel::WorldBounds> bounds(count);
+		for (auto& b : bounds)
+		{
+			b.extents = glm::vec4(size(random), size(random), size(random), 0.0f);
+			b.sphere = glm::vec4(position(random), position(random), position(random), glm::length(glm::vec3(b.extents)));
+		}
+		std::vector<skel::Visibility> visibilities(count);
+
+		for (const auto& path : paths)
+		{
+			_runner.Run("frustum_cull/" + std::string(PathName(path)) + "/" + std::to_string(count), count, [&]() {
+				uint32_t visible = skel::simd::CullBounds(frustum, bounds.data(), count, visibilities.data(), path);
+				skel::bench::DoNotOptimize(visible);
+			});
+		}
+	}
+}
+
+// The same scattered bounds in a BVH -- Build, then frustum culling & ray casts against it and one by one
+static void BenchmarkBvh(skel::bench::Runner& _runner)
+{
+	const uint32_t counts[] = { 1000, 10000, 100000, 1000000 };
+	const uint32_t rayCount = 256;
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.1f, 4.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	skel::Frustum frustum = skel::Frustum::FromViewProjection(glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f)
+		* glm::lookAt(glm::vec3(0.0f, 0.0f, 6.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+	std::vector<glm::vec3> rayOrigins(rayCount), rayDirections(rayCount);
+	for (uint32_t i = 0; i < rayCount; i++)
+	{
+		rayOrigins[i] = { position(random), position(random), position(random) };
+		rayDirections[i] = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 0.01f));
+	}
+
+	for (const auto& count : counts)
+	{
+		std::vector<skel::WorldBounds> bounds(count);
+		std::vector<skel::ecs::Entity> entities(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			bounds[i].extents = glm::vec4(size(random), size(random), size(random), 0.0f);
+			bounds[i].sphere = glm::vec4(position(random), position(random), position(random), glm::length(glm::vec3(bounds[i].extents)));
+			entities[i].index = i;
+		}
+
+		skel::Bvh bvh;
+		_runner.Run("bvh_build/" + std::to_string(count), count, [&]() {
+			bvh.Build(bounds.data(), entities.data(), count);
+			skel::bench::DoNotOptimize(bvh.NodeCount());
+		});
+		// The queries still need it when the build is filtered out
+		if (bvh.Empty())
+			bvh.Build(bounds.data(), entities.data(), count);
+
+		std::vector<skel::ecs::Entity> visible;
+		visible.reserve(count);
+		_runner.Run("frustum_cull/bvh/" + std::to_string(count), count, [&]() {
+			visible.clear();
+			bvh.CullFrustum(frustum, visible);
+			skel::bench::DoNotOptimize(visible.size());
+		});
+
+		// Per ray -- The linear cast tests every box
+		if (count <= 100000)
+		{
+			_runner.Run("raycast/linear/" + std::to_string(count), rayCount, [&]() {
+				for (uint32_t r = 0; r < rayCount; r++)
+				{
+					glm::vec3 inverseDirection = skel::InverseRayDirection(rayDirections[r]);
+					float closest = FLT_MAX;
+					for (const auto& b : bounds)
+					{
+						glm::vec3 center = glm::vec3(b.sphere);
+						glm::vec3 extents = glm::vec3(b.extents);
+						closest = std::min(closest, skel::RayBoxDistance(rayOrigins[r], inverseDirection, center - extents, center + extents, closest));
+					}
+					skel::bench::DoNotOptimize(closest);
+				}
+			});
+		}
+		_runner.Run("raycast/bvh/" + std::to_string(count), rayCount, [&]() {
+			for (uint32_t r = 0; r < rayCount; r++)
+				skel::bench::DoNotOptimize(bvh.Raycast(rayOrigins[r], rayDirections[r]));
+		});
+	}
+}
+
+static void BenchmarkLooseOctree(skel::bench::Runner& _runner)
+{
+	const uint32_t counts[] = { 1000, 10000, 100000 };
+	const uint32_t rayCount = 256;
+	const uint32_t sphereCount = 64;
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.1f, 4.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	skel::Frustum frustum = skel::Frustum::FromViewProjection(glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f)
+		* glm::lookAt(glm::vec3(0.0f, 0.0f, 6.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+	std::vector<glm::vec3> rayOrigins(rayCount), rayDirections(rayCount);
+	for (uint32_t i = 0; i < rayCount; i++)
+	{
+		rayOrigins[i] = { position(random), position(random), position(random) };
+		rayDirections[i] = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 0.01f));
+	}
+
+	for (const auto& count : counts)
+	{
+		std::vector<skel::WorldBounds> bounds(count);
+		std::vector<skel::ecs::Entity> entities(count);
+		std::vector<glm::vec4> steps(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			bounds[i].extents = glm::vec4(size(random), size(random), size(random), 0.0f);
+			bounds[i].sphere = glm::vec4(position(random), position(random), position(random), glm::length(glm::vec3(bounds[i].extents)));
+			entities[i].index = i;
+			steps[i] = glm::vec4(unit(random), unit(random), unit(random), 0.0f) * 0.25f;
+		}
+
+		skel::LooseOctree octree(glm::vec3(0.0f), 128.0f);
+		_runner.Run("octree_insert_remove/" + std::to_string(count), count, [&]() {
+			for (uint32_t i = 0; i < count; i++)
+				octree.Insert(entities[i], bounds[i]);
+			for (uint32_t i = 0; i < count; i++)
+				octree.Remove(entities[i]);
+		});
+
+		// The queries need it filled either way
+		for (uint32_t i = 0; i < count; i++)
+			octree.Move(entities[i], bounds[i]);
+
+		// Every entity moves a little each frame, back & forth so they don't drift
+		float direction = 1.0f;
+		_runner.Run("octree_move/" + std::to_string(count), count, [&]() {
+			for (uint32_t i = 0; i < count; i++)
+			{
+				bounds[i].sphere += steps[i] * direction;
+				octree.Move(entities[i], bounds[i]);
+			}
+			direction = -direction;
+		});
+
+		std::vector<skel::ecs::Entity> found;
+		found.reserve(count);
+		_runner.Run("frustum_cull/octree/" + std::to_string(count), count, [&]() {
+			found.clear();
+			octree.CullFrustum(frustum, found);
+			skel::bench::DoNotOptimize(found.size());
+		});
+
+		_runner.Run("raycast/octree/" + std::to_string(count), rayCount, [&]() {
+			for (uint32_t r = 0; r < rayCount; r++)
+				skel::bench::DoNotOptimize(octree.Raycast(rayOrigins[r], rayDirections[r]));
+		});
+
+		// Per sphere -- Light sized, as in light assignment
+		_runner.Run("sphere_query/octree/" + std::to_string(count), sphereCount, [&]() {
+			for (uint32_t s = 0; s < sphereCount; s++)
+			{
+				found.clear();
+				octree.QuerySphere(rayOrigins[s], 10.0f, found);
+				skel::bench::DoNotOptimize(found.size());
+			}
+		});
+	}
+}
+
+// A grid of walls drawn into the CPU occlusion buffer, then scattered bounds tested against it
+static void BenchmarkSoftwareOcclusion(skel::bench::Runner& _runner)
+{
+	const uint32_t counts[] = { 1000, 10000, 100000 };
+
+	std::vector<skel::simd::Path> paths = { skel::simd::Path::Scalar };
+	if (skel::simd::BestPath() == skel::simd::Path::Avx2)
+		paths.push_back(skel::simd::Path::Avx2);
+
+	// 16 x 4 wall panels, two triangles each, across most of the view at z = -20
+	Mesh walls;
+	for (int y = 0; y < 4; y++)
+	{
+		for (int x = 0; x < 16; x++)
+		{
+			uint32_t first = static_cast<uint32_t>(walls.vertices.size());
+			for (int corner = 0; corner < 4; corner++)
+			{
+				Vertex vertex = {};
+				vertex.position = glm::vec3(-16.0f + (x + (corner & 1)) * 2.0f, -4.0f + (y + (corner >> 1)) * 2.0f, -20.0f);
+				walls.vertices.push_back(vertex);
+			}
+			uint32_t indices[] = { first, first + 1, first + 2, first + 2, first + 1, first + 3 };
+			walls.indices.insert(walls.indices.end(), indices, indices + 6);
+		}
+	}
+
+	glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 200.0f)
+		* glm::lookAt(glm::vec3(0.0f, 0.0f, 6.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> across(-40.0f, 40.0f);
+	std::uniform_real_distribution<float> depth(-150.0f, -10.0f);
+	std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+	for (const auto& path : paths)
+	{
+		skel::SoftwareOcclusion occlusion;
+		occlusion.path = path;
+
+		_runner.Run("software_occlusion/rasterize/" + std::string(PathName(path)), walls.indices.size() / 3, [&]() {
+			occlusion.Begin(viewProjection);
+			occlusion.AddOccluder(walls, glm::mat4(1.0f));
+			occlusion.Rasterize();
+			skel::bench::DoNotOptimize(occlusion.depth[0]);
+		});
+
+		for (const auto& count : counts)
+		{
+			std::vector<skel::WorldBounds> bounds(count);
+			for (auto& b : bounds)
+			{
+				b.extents = glm::vec4(size(random), size(random), size(random), 0.0f);
+				b.sphere = glm::vec4(across(random), across(random) * 0.25f, depth(random), glm::length(glm::vec3(b.extents)));
+			}
+
+			_runner.Run("software_occlusion/test/" + std::string(PathName(path)) + "/" + std::to_string(count), count, [&]() {
+				uint32_t occluded = 0;
+				for (const auto& b : bounds)
+					occluded += occlusion.IsOccluded(b) ? 1 : 0;
+				skel::bench::DoNotOptimize(occluded);
+			});
+		}
+	}
+}
+
+static void BenchmarkDescriptorWrites(skel::bench::Runner& _runner)
+{
+	const uint32_t layouts[][2] = { { 1, 0 }, { 1, 4 }, { 4, 8 } };
+
+	for (const auto& layout : layouts)
+	{
+		skel::BaseShader shader;
+		std::vector<BufferComponent> buffers(layout[0]);
+		std::vector<TextureComponent> textures(layout[1]);
+		for (auto& b : buffers)
+			shader.buffers.push_back(&b);
+		for (auto& t : textures)
+			shader.textures.push_back(&t);
+
+		std::vector<VkWriteDescriptorSet> writes;
+		std::vector<VkDescriptorBufferInfo> bufferInfos;
+		std::vector<VkDescriptorImageInfo> imageInfos;
+
+		_runner.Run("descriptor_writes/" + std::to_string(layout[0]) + "b" + std::to_string(layout[1]) + "t", 1, [&]() {
+			shader.GetDescriptorWriteSets(writes, bufferInfos, imageInfos);
+			skel::bench::DoNotOptimize(writes.data());
+		});
+
+		// Not owned by the shader
+		shader.buffers.clear();
+		shader.textures.clear();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string res = "../Skeleton/res/";
+	skel::bench::Settings settings;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string arg = argv[i];
+		if (arg == "--res")
+			res = std::string(argv[i + 1]) + "/";
+		else if (arg == "--filter")
+			settings.filter = argv[i + 1];
+		else if (arg == "--reps")
+			settings.repetitions = (uint32_t)std::stoul(argv[i + 1]);
+		else if (arg == "--warmup")
+			settings.warmupRepetitions = (uint32_t)std::stoul(argv[i + 1]);
+	}
+
+	try
+	{
+		skel::bench::Runner runner(settings);
+		runner.PrintHeader();
+
+		BenchmarkMeshParsing(runner, res);
+		BenchmarkVertexHash(runner, res);
+		BenchmarkTextureDecode(runner, res);
+		BenchmarkModelMatrices(runner);
+		BenchmarkJobs(runner);
+		BenchmarkEcs(runner);
+		BenchmarkTransformHierarchy(runner);
+		BenchmarkFrustumCulling(runner);
+		BenchmarkBvh(runner);
+		BenchmarkLooseOctree(runner);
+		BenchmarkSoftwareOcclusion(runner);
+		BenchmarkDescriptorWrites(runner);
+	}
+	catch (std::exception& e)
+	{
+		std::printf("%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace skel
+{
+namespace bench
+{
+	// Keeps the compiler from discarding a result that is otherwise unused
+	template<typename T>
+	inline void DoNotOptimize(const T& _value)
+	{
+		// A volatile read of the value can't be elided, so neither can what computed it
+		volatile char sink = *reinterpret_cast<const volatile char*>(&_value);
+		(void)sink;
+	}
+
+	struct Settings
+	{
+		uint32_t warmupRepetitions = 3;		// Run and discarded -- Fills caches and the allocator
+		uint32_t repetitions = 15;			// Timed runs
+		double minRepetitionMs = 5.0;		// Short runs are repeated in a batch until they take at least this long
+		std::string filter;					// Only benchmarks whose name contains this run
+	};
+
+	// Nanoseconds per operation across the timed repetitions
+	struct Result
+	{
+		std::string name;
+		uint64_t operations;	// Per repetition
+		uint32_t repetitions;
+		double median;
+		double mean;
+		double stddev;
+		double min;
+	};
+
+	class Runner
+	{
+	public:
+		explicit Runner(const Settings& _settings) : settings(_settings) {}
+
+		// _run performs _operations operations -- Called warmup + repetitions times (more for short runs)
+		template<typename F>
+		void Run(const std::string& _name, uint64_t _operations, F&& _run)
+		{
+			if (!settings.filter.empty() && _name.find(settings.filter) == std::string::npos)
+				return;
+
+			for (uint32_t i = 0; i < settings.warmupRepetitions; i++)
+				_run();
+
+			// Batch very short runs so the clock's resolution doesn't dominate
+			uint32_t batch = 1;
+			double once = TimeMs([&]() { _run(); });
+			if (once > 0.0 && once < settings.minRepetitionMs)
+				batch = static_cast<uint32_t>(std::ceil(settings.minRepetitionMs / once));
+
+			std::vector<double> samples;
+			for (uint32_t i = 0; i < settings.repetitions; i++)
+			{
+				double ms = TimeMs([&]() {
+					for (uint32_t b = 0; b < batch; b++)
+						_run();
+				});
+				samples.push_back(ms * 1000000.0 / (static_cast<double>(_operations) * batch));
+			}
+
+			results.push_back(Summarize(_name, _operations, samples));
+			Print(results.back());
+		}
+
+		void PrintHeader() const
+		{
+			std::printf("# warmup %u, repetitions %u, times in ns/op\n", settings.warmupRepetitions, settings.repetitions);
+			std::printf("%-56s %14s %14s %14s %8s %10s\n", "benchmark", "median", "mean", "min", "cv%", "ops");
+		}
+
+		const std::vector<Result>& GetResults() const { return results; }
+
+	private:
+		template<typename F>
+		static double TimeMs(F&& _f)
+		{
+			auto start = std::chrono::steady_clock::now();
+			_f();
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		static Result Summarize(const std::string& _name, uint64_t _operations, std::vector<double>& _samples)
+		{
+			std::sort(_samples.begin(), _samples.end());
+
+			double sum = 0.0;
+			for (const auto& s : _samples)
+				sum += s;
+			double mean = sum / _samples.size();
+
+			double variance = 0.0;
+			for (const auto& s : _samples)
+				variance += (s - mean) * (s - mean);
+			variance /= _samples.size() > 1 ? _samples.size() - 1 : 1;
+
+			size_t mid = _samples.size() / 2;
+			double median = _samples.size() % 2 ? _samples[mid] : (_samples[mid - 1] + _samples[mid]) * 0.5;
+
+			return { _name, _operations, static_cast<uint32_t>(_samples.size()), median, mean, std::sqrt(variance), _samples.front() };
+		}
+
+		// One line per benchmark, fixed columns -- Runs can be compared with a plain diff
+		static void Print(const Result& _result)
+		{
+			std::printf("%-56s %14.2f %14.2f %14.2f %8.2f %10llu\n",
+				_result.name.c_str(),
+				_result.median,
+				_result.mean,
+				_result.min,
+				_result.mean > 0.0 ? 100.0 * _result.stddev / _result.mean : 0.0,
+				static_cast<unsigned long long>(_result.operations));
+		}
+
+		Settings settings;
+		std::vector<Result> results;
+	};
+
+} // namespace bench
+} // namespace skel
@@ -1,5 +1,6 @@
 
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 struct DirectionalLightInfo
 {
@@ -24,6 +25,16 @@ struct SpotLightInfo
 	float outerCutOff;
 };
 
+// Indices into the bindless texture array
+struct MaterialInfo
+{
+	uint albedo;
+	uint normal;
+	uint metallic;
+	uint roughness;
+	uint ao;
+};
+
 // TODO : https://www.khronos.org/opengl/wiki/Shader_Storage_Buffer_Object
 layout(set = 0, binding = 1) uniform LightInfos
 {
@@ -31,24 +42,25 @@ layout(set = 0, binding = 1) uniform LightInfos
 	PointLightInfo pointLights[4];
 	SpotLightInfo spotlights[2];
 }lights;
-layout(set = 0, binding = 2) uniform sampler2D AlbedoSampler;
-layout(set = 0, binding = 3) uniform sampler2D NormalSampler;
-layout(set = 0, binding = 4) uniform sampler2D MetallicSampler;
-layout(set = 0, binding = 5) uniform sampler2D RoughnessSampler;
-layout(set = 0, binding = 6) uniform sampler2D AOSampler;
+layout(std430, set = 0, binding = 2) readonly buffer MaterialBuffer
+{
+	MaterialInfo materials[];
+};
+layout(set = 0, binding = 4) uniform sampler2D textures[];
 
 layout(location = 0) in vec3 inPos;			// fragment position in world-space
 layout(location = 1) in vec3 inNormal;		// fragment normal in model space
 layout(location = 2) in vec2 inTexCoord;	// fragment UV coordinate
 layout(location = 3) in vec3 inCamPos;		// camera position in world-space
+layout(location = 4) flat in uint inMaterialIndex;	// Index into the material buffer
 
 layout(location = 0) out vec4 outColor;
 
 const float PI = 3.1415926535;
 
-vec3 TransformNormalMapToModel()
+vec3 TransformNormalMapToModel(MaterialInfo material)
 {
-	vec3 tangetNormal = texture(NormalSampler, inTexCoord).xyz * 2.0 - 1.0;
+	vec3 tangetNormal = texture(textures[nonuniformEXT(material.normal)], inTexCoord).xyz * 2.0 - 1.0;
 
 	vec3 q1 = dFdx(inPos);
 	vec3 q2 = dFdy(inPos);
@@ -128,15 +140,17 @@ vec3 CalculatePBRLighting(vec3 N, vec3 V, vec3 L, vec3 H, vec3 F0, vec3 albedo,
 
 void main()
 {
-	vec3 albedo= texture(AlbedoSampler, inTexCoord).xyz;
+	MaterialInfo material = materials[inMaterialIndex];
+
+	vec3 albedo= texture(textures[nonuniformEXT(material.albedo)], inTexCoord).xyz;
 	vec3 finalLight = vec3(0.0);
 	vec3 final = vec3(0.0);
 
-	float metallic = texture(MetallicSampler, inTexCoord).r;
-	float roughness = texture(RoughnessSampler, inTexCoord).r;
-	float ao = texture(AOSampler, inTexCoord).r;
+	float metallic = texture(textures[nonuniformEXT(material.metallic)], inTexCoord).r;
+	float roughness = texture(textures[nonuniformEXT(material.roughness)], inTexCoord).r;
+	float ao = texture(textures[nonuniformEXT(material.ao)], inTexCoord).r;
 
-	vec3 N = TransformNormalMapToModel();
+	vec3 N = TransformNormalMapToModel(material);
 	vec3 V = normalize(inCamPos - inPos);
 
 	vec3 F0 = vec3(0.04);
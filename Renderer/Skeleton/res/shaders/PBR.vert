@@ -1,12 +1,21 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(set = 0, binding = 0) uniform UniformBufferObject {
-	mat4 model;			// model-space -> world-space
+layout(set = 0, binding = 0) uniform CameraBufferObject {
 	mat4 view;			// world-space -> view-space (camera-space)
 	mat4 proj;			// view-space -> clip-space
 	vec3 camPosition;	// Camera's position in world-space
-} ubo;
+} camera;
+
+// Written by the renderer every frame -- Draws select their entry with firstInstance
+struct ObjectData {
+	mat4 model;					// model-space -> world-space
+	mat4 modelViewProjection;	// model-space -> clip-space
+	uint materialIndex;			// Index into the renderer's material table
+};
+layout(std430, set = 0, binding = 3) readonly buffer ObjectBuffer {
+	ObjectData objects[];
+};
 
 layout(location = 0) in vec3 inPosition;	// vertex position in model-space
 layout(location = 1) in vec3 inNormal;		// vertex normal in model-space
@@ -16,12 +25,16 @@ layout(location = 0) out vec3 outPos;		// fragment position in world-space
 layout(location = 1) out vec3 outNormal;	// fragment normal in (model space?)
 layout(location = 2) out vec2 outTexCoord;	// fragment UV coordinate
 layout(location = 3) out vec3 outCamPos;	// camera position in world-space
+layout(location = 4) flat out uint outMaterialIndex;	// Index into the material buffer
 
 void main() {
-	gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
-	outPos = vec3(ubo.model * vec4(inPosition, 1.0));
-	outNormal = mat3(ubo.model) * inNormal;
+	ObjectData object = objects[gl_InstanceIndex];
+
+	gl_Position = object.modelViewProjection * vec4(inPosition, 1.0);
+	outPos = vec3(object.model * vec4(inPosition, 1.0));
+	outNormal = mat3(object.model) * inNormal;
 	outTexCoord = inTexCoord;
-	outCamPos = ubo.camPosition;
+	outCamPos = camera.camPosition;
+	outMaterialIndex = object.materialIndex;
 }
 
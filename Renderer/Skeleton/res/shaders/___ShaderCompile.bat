@@ -5,7 +5,7 @@ if NOT EXIST %d% (
 	set d=D:\VulkanSDK\1.2.148.1\
 )
 
-for /R %%1 in (*.vert, *.frag) do (
+for /R %%1 in (*.vert, *.frag, *.comp) do (
 	call :RenameAndCompile %%1
 )
 
@@ -25,14 +25,14 @@ struct SpotLightInfo
 };
 
 // TODO : https://www.khronos.org/opengl/wiki/Shader_Storage_Buffer_Object
-layout(set = 0, binding = 1) uniform LightInfos
+layout(set = 1, binding = 0) uniform LightInfos
 {
 //	DirectionalLightInfo directionalLight;
 	PointLightInfo pointLights[4];
 	SpotLightInfo spotlights[2];
 }lights;
-layout(set = 0, binding = 2) uniform sampler2D AlbedoSampler;
-//layout(set = 0, binding = 3) uniform sampler2D NormalSampler;
+layout(set = 1, binding = 1) uniform sampler2D AlbedoSampler;
+//layout(set = 1, binding = 2) uniform sampler2D NormalSampler;
 
 layout(location = 0) in vec3 inPos;			// fragment position in world-space
 layout(location = 1) in vec3 inNormal;		// fragment normal in model space
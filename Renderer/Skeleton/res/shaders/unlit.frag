@@ -1,7 +1,7 @@
 
 #version 450
 
-layout(set = 0, binding = 1) uniform uniformColor {
+layout(set = 1, binding = 0) uniform uniformColor {
 	vec3 color;
 } properties;
 
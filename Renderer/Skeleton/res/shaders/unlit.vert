@@ -1,12 +1,21 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(set = 0, binding = 0) uniform UniformBufferObject {
-	mat4 model;			// model-space -> world-space
+layout(set = 0, binding = 0) uniform CameraBufferObject {
 	mat4 view;			// world-space -> view-space (camera-space)
 	mat4 proj;			// view-space -> clip-space
 	vec3 camPosition;	// Camera's position in world-space
-} ubo;
+} camera;
+
+// Written by the renderer every frame -- Draws select their entry with firstInstance
+struct ObjectData {
+	mat4 model;					// model-space -> world-space
+	mat4 modelViewProjection;	// model-space -> clip-space
+	uint materialIndex;			// Index into the renderer's material table
+};
+layout(std430, set = 0, binding = 3) readonly buffer ObjectBuffer {
+	ObjectData objects[];
+};
 
 layout(location = 0) in vec3 inPosition;	// vertex position in model-space
 layout(location = 1) in vec3 inNormal;		// vertex normal in model-space
@@ -18,10 +27,12 @@ layout(location = 2) out vec2 outTexCoord;	// fragment UV coordinate
 layout(location = 3) out vec3 outCamPos;	// camera position in world-space
 
 void main() {
-	gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
-	outPos = mat3(ubo.model) * inPosition;
+	ObjectData object = objects[gl_InstanceIndex];
+
+	gl_Position = object.modelViewProjection * vec4(inPosition, 1.0);
+	outPos = mat3(object.model) * inPosition;
 	outNormal = inNormal;
 	outTexCoord = inTexCoord;
-	outCamPos = ubo.camPosition;
+	outCamPos = camera.camPosition;
 }
 
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+
+#include "Common.h"
+#include "VulkanDevice.h"
+#include "Mesh.h"
+#include "Texture.h"
+#include "FileLoader.h"
+#include "JobSystem.h"
+
+namespace skel
+{
+	enum class StreamState : uint32_t
+	{
+		Decoding,	// Queued or being read & decoded on a worker
+		Decoded,	// Waiting for the main thread to upload it
+		Uploading,	// Copies submitted -- Waiting on the timeline
+		Ready,
+		Failed
+	};
+
+	// One file on its way to the GPU -- Read & decoded by a background job, then uploaded by the streamer's Update
+	// Only the state is shared with the worker; it publishes everything the worker wrote
+	struct StreamRequest
+	{
+		enum class Type { Mesh, Texture };
+
+		Type type;
+		std::string path;
+		std::atomic<uint32_t> state{ static_cast<uint32_t>(StreamState::Decoding) };
+
+		// Written by the worker
+		Mesh* mesh = nullptr;			// Buffers are created by the upload
+		stbi_uc* pixels = nullptr;		// RGBA8 -- Freed once copied to staging
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::string error;
+
+		// Main thread only
+		TextureComponent texture = {};
+		uint64_t uploaded = 0;			// Timeline value of the last copy
+		bool cancelled = false;
+
+		// Called on the main thread once the resources can be used -- Takes ownership of `mesh` or `texture`
+		std::function<void(StreamRequest&)> onReady;
+
+		StreamState State() const { return static_cast<StreamState>(state.load(std::memory_order_acquire)); }
+		bool IsReady() const { return State() == StreamState::Ready; }
+
+		// Drops the callback -- The streamer frees whatever gets loaded
+		void Cancel()
+		{
+			cancelled = true;
+			onReady = nullptr;
+		}
+	};
+
+	// A pending asset -- Valid until Ready, or cancelled
+	typedef std::shared_ptr<StreamRequest> StreamHandle;
+
+	struct AssetStreamerStats
+	{
+		uint32_t decoding = 0;
+		uint32_t uploading = 0;
+		uint32_t completed = 0;		// Since creation
+	};
+
+	// Loads meshes & textures without blocking the caller
+	//  - Files are read & decoded by background jobs, which the main thread never runs
+	//  - Update (main thread, once per frame) records the uploads on the transfer queue without waiting for them,
+	//    and hands over each asset once the timeline shows its copies completed
+	//  - Uploads are capped per frame, so a burst of loads is spread over several frames
+	struct AssetStreamer
+	{
+		VulkanDevice* device = nullptr;
+		uint32_t maxUploadsPerFrame = 16;
+
+		std::vector<StreamHandle> requests;		// In flight
+		jobs::Counter decodes;
+		AssetStreamerStats stats;
+
+		void Create(VulkanDevice* _device)
+		{
+			device = _device;
+		}
+
+		// Waits for the decodes & copies still running, then frees everything nobody claimed
+		void Cleanup()
+		{
+			jobs::Wait(decodes);
+			device->timeline.Wait(device->logicalDevice, device->timeline.lastSubmitted);
+			for (auto& request : requests)
+				Release(*request);
+			requests.clear();
+		}
+
+		// _path is a full path, like LoadMesh's
+		StreamHandle LoadMesh(const char* _path, const std::function<void(StreamRequest&)>& _onReady)
+		{
+			return Queue(StreamRequest::Type::Mesh, _path, _onReady);
+		}
+
+		// _directory is from the base texture resource folder, like CreateTexture's
+		StreamHandle LoadTexture(const char* _directory, const std::function<void(StreamRequest&)>& _onReady)
+		{
+			return Queue(StreamRequest::Type::Texture, std::string(texturePrefix) + _directory, _onReady);
+		}
+
+		// Uploads decoded assets and hands over the ones whose copies completed -- Never waits
+		// A failed load throws here, on the main thread, as a synchronous load would have
+		void Update()
+		{
+			SKEL_PROFILE_FUNCTION();
+
+			uint64_t completedValue = device->timeline.CompletedValue(device->logicalDevice);
+			uint32_t uploads = 0;
+
+			for (size_t i = 0; i < requests.size();)
+			{
+				StreamRequest& request = *requests[i];
+				bool done = false;
+
+				switch (request.State())
+				{
+				case StreamState::Decoded:
+					if (request.cancelled)
+					{
+						Release(request);
+						done = true;
+					}
+					else if (uploads < maxUploadsPerFrame)
+					{
+						Upload(request);
+						uploads++;
+					}
+					break;
+
+				case StreamState::Uploading:
+					if (request.uploaded > completedValue)
+						break;
+
+					request.state.store(static_cast<uint32_t>(StreamState::Ready), std::memory_order_release);
+					if (request.cancelled)
+						Release(request);
+					else if (request.onReady)
+						request.onReady(request);
+					stats.completed++;
+					done = true;
+					break;
+
+				case StreamState::Failed:
+					if (!request.cancelled)
+						throw std::runtime_error("Failed to stream " + request.path + " -- " + request.error);
+					done = true;
+					break;
+
+				default:
+					break;
+				}
+
+				if (done)
+				{
+					requests[i] = requests.back();
+					requests.pop_back();
+				}
+				else
+					i++;
+			}
+
+			stats.decoding = 0;
+			stats.uploading = 0;
+			for (const auto& request : requests)
+			{
+				if (request->State() == StreamState::Uploading)
+					stats.uploading++;
+				else
+					stats.decoding++;
+			}
+		}
+
+		uint32_t PendingCount() const { return static_cast<uint32_t>(requests.size()); }
+
+	private:
+		StreamHandle Queue(StreamRequest::Type _type, const std::string& _path, const std::function<void(StreamRequest&)>& _onReady)
+		{
+			StreamHandle request = std::make_shared<StreamRequest>();
+			request->type = _type;
+			request->path = _path;
+			request->onReady = _onReady;
+			requests.push_back(request);
+
+			// The streamer keeps the request alive until the job is done with it
+			StreamRequest* decoding = request.get();
+			jobs::RunBackground([decoding]() { Decode(*decoding); }, &decodes);
+			stats.decoding++;
+			return request;
+		}
+
+		// Worker -- Reads & decodes the file, then publishes the result with the state
+		static void Decode(StreamRequest& _request)
+		{
+			SKEL_PROFILE_SCOPE("StreamDecode");
+
+			StreamState result = StreamState::Decoded;
+			try
+			{
+				if (_request.type == StreamRequest::Type::Mesh)
+					_request.mesh = ParseMesh(_request.path.c_str());
+				else
+				{
+					int width, height, channels;
+					_request.pixels = stbi_load(_request.path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+					if (_request.pixels == nullptr)
+						throw std::runtime_error("Failed to load texture image");
+					_request.width = static_cast<uint32_t>(width);
+					_request.height = static_cast<uint32_t>(height);
+				}
+			}
+			catch (std::exception& e)
+			{
+				_request.error = e.what();
+				result = StreamState::Failed;
+			}
+
+			_request.state.store(static_cast<uint32_t>(result), std::memory_order_release);
+		}
+
+		// Main thread -- Creates the GPU resources and submits their copies
+		void Upload(StreamRequest& _request)
+		{
+			if (_request.type == StreamRequest::Type::Mesh)
+				_request.uploaded = UploadMesh(device, _request.mesh);
+			else
+			{
+				TextureComponent& texture = _request.texture;
+				_request.uploaded = UploadTextureImage(device, _request.pixels, _request.width, _request.height, texture.image, texture.memory);
+				stbi_image_free(_request.pixels);
+				_request.pixels = nullptr;
+
+				CreateTextureImageView(device, texture.image, texture.view);
+				CreateTextureSampler(device, texture.sampler);
+			}
+
+			_request.state.store(static_cast<uint32_t>(StreamState::Uploading), std::memory_order_release);
+		}
+
+		// Frees an unclaimed request's resources -- Only called once its copies completed, or before any were made
+		void Release(StreamRequest& _request)
+		{
+			VkDevice logicalDevice = device->logicalDevice;
+			if (_request.mesh != nullptr)
+			{
+				if (_request.State() != StreamState::Decoded)
+					_request.mesh->Cleanup(logicalDevice);
+				delete _request.mesh;
+				_request.mesh = nullptr;
+			}
+
+			if (_request.pixels != nullptr)
+			{
+				stbi_image_free(_request.pixels);
+				_request.pixels = nullptr;
+			}
+
+			TextureComponent& texture = _request.texture;
+			vkDestroySampler(logicalDevice, texture.sampler, nullptr);
+			vkDestroyImageView(logicalDevice, texture.view, nullptr);
+			vkDestroyImage(logicalDevice, texture.image, nullptr);
+			vkFreeMemory(logicalDevice, texture.memory, nullptr);
+			texture = {};
+		}
+	}; // AssetStreamer
+
+} // namespace skel
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <functional>
+
+#include <vulkan/vulkan.h>
+
+#include "VulkanDevice.h"
+#include "FramePacing.h"
+#include "Timeline.h"
+
+namespace skel
+{
+	// Compute work recorded every frame and submitted to the compute queue ahead of the frame's rendering
+	// Anything it writes that a frame in flight may still read must be per frame slot
+	struct AsyncComputePass
+	{
+		std::string name;
+		std::function<void(VkCommandBuffer, uint32_t)> record;	// Command buffer, frame slot
+		VkPipelineStageFlags consumerStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;	// Where rendering first reads the results
+		bool waitForPreviousFrame = false;	// Reads the previous frame's rendering (ex: its depth) -- Overlaps it less
+	};
+
+	// Runs compute passes on the compute queue, overlapping the previous frame's raster work
+	// The frame's graphics submission waits for them on the compute timeline at the passes' consumer stages
+	struct AsyncCompute
+	{
+		static const uint32_t maxFramesInFlight = FramePacer::maxFramesInFlight;
+
+		VulkanDevice* device = nullptr;
+		std::vector<AsyncComputePass> passes;
+
+		// One pool per frame slot -- Reset whole instead of freeing command buffers
+		uint32_t commandPoolIndices[maxFramesInFlight] = {};
+		VkCommandBuffer commandBuffers[maxFramesInFlight] = {};
+		uint64_t submittedValues[maxFramesInFlight] = {};
+
+		void Create(VulkanDevice* _device)
+		{
+			device = _device;
+
+			for (uint32_t i = 0; i < maxFramesInFlight; i++)
+			{
+				// Destroyed with the device's other pools
+				commandPoolIndices[i] = device->CreateCommandPool(device->queueFamilyIndices.compute, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+				VkCommandBufferAllocateInfo allocInfo = {};
+				allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+				allocInfo.commandPool = device->commandPools[commandPoolIndices[i]];
+				allocInfo.commandBufferCount = 1;
+
+				if (vkAllocateCommandBuffers(device->logicalDevice, &allocInfo, &commandBuffers[i]) != VK_SUCCESS)
+					throw std::runtime_error("Failed to allocate compute command buffer");
+			}
+
+			std::printf("Async compute: %s\n", device->asyncComputeEnabled ? "dedicated queue family" : "shares the graphics queue");
+		}
+
+		void Cleanup()
+		{
+			passes.clear();
+		}
+
+		void AddPass(const AsyncComputePass& _pass)
+		{
+			passes.push_back(_pass);
+		}
+
+		// Records and submits the frame's passes -- Returns the waits for the frame's graphics submission
+		// _previousFrameValue is the main timeline's value for the previous frame's rendering
+		std::vector<TimelineWait> Execute(uint32_t _slot, uint64_t _previousFrameValue)
+		{
+			std::vector<TimelineWait> graphicsWaits;
+			if (passes.empty())
+				return graphicsWaits;
+
+			// Rendering waited on the slot's last submission, so this rarely blocks
+			device->computeTimeline.Wait(device->logicalDevice, submittedValues[_slot]);
+			vkResetCommandPool(device->logicalDevice, device->commandPools[commandPoolIndices[_slot]], 0);
+
+			VkCommandBuffer commandBuffer = commandBuffers[_slot];
+			VkCommandBufferBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+			VkPipelineStageFlags consumerStages = 0;
+			bool waitForPreviousFrame = false;
+			for (const auto& pass : passes)
+			{
+				pass.record(commandBuffer, _slot);
+				consumerStages |= pass.consumerStages;
+				waitForPreviousFrame |= pass.waitForPreviousFrame;
+			}
+
+			vkEndCommandBuffer(commandBuffer);
+
+			VkSubmitInfo submitInfo = {};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &commandBuffer;
+
+			std::vector<TimelineWait> computeWaits;
+			if (waitForPreviousFrame)
+				computeWaits.push_back(device->timeline.WaitFor(_previousFrameValue, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT));
+
+			submittedValues[_slot] = device->computeTimeline.Submit(device->computeQueue, submitInfo, computeWaits);
+
+			graphicsWaits.push_back(device->computeTimeline.WaitFor(submittedValues[_slot], consumerStages));
+			return graphicsWaits;
+		}
+
+		// Moves a buffer between the graphics & compute families -- Recorded once on each queue, release then acquire
+		// Not needed for buffers created shared with compute (see VulkanDevice::CreateBuffer)
+		VkBufferMemoryBarrier OwnershipBarrier(VkBuffer _buffer, bool _toCompute, VkAccessFlags _srcAccess, VkAccessFlags _dstAccess) const
+		{
+			VkBufferMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = _srcAccess;
+			barrier.dstAccessMask = _dstAccess;
+			barrier.buffer = _buffer;
+			barrier.offset = 0;
+			barrier.size = VK_WHOLE_SIZE;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+			if (device->asyncComputeEnabled)
+			{
+				barrier.srcQueueFamilyIndex = _toCompute ? device->queueFamilyIndices.graphics : device->queueFamilyIndices.compute;
+				barrier.dstQueueFamilyIndex = _toCompute ? device->queueFamilyIndices.compute : device->queueFamilyIndices.graphics;
+			}
+			return barrier;
+		}
+	}; // AsyncCompute
+
+} // namespace skel
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+
+#include "Common.h"
+#include "Camera.h"
+
+namespace skel
+{
+	// A point the camera passes through, and where it looks from there
+	struct CameraKey
+	{
+		glm::vec3 position;
+		glm::vec3 target;
+	};
+
+	// A closed Catmull-Rom spline through camera keys -- Evaluated by frame, never by wall time
+	struct CameraSpline
+	{
+		std::vector<CameraKey> keys;
+
+		// _t wraps at 1 -- The spline passes through every key once per loop
+		CameraKey Evaluate(float _t) const
+		{
+			uint32_t count = static_cast<uint32_t>(keys.size());
+			float scaled = (_t - std::floor(_t)) * count;
+			uint32_t i = static_cast<uint32_t>(scaled) % count;
+			float f = scaled - std::floor(scaled);
+
+			const CameraKey& k0 = keys[(i + count - 1) % count];
+			const CameraKey& k1 = keys[i];
+			const CameraKey& k2 = keys[(i + 1) % count];
+			const CameraKey& k3 = keys[(i + 2) % count];
+
+			return { CatmullRom(k0.position, k1.position, k2.position, k3.position, f), CatmullRom(k0.target, k1.target, k2.target, k3.target, f) };
+		}
+
+		// Moves the camera onto the spline
+		void Apply(Camera* _camera, float _t) const
+		{
+			CameraKey key = Evaluate(_t);
+			glm::vec3 direction = glm::normalize(key.target - key.position);
+
+			_camera->cameraPosition = key.position;
+			_camera->yaw = glm::degrees(std::atan2(direction.z, direction.x));
+			_camera->pitch = glm::degrees(std::asin(glm::clamp(direction.y, -1.0f, 1.0f)));
+			_camera->UpdateCameraView();
+		}
+
+		// Circles the origin, rising and falling, always looking at the scene's center
+		static CameraSpline Orbit(float _radius = 6.0f, uint32_t _keyCount = 8)
+		{
+			CameraSpline spline;
+			for (uint32_t i = 0; i < _keyCount; i++)
+			{
+				float angle = glm::two_pi<float>() * i / _keyCount;
+				float height = (i & 1) ? 1.5f : -0.5f;
+				spline.keys.push_back({ { std::sin(angle) * _radius, height, std::cos(angle) * _radius }, { 0.0f, 0.0f, 0.0f } });
+			}
+			return spline;
+		}
+
+	private:
+		static glm::vec3 CatmullRom(const glm::vec3& _p0, const glm::vec3& _p1, const glm::vec3& _p2, const glm::vec3& _p3, float _t)
+		{
+			float t2 = _t * _t;
+			float t3 = t2 * _t;
+			return 0.5f * ((2.0f * _p1)
+				+ (_p2 - _p0) * _t
+				+ (2.0f * _p0 - 5.0f * _p1 + 4.0f * _p2 - _p3) * t2
+				+ (3.0f * _p1 - _p0 - _p2 + _p3) * t3);
+		}
+	};
+
+	struct BenchmarkSettings
+	{
+		uint32_t warmupFrames = 120;		// Rendered, but not recorded -- Loads the scene and fills caches
+		uint32_t frameCount = 1000;			// Recorded frames
+		uint32_t sceneObjects = 4;			// Subjects spawned by the application
+		uint32_t framesPerLoop = 600;		// Frames for one loop of the camera path
+		float simulationStep = 1.0f / 60.0f;	// Fixed delta time, so the scene is identical every run
+		float stutterFactor = 2.0f;			// Frames slower than this many medians are stutters
+		std::string reportPath = ".\\benchmark.json";
+		CameraSpline path = CameraSpline::Orbit();
+	};
+
+	// Drives the camera and records per-frame times for a benchmark run
+	struct Benchmark
+	{
+		BenchmarkSettings settings;
+		bool active = false;
+
+		std::vector<float> frameTimes;	// Milliseconds, wall time between frames
+		std::vector<float> cpuTimes;	// Milliseconds, application update & command recording
+		std::vector<float> gpuTimes;	// Milliseconds, from the GPU profiler's frame zone -- Arrives a few frames late
+		uint64_t lastGpuFrame = 0;
+		float recordedSeconds = 0.0f;
+
+		void Start(const BenchmarkSettings& _settings)
+		{
+			settings = _settings;
+			active = true;
+			frameTimes.clear();
+			cpuTimes.clear();
+			gpuTimes.clear();
+			frameTimes.reserve(settings.frameCount);
+			cpuTimes.reserve(settings.frameCount);
+			gpuTimes.reserve(settings.frameCount);
+			recordedSeconds = 0.0f;
+		}
+
+		void ApplyCamera(Camera* _camera, uint32_t _frameNumber) const
+		{
+			settings.path.Apply(_camera, static_cast<float>(_frameNumber) / settings.framesPerLoop);
+		}
+
+		bool IsRecording(uint32_t _frameNumber) const
+		{
+			return _frameNumber >= settings.warmupFrames;
+		}
+
+		bool IsFinished(uint32_t _frameNumber) const
+		{
+			return _frameNumber >= settings.warmupFrames + settings.frameCount;
+		}
+
+		// _gpuFrame & _gpuTime are the profiler's latest read-back frame and its duration
+		void RecordFrame(uint32_t _frameNumber, float _frameTime, float _cpuTime, uint64_t _gpuFrame, float _gpuTime)
+		{
+			if (!IsRecording(_frameNumber))
+			{
+				lastGpuFrame = _gpuFrame;
+				return;
+			}
+
+			frameTimes.push_back(_frameTime);
+			cpuTimes.push_back(_cpuTime);
+			recordedSeconds += _frameTime / 1000.0f;
+
+			if (_gpuFrame != lastGpuFrame)
+			{
+				gpuTimes.push_back(_gpuTime);
+				lastGpuFrame = _gpuFrame;
+			}
+		}
+
+		// Writes percentiles, stutters, and throughput as JSON
+		// Startup times are included so runs with a cold and a warm pipeline cache can be compared
+		void WriteReport(const char* _presentMode, VkExtent2D _extent, float _timeToFirstFrame, bool _warmPipelineCache, uint32_t _swapchainRecreates, float _lastRecreateTime)
+		{
+			std::ofstream file(settings.reportPath, std::ios::out | std::ios::trunc);
+			if (!file.is_open())
+			{
+				std::printf("Failed to write benchmark report to %s\n", settings.reportPath.c_str());
+				return;
+			}
+
+			std::vector<float> sortedFrames = frameTimes;
+			std::sort(sortedFrames.begin(), sortedFrames.end());
+			float median = Percentile(sortedFrames, 0.5f);
+
+			uint32_t stutters = 0;
+			uint32_t longFrames = 0;
+			for (const auto& t : frameTimes)
+			{
+				if (t > median * settings.stutterFactor)
+					stutters++;
+				if (t > 33.3f)
+					longFrames++;
+			}
+
+			file << "{\n"
+				<< "\t\"frames\": " << frameTimes.size() << ",\n"
+				<< "\t\"warmupFrames\": " << settings.warmupFrames << ",\n"
+				<< "\t\"sceneObjects\": " << settings.sceneObjects << ",\n"
+				<< "\t\"presentMode\": \"" << _presentMode << "\",\n"
+				<< "\t\"extent\": [" << _extent.width << ", " << _extent.height << "],\n"
+				<< "\t\"startup\": { \"timeToFirstFrameMs\": " << _timeToFirstFrame << ", \"pipelineCache\": \"" << (_warmPipelineCache ? "warm" : "cold")
+				<< "\", \"swapchainRecreates\": " << _swapchainRecreates << ", \"lastRecreateMs\": " << _lastRecreateTime << " },\n";
+			WriteTimes(file, "frameTimeMs", frameTimes);
+			WriteTimes(file, "cpuTimeMs", cpuTimes);
+			WriteTimes(file, "gpuTimeMs", gpuTimes);
+			file << "\t\"stutters\": { \"overMedianFactor\": " << stutters << ", \"medianFactor\": " << settings.stutterFactor
+				<< ", \"over33ms\": " << longFrames << " },\n"
+				<< "\t\"throughput\": { \"seconds\": " << recordedSeconds << ", \"fps\": " << (recordedSeconds > 0.0f ? frameTimes.size() / recordedSeconds : 0.0f) << " }\n"
+				<< "}\n";
+
+			std::printf("Benchmark: p50 %.2f ms, p99 %.2f ms, %d stutters, first frame after %.2f ms (%s pipeline cache) -- Report written to %s\n",
+				median, Percentile(sortedFrames, 0.99f), stutters, _timeToFirstFrame, _warmPipelineCache ? "warm" : "cold", settings.reportPath.c_str());
+		}
+
+	private:
+		// Nearest-rank percentile of sorted samples
+		static float Percentile(const std::vector<float>& _sorted, float _p)
+		{
+			if (_sorted.empty())
+				return 0.0f;
+			size_t rank = static_cast<size_t>(std::ceil(_p * _sorted.size()));
+			return _sorted[std::min(_sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+		}
+
+		static void WriteTimes(std::ofstream& _file, const char* _name, const std::vector<float>& _samples)
+		{
+			std::vector<float> sorted = _samples;
+			std::sort(sorted.begin(), sorted.end());
+
+			double sum = 0.0;
+			for (const auto& s : sorted)
+				sum += s;
+
+			_file << "\t\"" << _name << "\": { "
+				<< "\"mean\": " << (sorted.empty() ? 0.0 : sum / sorted.size())
+				<< ", \"p50\": " << Percentile(sorted, 0.5f)
+				<< ", \"p95\": " << Percentile(sorted, 0.95f)
+				<< ", \"p99\": " << Percentile(sorted, 0.99f)
+				<< ", \"max\": " << (sorted.empty() ? 0.0f : sorted.back())
+				<< " },\n";
+		}
+	}; // Benchmark
+
+} // namespace skel
@@ -0,0 +1,540 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "ecs/ecs.h"
+#include "Culling.h"
+
+namespace skel
+{
+// ==============================================
+// Box tests
+// ==============================================
+
+	// Where a ray first touches a box (0 if it starts inside) -- FLT_MAX if it misses within _maxDistance
+	// _inverseDirection is 1 / direction per axis (see InverseRayDirection)
+	inline float RayBoxDistance(const glm::vec3& _origin, const glm::vec3& _inverseDirection, const glm::vec3& _min, const glm::vec3& _max, float _maxDistance)
+	{
+		glm::vec3 t0 = (_min - _origin) * _inverseDirection;
+		glm::vec3 t1 = (_max - _origin) * _inverseDirection;
+		glm::vec3 entries = glm::min(t0, t1);
+		glm::vec3 exits = glm::max(t0, t1);
+		float enter = std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+		float exit = std::min(std::min(exits.x, exits.y), std::min(exits.z, _maxDistance));
+		return enter <= exit ? enter : FLT_MAX;
+	}
+
+	// Zero components become tiny instead of dividing by zero -- Keeps the slab test free of NaNs
+	inline glm::vec3 InverseRayDirection(const glm::vec3& _direction)
+	{
+		glm::vec3 inverse;
+		for (int i = 0; i < 3; i++)
+			inverse[i] = 1.0f / (std::abs(_direction[i]) > 1e-20f ? _direction[i] : std::copysign(1e-20f, _direction[i]));
+		return inverse;
+	}
+
+	// 0 inside the box
+	inline float PointBoxDistanceSquared(const glm::vec3& _point, const glm::vec3& _min, const glm::vec3& _max)
+	{
+		glm::vec3 offset = glm::max(glm::max(_min - _point, _point - _max), glm::vec3(0.0f));
+		return glm::dot(offset, offset);
+	}
+
+// ==============================================
+// BVH
+// ==============================================
+
+	// 32 bytes -- Two per cache line, and a node's children are always neighbors
+	struct BvhNode
+	{
+		glm::vec3 min;
+		uint32_t offset;	// Interior: the left child, the right child follows it -- Leaf: the first item
+		glm::vec3 max;
+		uint32_t count;		// Items in a leaf -- 0 for interior nodes
+	};
+	static_assert(sizeof(BvhNode) == 32, "BVH nodes should stay two per cache line");
+
+	// The closest entity a query found -- Null if none
+	struct BvhHit
+	{
+		ecs::Entity entity;
+		float distance = FLT_MAX;
+	};
+
+	// A bounding volume hierarchy over world bounds, built with the surface area heuristic
+	// Meant for entities that rarely move -- Any change means a rebuild
+	// Queries are against each item's world-axis box (WorldBounds::extents), culling also uses its sphere
+	class Bvh
+	{
+	private:
+		static const uint32_t maxLeafItems = 4;
+		static const uint32_t binCount = 16;
+		static const uint32_t maxSahDepth = 64;			// Deeper ranges split at the median -- Caps the depth for traversal stacks
+		static const uint32_t stackSize = 128;
+		static const uint32_t minParallelItems = 4096;	// Smaller builds stay on the calling thread
+		static const uint32_t acceptedBit = 0x80000000;	// Frustum traversal -- The whole subtree is inside
+
+		struct BuildItem
+		{
+			glm::vec3 min;
+			glm::vec3 max;
+			glm::vec3 centroid;
+			uint32_t index;
+		};
+
+		// A subtree built on another thread, then spliced in at `node`
+		struct BuildTask
+		{
+			uint32_t node;
+			uint32_t begin;
+			uint32_t end;
+			uint32_t depth;
+		};
+
+		std::vector<BvhNode> nodes;
+		// Per item, in leaf order -- A leaf's items are contiguous
+		std::vector<WorldBounds> itemBounds;
+		std::vector<ecs::Entity> itemEntities;
+
+	public:
+		// Replaces the hierarchy with one over _count bounds & their entities
+		// The top levels are split here, the subtrees below them are built in parallel
+		void Build(const WorldBounds* _bounds, const ecs::Entity* _entities, uint32_t _count)
+		{
+			SKEL_PROFILE_FUNCTION();
+
+			Clear();
+			if (_count == 0)
+				return;
+
+			std::vector<BuildItem> items(_count);
+			for (uint32_t i = 0; i < _count; i++)
+			{
+				glm::vec3 center = glm::vec3(_bounds[i].sphere);
+				glm::vec3 extents = glm::vec3(_bounds[i].extents);
+				items[i] = { center - extents, center + extents, center, i };
+			}
+
+			// Enough subtrees to balance across threads -- Each top level doubles them
+			uint32_t taskDepth = UINT32_MAX;
+			if (_count >= minParallelItems)
+			{
+				uint32_t threads = jobs::CoreCount();
+				taskDepth = 0;
+				while ((1u << taskDepth) < threads * 4 && (_count >> taskDepth) >= minParallelItems / 4)
+					taskDepth++;
+			}
+
+			std::vector<BuildTask> tasks;
+			nodes.reserve(_count * 2);
+			nodes.push_back(BvhNode());
+			Split(nodes, items.data(), 0, 0, _count, 0, taskDepth, &tasks);
+
+			std::vector<std::vector<BvhNode>> subtrees(tasks.size());
+			ecs::ParallelFor(static_cast<uint32_t>(tasks.size()), [&](uint32_t _task) {
+				const BuildTask& task = tasks[_task];
+				std::vector<BvhNode>& subtree = subtrees[_task];
+				subtree.reserve((task.end - task.begin) * 2);
+				subtree.push_back(BvhNode());
+				Split(subtree, items.data(), 0, task.begin, task.end, task.depth, UINT32_MAX, nullptr);
+			}, 1);
+
+			// A subtree's root replaces its task's node, the rest is appended -- Leaves already point at global items
+			for (uint32_t t = 0; t < static_cast<uint32_t>(tasks.size()); t++)
+			{
+				const std::vector<BvhNode>& subtree = subtrees[t];
+				uint32_t base = static_cast<uint32_t>(nodes.size()) - 1;
+				for (uint32_t i = 0; i < static_cast<uint32_t>(subtree.size()); i++)
+				{
+					BvhNode node = subtree[i];
+					if (node.count == 0)
+						node.offset += base;
+					if (i == 0)
+						nodes[tasks[t].node] = node;
+					else
+						nodes.push_back(node);
+				}
+			}
+
+			itemBounds.resize(_count);
+			itemEntities.resize(_count);
+			for (uint32_t i = 0; i < _count; i++)
+			{
+				itemBounds[i] = _bounds[items[i].index];
+				itemEntities[i] = _entities[items[i].index];
+			}
+		}
+
+		void Clear()
+		{
+			nodes.clear();
+			itemBounds.clear();
+			itemEntities.clear();
+		}
+
+		bool Empty() const { return nodes.empty(); }
+		uint32_t NodeCount() const { return static_cast<uint32_t>(nodes.size()); }
+		uint32_t ItemCount() const { return static_cast<uint32_t>(itemEntities.size()); }
+
+		// Queries
+		// ==========================================
+
+		// Appends every entity in the frustum -- Subtrees fully outside are skipped, subtrees fully inside are taken without more tests
+		void CullFrustum(const Frustum& _frustum, std::vector<ecs::Entity>& _visible) const
+		{
+			if (nodes.empty())
+				return;
+
+			uint32_t stack[stackSize];
+			uint32_t stackCount = 0;
+			stack[stackCount++] = 0;
+
+			while (stackCount > 0)
+			{
+				uint32_t entry = stack[--stackCount];
+				uint32_t index = entry & ~acceptedBit;
+				bool accepted = (entry & acceptedBit) != 0;
+				const BvhNode& node = nodes[index];
+
+				if (!accepted)
+				{
+					int side = ClassifyBox(_frustum, node.min, node.max);
+					if (side < 0)
+						continue;
+					accepted = side > 0;
+				}
+
+				if (node.count == 0)
+				{
+					uint32_t flag = accepted ? acceptedBit : 0;
+					stack[stackCount++] = (node.offset + 1) | flag;
+					stack[stackCount++] = node.offset | flag;
+					continue;
+				}
+
+				for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+					if (accepted || IsVisible(_frustum, itemBounds[i]))
+						_visible.push_back(itemEntities[i]);
+			}
+		}
+
+		// The closest entity whose box the ray hits -- _direction need not be normalized, distances are in its lengths
+		// Children are visited nearest first, so most of the tree is pruned once something is hit
+		BvhHit Raycast(const glm::vec3& _origin, const glm::vec3& _direction, float _maxDistance = FLT_MAX) const
+		{
+			BvhHit hit;
+			hit.distance = _maxDistance;
+			if (nodes.empty())
+				return hit;
+
+			glm::vec3 inverseDirection = InverseRayDirection(_direction);
+			if (RayBoxDistance(_origin, inverseDirection, nodes[0].min, nodes[0].max, hit.distance) == FLT_MAX)
+				return hit;
+
+			uint32_t stack[stackSize];
+			float stackDistances[stackSize];
+			uint32_t stackCount = 0;
+			stack[stackCount] = 0;
+			stackDistances[stackCount++] = 0.0f;
+
+			while (stackCount > 0)
+			{
+				stackCount--;
+				if (stackDistances[stackCount] > hit.distance)
+					continue;
+				const BvhNode& node = nodes[stack[stackCount]];
+
+				if (node.count > 0)
+				{
+					for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+					{
+						glm::vec3 center = glm::vec3(itemBounds[i].sphere);
+						glm::vec3 extents = glm::vec3(itemBounds[i].extents);
+						float distance = RayBoxDistance(_origin, inverseDirection, center - extents, center + extents, hit.distance);
+						if (distance < hit.distance)
+						{
+							hit.distance = distance;
+							hit.entity = itemEntities[i];
+						}
+					}
+					continue;
+				}
+
+				uint32_t nearChild = node.offset;
+				uint32_t farChild = node.offset + 1;
+				float nearDistance = RayBoxDistance(_origin, inverseDirection, nodes[nearChild].min, nodes[nearChild].max, hit.distance);
+				float farDistance = RayBoxDistance(_origin, inverseDirection, nodes[farChild].min, nodes[farChild].max, hit.distance);
+				if (farDistance < nearDistance)
+				{
+					std::swap(nearChild, farChild);
+					std::swap(nearDistance, farDistance);
+				}
+
+				// The nearer child is popped first
+				if (farDistance != FLT_MAX)
+				{
+					stack[stackCount] = farChild;
+					stackDistances[stackCount++] = farDistance;
+				}
+				if (nearDistance != FLT_MAX)
+				{
+					stack[stackCount] = nearChild;
+					stackDistances[stackCount++] = nearDistance;
+				}
+			}
+
+			if (hit.entity.IsNull())
+				hit.distance = FLT_MAX;
+			return hit;
+		}
+
+		// Appends every entity whose box is within _radius of _center
+		void QuerySphere(const glm::vec3& _center, float _radius, std::vector<ecs::Entity>& _found) const
+		{
+			if (nodes.empty())
+				return;
+
+			float radiusSquared = _radius * _radius;
+			uint32_t stack[stackSize];
+			uint32_t stackCount = 0;
+			stack[stackCount++] = 0;
+
+			while (stackCount > 0)
+			{
+				const BvhNode& node = nodes[stack[--stackCount]];
+				if (PointBoxDistanceSquared(_center, node.min, node.max) > radiusSquared)
+					continue;
+
+				if (node.count == 0)
+				{
+					stack[stackCount++] = node.offset + 1;
+					stack[stackCount++] = node.offset;
+					continue;
+				}
+
+				for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+				{
+					glm::vec3 center = glm::vec3(itemBounds[i].sphere);
+					glm::vec3 extents = glm::vec3(itemBounds[i].extents);
+					if (PointBoxDistanceSquared(_center, center - extents, center + extents) <= radiusSquared)
+						_found.push_back(itemEntities[i]);
+				}
+			}
+		}
+
+		// The entity whose box is closest to _point, within _maxDistance -- 0 if the point is inside it
+		BvhHit Nearest(const glm::vec3& _point, float _maxDistance = FLT_MAX) const
+		{
+			BvhHit hit;
+			if (nodes.empty())
+				return hit;
+
+			float bestSquared = _maxDistance == FLT_MAX ? FLT_MAX : _maxDistance * _maxDistance;
+			uint32_t stack[stackSize];
+			float stackDistances[stackSize];
+			uint32_t stackCount = 0;
+			stack[stackCount] = 0;
+			stackDistances[stackCount++] = PointBoxDistanceSquared(_point, nodes[0].min, nodes[0].max);
+
+			while (stackCount > 0)
+			{
+				stackCount--;
+				if (stackDistances[stackCount] > bestSquared)
+					continue;
+				const BvhNode& node = nodes[stack[stackCount]];
+
+				if (node.count > 0)
+				{
+					for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+					{
+						glm::vec3 center = glm::vec3(itemBounds[i].sphere);
+						glm::vec3 extents = glm::vec3(itemBounds[i].extents);
+						float distanceSquared = PointBoxDistanceSquared(_point, center - extents, center + extents);
+						if (distanceSquared <= bestSquared)
+						{
+							bestSquared = distanceSquared;
+							hit.entity = itemEntities[i];
+						}
+					}
+					continue;
+				}
+
+				uint32_t nearChild = node.offset;
+				uint32_t farChild = node.offset + 1;
+				float nearSquared = PointBoxDistanceSquared(_point, nodes[nearChild].min, nodes[nearChild].max);
+				float farSquared = PointBoxDistanceSquared(_point, nodes[farChild].min, nodes[farChild].max);
+				if (farSquared < nearSquared)
+				{
+					std::swap(nearChild, farChild);
+					std::swap(nearSquared, farSquared);
+				}
+
+				stack[stackCount] = farChild;
+				stackDistances[stackCount++] = farSquared;
+				stack[stackCount] = nearChild;
+				stackDistances[stackCount++] = nearSquared;
+			}
+
+			if (!hit.entity.IsNull())
+				hit.distance = std::sqrt(bestSquared);
+			return hit;
+		}
+
+	private:
+		// Building
+		// ==========================================
+
+		// Half the box's surface area -- Only ratios matter
+		static float HalfArea(const glm::vec3& _min, const glm::vec3& _max)
+		{
+			glm::vec3 size = _max - _min;
+			return size.x * size.y + size.y * size.z + size.z * size.x;
+		}
+
+		// Fills _node from items [_begin, _end), splitting until the SAH says a leaf is cheaper
+		// Children are appended to _nodes as a pair -- Reaching _taskDepth hands the range to _tasks instead
+		static void Split(std::vector<BvhNode>& _nodes, BuildItem* _items, uint32_t _node, uint32_t _begin, uint32_t _end,
+			uint32_t _depth, uint32_t _taskDepth, std::vector<BuildTask>* _tasks)
+		{
+			glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+			glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+			for (uint32_t i = _begin; i < _end; i++)
+			{
+				boundsMin = glm::min(boundsMin, _items[i].min);
+				boundsMax = glm::max(boundsMax, _items[i].max);
+				centroidMin = glm::min(centroidMin, _items[i].centroid);
+				centroidMax = glm::max(centroidMax, _items[i].centroid);
+			}
+			_nodes[_node].min = boundsMin;
+			_nodes[_node].max = boundsMax;
+
+			uint32_t count = _end - _begin;
+			if (_tasks && _depth == _taskDepth)
+			{
+				_tasks->push_back({ _node, _begin, _end, _depth });
+				return;
+			}
+
+			uint32_t middle = count > 1 ? FindSahSplit(_items, _begin, _end, boundsMin, boundsMax, centroidMin, centroidMax, _depth) : _end;
+			if (middle == _end)
+			{
+				_nodes[_node].offset = _begin;
+				_nodes[_node].count = count;
+				return;
+			}
+
+			uint32_t left = static_cast<uint32_t>(_nodes.size());
+			_nodes.resize(_nodes.size() + 2);
+			_nodes[_node].offset = left;
+			_nodes[_node].count = 0;
+
+			Split(_nodes, _items, left, _begin, middle, _depth + 1, _taskDepth, _tasks);
+			Split(_nodes, _items, left + 1, middle, _end, _depth + 1, _taskDepth, _tasks);
+		}
+
+		// Partitions the range at the cheapest of binCount - 1 planes per axis -- Returns where the right side starts,
+		// or _end if a leaf is cheaper. Ranges too big for a leaf always split, at the median when the SAH can't
+		static uint32_t FindSahSplit(BuildItem* _items, uint32_t _begin, uint32_t _end, const glm::vec3& _boundsMin, const glm::vec3& _boundsMax,
+			const glm::vec3& _centroidMin, const glm::vec3& _centroidMax, uint32_t _depth)
+		{
+			uint32_t count = _end - _begin;
+			glm::vec3 centroidSize = _centroidMax - _centroidMin;
+
+			int bestAxis = -1;
+			uint32_t bestBin = 0;
+			float bestCost = FLT_MAX;
+			if (_depth < maxSahDepth)
+			{
+				for (int axis = 0; axis < 3; axis++)
+				{
+					if (centroidSize[axis] <= 0.0f)
+						continue;
+
+					uint32_t binItems[binCount] = {};
+					glm::vec3 binMin[binCount], binMax[binCount];
+					for (uint32_t b = 0; b < binCount; b++)
+					{
+						binMin[b] = glm::vec3(FLT_MAX);
+						binMax[b] = glm::vec3(-FLT_MAX);
+					}
+
+					float scale = binCount / centroidSize[axis];
+					for (uint32_t i = _begin; i < _end; i++)
+					{
+						uint32_t b = std::min(binCount - 1, static_cast<uint32_t>((_items[i].centroid[axis] - _centroidMin[axis]) * scale));
+						binItems[b]++;
+						binMin[b] = glm::min(binMin[b], _items[i].min);
+						binMax[b] = glm::max(binMax[b], _items[i].max);
+					}
+
+					// Right side sweep first, then the left side meets it at each plane
+					float rightAreas[binCount];
+					uint32_t rightItems[binCount];
+					glm::vec3 sweepMin(FLT_MAX), sweepMax(-FLT_MAX);
+					uint32_t sweepItems = 0;
+					for (uint32_t b = binCount - 1; b > 0; b--)
+					{
+						sweepItems += binItems[b];
+						sweepMin = glm::min(sweepMin, binMin[b]);
+						sweepMax = glm::max(sweepMax, binMax[b]);
+						rightItems[b] = sweepItems;
+						rightAreas[b] = sweepItems > 0 ? HalfArea(sweepMin, sweepMax) : 0.0f;
+					}
+
+					sweepMin = glm::vec3(FLT_MAX);
+					sweepMax = glm::vec3(-FLT_MAX);
+					sweepItems = 0;
+					for (uint32_t b = 1; b < binCount; b++)
+					{
+						sweepItems += binItems[b - 1];
+						sweepMin = glm::min(sweepMin, binMin[b - 1]);
+						sweepMax = glm::max(sweepMax, binMax[b - 1]);
+						if (sweepItems == 0 || rightItems[b] == 0)
+							continue;
+
+						float cost = sweepItems * HalfArea(sweepMin, sweepMax) + rightItems[b] * rightAreas[b];
+						if (cost < bestCost)
+						{
+							bestCost = cost;
+							bestAxis = axis;
+							bestBin = b;
+						}
+					}
+				}
+			}
+
+			// Traversing a node costs about as much as testing one item
+			float area = HalfArea(_boundsMin, _boundsMax);
+			bool leafCheaper = bestAxis < 0 || area <= 0.0f || 1.0f + bestCost / area >= static_cast<float>(count);
+			if (leafCheaper && count <= maxLeafItems)
+				return _end;
+
+			if (bestAxis < 0)
+			{
+				// Every centroid is the same, or the tree is too deep -- Split the longest axis at the median
+				glm::vec3 size = _boundsMax - _boundsMin;
+				int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+				uint32_t middle = _begin + count / 2;
+				std::nth_element(_items + _begin, _items + middle, _items + _end, [axis](const BuildItem& _a, const BuildItem& _b) {
+					return _a.centroid[axis] < _b.centroid[axis];
+				});
+				return middle;
+			}
+
+			float scale = binCount / centroidSize[bestAxis];
+			float minimum = _centroidMin[bestAxis];
+			BuildItem* middle = std::partition(_items + _begin, _items + _end, [&](const BuildItem& _item) {
+				return std::min(binCount - 1, static_cast<uint32_t>((_item.centroid[bestAxis] - minimum) * scale)) < bestBin;
+			});
+			return static_cast<uint32_t>(middle - _items);
+		}
+	}; // Bvh
+
+} // namespace skel
@@ -4,6 +4,13 @@
 
 namespace skel {
 
+// Matrices shared by every object drawn in a frame
+struct CameraInfo {
+	alignas(16) glm::mat4 view;
+	alignas(16) glm::mat4 proj;
+	alignas(16) glm::vec3 camPosition;
+};
+
 class Camera
 {
 // ==============================================
@@ -59,6 +66,21 @@ public:
 		view = glm::lookAt(cameraPosition, cameraPosition + cameraFront, worldUp);
 	}
 
+	// Unit direction from the camera's position through a window pixel -- Top left origin
+	glm::vec3 ScreenRay(float _x, float _y, float _width, float _height)
+	{
+		// A point on the far plane (depth 1) -- The projection's Y flip already matches window coordinates
+		glm::vec4 clip = { 2.0f * _x / _width - 1.0f, 2.0f * _y / _height - 1.0f, 1.0f, 1.0f };
+		glm::vec4 world = glm::inverse(projection * view) * clip;
+		return glm::normalize(glm::vec3(world) / world.w - cameraPosition);
+	}
+
+	// Returns the matrices to upload to the frame's camera buffer
+	CameraInfo GetShaderInfo()
+	{
+		return { view, projection, cameraPosition };
+	}
+
 }; // Camera
 
 } // skel
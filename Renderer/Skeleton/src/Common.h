@@ -5,6 +5,10 @@
 #include <sdl/SDL.h>
 #include <sdl/SDL_vulkan.h>
 
+// Scoped CPU zones (Profiler.h) -- Compiled out when not defined
+//#define SKEL_ENABLE_PROFILER
+#include "Profiler.h"
+
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 //#define GLM_FORCE_LEFT_HANDED // Sort of breaks GLSL (ALl Zs need to be flipped)
@@ -25,4 +29,11 @@ static const char* shaderPrefix = ".\\res\\shaders\\";
 static const char* texturePrefix = ".\\res\\textures\\";
 static const char* modelPrefix = ".\\res\\models\\";
 
+// Written on shutdown, validated against the device on startup
+static const char* pipelineCachePath = ".\\pipeline.cache";
+// Written when a GPU trace capture completes -- Open in chrome://tracing
+static const char* gpuTracePath = ".\\gpu_trace.json";
+// Written on demand with the buffered CPU zones
+static const char* cpuTracePath = ".\\cpu_trace.json";
+
 
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "ecs/ecs.h"
+#include "Simd.h"
+
+namespace skel
+{
+	// Drawable entities this frame, and how many survived culling
+	struct CullingStats
+	{
+		uint32_t total = 0;
+		uint32_t visible = 0;
+		uint32_t occluded = 0;	// In view, but hidden by the software occlusion buffer
+		uint32_t occluders = 0;	// Drawn into the software occlusion buffer
+	};
+
+// ==============================================
+// Bounds
+// ==============================================
+
+	// Object-space bounds through a model matrix -- The box becomes the world-axis box around the rotated box,
+	// and the sphere grows with the largest axis scale
+	inline WorldBounds TransformBounds(const Bounds& _bounds, const glm::mat4& _model)
+	{
+		glm::vec3 center = (_bounds.min + _bounds.max) * 0.5f;
+		glm::vec3 extents = (_bounds.max - _bounds.min) * 0.5f;
+		glm::vec3 x = glm::vec3(_model[0]);
+		glm::vec3 y = glm::vec3(_model[1]);
+		glm::vec3 z = glm::vec3(_model[2]);
+
+		float maxScaleSquared = std::max(glm::dot(x, x), std::max(glm::dot(y, y), glm::dot(z, z)));
+
+		WorldBounds world;
+		world.sphere = glm::vec4(glm::vec3(_model * glm::vec4(center, 1.0f)), _bounds.radius * std::sqrt(maxScaleSquared));
+		world.extents = glm::vec4(glm::abs(x) * extents.x + glm::abs(y) * extents.y + glm::abs(z) * extents.z, 0.0f);
+		return world;
+	}
+
+// ==============================================
+// Frustum
+// ==============================================
+
+	// Six planes facing into the frustum -- xyz is the unit normal, w the distance
+	struct Frustum
+	{
+		glm::vec4 planes[6];
+
+		// From projection * view, with Vulkan's 0 to 1 depth (Gribb & Hartmann)
+		static Frustum FromViewProjection(const glm::mat4& _viewProjection)
+		{
+			// glm is column major -- Row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+			glm::vec4 rows[4];
+			for (int i = 0; i < 4; i++)
+				rows[i] = glm::vec4(_viewProjection[0][i], _viewProjection[1][i], _viewProjection[2][i], _viewProjection[3][i]);
+
+			Frustum frustum;
+			frustum.planes[0] = rows[3] + rows[0];	// Left
+			frustum.planes[1] = rows[3] - rows[0];	// Right
+			frustum.planes[2] = rows[3] + rows[1];	// Bottom (top, after the projection's Y flip)
+			frustum.planes[3] = rows[3] - rows[1];	// Top
+			frustum.planes[4] = rows[2];			// Near
+			frustum.planes[5] = rows[3] - rows[2];	// Far
+
+			for (auto& plane : frustum.planes)
+				plane /= glm::length(glm::vec3(plane));
+			return frustum;
+		}
+	};
+
+	// Outside if it is fully behind any plane -- The box and the sphere each give a distance, the smaller is used
+	// Can keep bounds near the frustum's corners that are actually outside it
+	inline bool IsVisible(const Frustum& _frustum, const WorldBounds& _bounds)
+	{
+		for (const auto& plane : _frustum.planes)
+		{
+			// Same operation order as the vector paths, so all paths agree
+			float distance = plane.z * _bounds.sphere.z + (plane.y * _bounds.sphere.y + (plane.x * _bounds.sphere.x + plane.w));
+			float boxRadius = std::abs(plane.z) * _bounds.extents.z + (std::abs(plane.y) * _bounds.extents.y + std::abs(plane.x) * _bounds.extents.x);
+			if (distance + std::min(boxRadius, _bounds.sphere.w) < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	// For whole groups of bounds -- -1 outside, 0 crossing a plane, 1 inside every plane
+	inline int ClassifyBox(const Frustum& _frustum, const glm::vec3& _min, const glm::vec3& _max)
+	{
+		glm::vec3 center = (_min + _max) * 0.5f;
+		glm::vec3 extents = (_max - _min) * 0.5f;
+
+		int side = 1;
+		for (const auto& plane : _frustum.planes)
+		{
+			float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+			float radius = glm::dot(glm::abs(glm::vec3(plane)), extents);
+			if (distance + radius < 0.0f)
+				return -1;
+			if (distance - radius < 0.0f)
+				side = 0;
+		}
+		return side;
+	}
+
+// ==============================================
+// Culling
+// ==============================================
+
+namespace simd
+{
+	// Four bounds -> a bit per culled bound
+	inline int CullBounds4(const Frustum& _frustum, const WorldBounds* _bounds)
+	{
+		Float4 cx = Load4(&_bounds[0].sphere.x);
+		Float4 cy = Load4(&_bounds[1].sphere.x);
+		Float4 cz = Load4(&_bounds[2].sphere.x);
+		Float4 radius = Load4(&_bounds[3].sphere.x);
+		Transpose4(cx, cy, cz, radius);
+
+		Float4 ex = Load4(&_bounds[0].extents.x);
+		Float4 ey = Load4(&_bounds[1].extents.x);
+		Float4 ez = Load4(&_bounds[2].extents.x);
+		Float4 unused = Load4(&_bounds[3].extents.x);
+		Transpose4(ex, ey, ez, unused);
+
+		Float4 zero = Splat(0.0f);
+		Float4 outside = zero;
+		for (const auto& plane : _frustum.planes)
+		{
+			Float4 distance = MulAdd(Splat(plane.z), cz, MulAdd(Splat(plane.y), cy, MulAdd(Splat(plane.x), cx, Splat(plane.w))));
+			Float4 boxRadius = MulAdd(Splat(std::abs(plane.z)), ez, MulAdd(Splat(std::abs(plane.y)), ey, Mul(Splat(std::abs(plane.x)), ex)));
+			outside = Or(outside, Less(Add(distance, Min(boxRadius, radius)), zero));
+		}
+		return MoveMask(outside);
+	}
+
+#if defined(SKEL_SIMD_SSE)
+	// Eight bounds -> a bit per culled bound
+	// No FMA, so results match the scalar & four wide paths
+	SKEL_SIMD_TARGET_AVX2 inline int CullBounds8(const Frustum& _frustum, const WorldBounds* _bounds)
+	{
+		// One bound (sphere | extents) per load -- Bounds 0-3 go to the low lanes, 4-7 to the high
+		__m256 b[8];
+		for (int i = 0; i < 8; i++)
+			b[i] = _mm256_loadu_ps(&_bounds[i].sphere.x);
+
+		__m256 s0 = _mm256_permute2f128_ps(b[0], b[4], 0x20), e0 = _mm256_permute2f128_ps(b[0], b[4], 0x31);
+		__m256 s1 = _mm256_permute2f128_ps(b[1], b[5], 0x20), e1 = _mm256_permute2f128_ps(b[1], b[5], 0x31);
+		__m256 s2 = _mm256_permute2f128_ps(b[2], b[6], 0x20), e2 = _mm256_permute2f128_ps(b[2], b[6], 0x31);
+		__m256 s3 = _mm256_permute2f128_ps(b[3], b[7], 0x20), e3 = _mm256_permute2f128_ps(b[3], b[7], 0x31);
+
+		__m256 t0 = _mm256_unpacklo_ps(s0, s1);
+		__m256 t1 = _mm256_unpackhi_ps(s0, s1);
+		__m256 t2 = _mm256_unpacklo_ps(s2, s3);
+		__m256 t3 = _mm256_unpackhi_ps(s2, s3);
+		__m256 cx = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 cy = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+		__m256 cz = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 radius = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+		t0 = _mm256_unpacklo_ps(e0, e1);
+		t1 = _mm256_unpackhi_ps(e0, e1);
+		t2 = _mm256_unpacklo_ps(e2, e3);
+		t3 = _mm256_unpackhi_ps(e2, e3);
+		__m256 ex = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 ey = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+		__m256 ez = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+
+		__m256 zero = _mm256_setzero_ps();
+		__m256 outside = zero;
+		for (const auto& plane : _frustum.planes)
+		{
+			__m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), cx), _mm256_set1_ps(plane.w));
+			distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.y), cy), distance);
+			distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.z), cz), distance);
+
+			__m256 boxRadius = _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.x)), ex);
+			boxRadius = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::abs(plane.y)), ey), boxRadius);
+			boxRadius = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::abs(plane.z)), ez), boxRadius);
+
+			__m256 nearest = _mm256_add_ps(distance, _mm256_min_ps(boxRadius, radius));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(nearest, zero, _CMP_LT_OQ));
+		}
+		return _mm256_movemask_ps(outside);
+	}
+#endif
+
+	// Writes each bound's visibility -- Returns how many are visible
+	inline uint32_t CullBounds(const Frustum& _frustum, const WorldBounds* _bounds, uint32_t _count, Visibility* _out, Path _path = BestPath())
+	{
+		uint32_t visible = 0;
+		uint32_t i = 0;
+	#if defined(SKEL_SIMD_SSE)
+		if (_path == Path::Avx2)
+		{
+			for (; i + 8 <= _count; i += 8)
+			{
+				int culled = CullBounds8(_frustum, _bounds + i);
+				for (uint32_t j = 0; j < 8; j++)
+				{
+					_out[i + j].visible = (culled >> j) & 1 ? 0 : 1;
+					visible += _out[i + j].visible;
+				}
+			}
+		}
+	#endif
+		if (_path != Path::Scalar)
+		{
+			for (; i + 4 <= _count; i += 4)
+			{
+				int culled = CullBounds4(_frustum, _bounds + i);
+				for (uint32_t j = 0; j < 4; j++)
+				{
+					_out[i + j].visible = (culled >> j) & 1 ? 0 : 1;
+					visible += _out[i + j].visible;
+				}
+			}
+		}
+
+		for (; i < _count; i++)
+		{
+			_out[i].visible = IsVisible(_frustum, _bounds[i]) ? 1 : 0;
+			visible += _out[i].visible;
+		}
+		return visible;
+	}
+} // namespace simd
+
+} // namespace skel
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "Initializers.h"
+
+namespace skel
+{
+	// Pool usage counters for a descriptor allocator
+	struct DescriptorAllocatorStats
+	{
+		uint32_t poolsCreated = 0;
+		uint32_t poolResets = 0;
+		uint32_t setsAllocated = 0;	// Sets allocated from a pool
+		uint32_t setsRecycled = 0;	// Sets handed out again from the free list
+		uint32_t setsInUse = 0;
+		uint32_t setsFree = 0;
+	};
+
+	// Hands out descriptor sets of a single layout from a chain of fixed-size pools
+	// Released sets are kept and reused once every submission that could reference them has completed
+	// Sets are never freed individually, so the pools need no FREE_DESCRIPTOR_SET flag
+	struct DescriptorAllocator
+	{
+		struct RetiredSet
+		{
+			uint64_t value;	// Timeline value of the first submission after the release
+			VkDescriptorSet set;
+		};
+
+		VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		uint32_t setsPerPool = 1;
+
+		std::vector<VkDescriptorPool> pools;
+		uint32_t setsInCurrentPool = 0;
+
+		std::vector<VkDescriptorSet> freeSets;
+		std::vector<RetiredSet> retiredSets;
+		uint64_t valueStamp = 0;
+
+		DescriptorAllocatorStats stats;
+
+		// Derives the per-pool descriptor counts from the layout's bindings
+		void Create(VkDescriptorSetLayout _layout, const std::vector<VkDescriptorSetLayoutBinding>& _bindings, uint32_t _setsPerPool)
+		{
+			layout = _layout;
+			setsPerPool = _setsPerPool > 0 ? _setsPerPool : 1;
+
+			poolSizes.clear();
+			for (const auto& binding : _bindings)
+			{
+				bool merged = false;
+				for (auto& size : poolSizes)
+				{
+					if (size.type == binding.descriptorType)
+					{
+						size.descriptorCount += binding.descriptorCount * setsPerPool;
+						merged = true;
+						break;
+					}
+				}
+
+				if (!merged)
+					poolSizes.push_back(skel::initializers::DescriptorPoolSize(binding.descriptorType, binding.descriptorCount * setsPerPool));
+			}
+		}
+
+		// Returns a recycled set if one is available, otherwise allocates from the newest pool
+		VkDescriptorSet Allocate(VkDevice _device)
+		{
+			VkDescriptorSet set;
+
+			if (!freeSets.empty())
+			{
+				set = freeSets.back();
+				freeSets.pop_back();
+				stats.setsRecycled++;
+				stats.setsFree--;
+				stats.setsInUse++;
+				return set;
+			}
+
+			if (pools.empty() || setsInCurrentPool >= setsPerPool)
+				AddPool(_device);
+
+			VkDescriptorSetAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			allocInfo.descriptorPool = pools.back();
+			allocInfo.descriptorSetCount = 1;
+			allocInfo.pSetLayouts = &layout;
+
+			VkResult result = vkAllocateDescriptorSets(_device, &allocInfo, &set);
+			if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+			{
+				// Chain a fresh pool rather than growing -- Existing sets stay valid
+				AddPool(_device);
+				allocInfo.descriptorPool = pools.back();
+				result = vkAllocateDescriptorSets(_device, &allocInfo, &set);
+			}
+
+			if (result != VK_SUCCESS)
+				throw std::runtime_error("Failed to allocate a descriptor set");
+
+			setsInCurrentPool++;
+			stats.setsAllocated++;
+			stats.setsInUse++;
+			return set;
+		}
+
+		// Queues a set for reuse -- It returns to the free list when the next submission has completed
+		void Release(VkDescriptorSet _set)
+		{
+			if (_set == VK_NULL_HANDLE)
+				return;
+
+			retiredSets.push_back({ valueStamp, _set });
+			stats.setsInUse--;
+		}
+
+		// Called once per frame with the GPU timeline's completed value and the value the next submission signals
+		// Sets released before a submission that has completed can no longer be referenced by the GPU
+		void Recycle(uint64_t _completedValue, uint64_t _pendingValue)
+		{
+			valueStamp = _pendingValue;
+
+			uint32_t kept = 0;
+			for (uint32_t i = 0; i < static_cast<uint32_t>(retiredSets.size()); i++)
+			{
+				if (retiredSets[i].value <= _completedValue)
+				{
+					freeSets.push_back(retiredSets[i].set);
+					stats.setsFree++;
+				}
+				else
+					retiredSets[kept++] = retiredSets[i];
+			}
+			retiredSets.resize(kept);
+		}
+
+		void Cleanup(VkDevice _device)
+		{
+			for (const auto& pool : pools)
+				vkDestroyDescriptorPool(_device, pool, nullptr);
+
+			pools.clear();
+			freeSets.clear();
+			retiredSets.clear();
+			setsInCurrentPool = 0;
+		}
+
+	private:
+		void AddPool(VkDevice _device)
+		{
+			VkDescriptorPoolCreateInfo poolCreateInfo = {};
+			poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+			poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+			poolCreateInfo.pPoolSizes = poolSizes.data();
+			poolCreateInfo.maxSets = setsPerPool;
+
+			VkDescriptorPool pool;
+			if (vkCreateDescriptorPool(_device, &poolCreateInfo, nullptr, &pool) != VK_SUCCESS)
+				throw std::runtime_error("Failed to create descriptor pool");
+
+			pools.push_back(pool);
+			setsInCurrentPool = 0;
+			stats.poolsCreated++;
+		}
+	}; // DescriptorAllocator
+
+	// Descriptor sets that live for a single frame
+	// Every frame in flight owns a chain of pools that is reset in one call per pool once the frame completes
+	struct TransientDescriptorAllocator
+	{
+		struct FramePools
+		{
+			std::vector<VkDescriptorPool> pools;
+			uint32_t currentPool = 0;
+		};
+
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		uint32_t setsPerPool = 256;
+		std::vector<FramePools> frames;
+
+		DescriptorAllocatorStats stats;
+
+		// _poolSizes are the descriptor counts of a single pool
+		void Create(const std::vector<VkDescriptorPoolSize>& _poolSizes, uint32_t _frameCount, uint32_t _setsPerPool = 256)
+		{
+			poolSizes = _poolSizes;
+			setsPerPool = _setsPerPool;
+			frames.resize(_frameCount);
+		}
+
+		// Releases every set allocated for the frame
+		void Reset(VkDevice _device, uint32_t _frameIndex)
+		{
+			FramePools& frame = frames[_frameIndex];
+			for (uint32_t i = 0; i < static_cast<uint32_t>(frame.pools.size()) && i <= frame.currentPool; i++)
+			{
+				vkResetDescriptorPool(_device, frame.pools[i], 0);
+				stats.poolResets++;
+			}
+			frame.currentPool = 0;
+			stats.setsInUse = 0;
+		}
+
+		VkDescriptorSet Allocate(VkDevice _device, uint32_t _frameIndex, VkDescriptorSetLayout _layout)
+		{
+			FramePools& frame = frames[_frameIndex];
+			if (frame.pools.empty())
+				AddPool(_device, frame);
+
+			VkDescriptorSetAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			allocInfo.descriptorSetCount = 1;
+			allocInfo.pSetLayouts = &_layout;
+
+			VkDescriptorSet set;
+			VkResult result;
+			do
+			{
+				allocInfo.descriptorPool = frame.pools[frame.currentPool];
+				result = vkAllocateDescriptorSets(_device, &allocInfo, &set);
+
+				if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+				{
+					// Move on to the next pool in the chain, creating it if needed
+					frame.currentPool++;
+					if (frame.currentPool >= static_cast<uint32_t>(frame.pools.size()))
+						AddPool(_device, frame);
+				}
+				else if (result != VK_SUCCESS)
+					throw std::runtime_error("Failed to allocate a transient descriptor set");
+			} while (result != VK_SUCCESS);
+
+			stats.setsAllocated++;
+			stats.setsInUse++;
+			return set;
+		}
+
+		void Cleanup(VkDevice _device)
+		{
+			for (auto& frame : frames)
+			{
+				for (const auto& pool : frame.pools)
+					vkDestroyDescriptorPool(_device, pool, nullptr);
+				frame.pools.clear();
+				frame.currentPool = 0;
+			}
+		}
+
+	private:
+		void AddPool(VkDevice _device, FramePools& _frame)
+		{
+			VkDescriptorPoolCreateInfo poolCreateInfo = {};
+			poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+			poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+			poolCreateInfo.pPoolSizes = poolSizes.data();
+			poolCreateInfo.maxSets = setsPerPool;
+
+			VkDescriptorPool pool;
+			if (vkCreateDescriptorPool(_device, &poolCreateInfo, nullptr, &pool) != VK_SUCCESS)
+				throw std::runtime_error("Failed to create transient descriptor pool");
+
+			_frame.pools.push_back(pool);
+			stats.poolsCreated++;
+		}
+	}; // TransientDescriptorAllocator
+
+} // namespace skel
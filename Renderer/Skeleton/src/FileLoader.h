@@ -13,10 +13,12 @@
 #include "Mesh.h"
 #include "Texture.h"
 
-// Loads the object from disk
-// Returns a mesh built from the input file
-inline Mesh* LoadMesh(VulkanDevice* _device, const char* _directory)
+// Parses an OBJ file and removes duplicate vertices -- CPU only, no GPU resources are created
+// Returns a mesh without buffers
+inline Mesh* ParseMesh(const char* _directory)
 {
+	SKEL_PROFILE_FUNCTION();
+
 	// Load the mesh with Tinyobj
 	tinyobj::attrib_t attrib;
 	std::vector<tinyobj::shape_t> shapes;
@@ -63,35 +65,52 @@ inline Mesh* LoadMesh(VulkanDevice* _device, const char* _directory)
 		}
 	}
 
+	endMesh->ComputeBounds();
+	return endMesh;
+}
+
+// Creates the mesh's vertex and index buffers -- Nothing waits for the copies
+// Returns the timeline value that signals both copies' completion
+inline uint64_t UploadMesh(VulkanDevice* _device, Mesh* _mesh)
+{
+	SKEL_PROFILE_FUNCTION();
+
 	_device->CreateAndFillBuffer(
-		endMesh->vertices.data(),
-		sizeof(endMesh->vertices[0]) * static_cast<uint32_t>(endMesh->vertices.size()),
-		endMesh->vertexBuffer,
-		endMesh->vertexBufferMemory,
+		_mesh->vertices.data(),
+		sizeof(_mesh->vertices[0]) * static_cast<uint32_t>(_mesh->vertices.size()),
+		_mesh->vertexBuffer,
+		_mesh->vertexBufferMemory,
 		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
 		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
 	);
-	_device->CreateAndFillBuffer(
-		endMesh->indices.data(),
-		sizeof(endMesh->indices[0]) * static_cast<uint32_t>(endMesh->indices.size()),
-		endMesh->indexBuffer,
-		endMesh->indexBufferMemory,
+	return _device->CreateAndFillBuffer(
+		_mesh->indices.data(),
+		sizeof(_mesh->indices[0]) * static_cast<uint32_t>(_mesh->indices.size()),
+		_mesh->indexBuffer,
+		_mesh->indexBufferMemory,
 		VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
 		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
 	);
+}
 
+// Loads the object from disk
+// Returns a mesh built from the input file
+inline Mesh* LoadMesh(VulkanDevice* _device, const char* _directory)
+{
+	SKEL_PROFILE_FUNCTION();
+
+	Mesh* endMesh = ParseMesh(_directory);
+	UploadMesh(_device, endMesh);
 	return endMesh;
 }
 
-// Loads the input texture, and copies it to an image
-inline void LoadTextureToImage(VulkanDevice* _device, const std::string _directory, VkImage& _image, VkDeviceMemory& _imageMemory)
+// Creates a device-local image and copies RGBA8 pixels into it through a staging buffer -- Nothing waits for the copy
+// Returns the timeline value that signals the image is ready to sample
+inline uint64_t UploadTextureImage(VulkanDevice* _device, const void* _pixels, uint32_t _width, uint32_t _height, VkImage& _image, VkDeviceMemory& _imageMemory)
 {
-	int textureWidth, textureHeight, textureChannels;
-	stbi_uc* pixels = stbi_load(_directory.c_str(), &textureWidth, &textureHeight, &textureChannels, STBI_rgb_alpha);
-	VkDeviceSize imageSize = (uint64_t)textureWidth * (uint64_t)textureHeight * 4;
+	SKEL_PROFILE_FUNCTION();
 
-	if (!pixels)
-		throw std::runtime_error("Failed to load texture image");
+	VkDeviceSize imageSize = (uint64_t)_width * (uint64_t)_height * 4;
 
 	VkBuffer stagingBuffer;
 	VkDeviceMemory stagingBufferMemory;
@@ -103,13 +122,12 @@ inline void LoadTextureToImage(VulkanDevice* _device, const std::string _directo
 		stagingBufferMemory
 	);
 
-	_device->CopyDataToBufferMemory(pixels, (size_t)imageSize, stagingBufferMemory);
-	stbi_image_free(pixels);
+	_device->CopyDataToBufferMemory(_pixels, (size_t)imageSize, stagingBufferMemory);
 
 	skel::CreateImage(
 		_device,
-		(uint32_t)textureWidth,
-		(uint32_t)textureHeight,
+		_width,
+		_height,
 		//VK_FORMAT_R8G8B8A8_SRGB,
 		VK_FORMAT_R8G8B8A8_UNORM,
 		VK_IMAGE_TILING_OPTIMAL,
@@ -121,12 +139,28 @@ inline void LoadTextureToImage(VulkanDevice* _device, const std::string _directo
 
 	//TransitionImageLayout(_device, _image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 	skel::TransitionImageLayout(_device, _image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	skel::CopyBufferToImage(_device, stagingBuffer, _image, (uint32_t)textureWidth, (uint32_t)textureHeight);
+	uint64_t copied = skel::CopyBufferToImage(_device, stagingBuffer, _image, _width, _height);
 	//TransitionImageLayout(_device, _image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-	skel::TransitionImageLayout(_device, _image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	uint64_t ready = skel::TransitionImageLayout(_device, _image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	// Submissions are ordered on the timeline -- Free the staging buffer once the copy completes
+	_device->DestroyBufferAfter(copied, stagingBuffer, stagingBufferMemory);
+	return ready;
+}
+
+// Loads the input texture, and copies it to an image
+inline void LoadTextureToImage(VulkanDevice* _device, const std::string _directory, VkImage& _image, VkDeviceMemory& _imageMemory)
+{
+	SKEL_PROFILE_FUNCTION();
+
+	int textureWidth, textureHeight, textureChannels;
+	stbi_uc* pixels = stbi_load(_directory.c_str(), &textureWidth, &textureHeight, &textureChannels, STBI_rgb_alpha);
 
-	vkDestroyBuffer(_device->logicalDevice, stagingBuffer, nullptr);
-	vkFreeMemory(_device->logicalDevice, stagingBufferMemory, nullptr);
+	if (!pixels)
+		throw std::runtime_error("Failed to load texture image");
+
+	UploadTextureImage(_device, pixels, (uint32_t)textureWidth, (uint32_t)textureHeight, _image, _imageMemory);
+	stbi_image_free(pixels);
 }
 
 // Creates an image, imageView, and sampler
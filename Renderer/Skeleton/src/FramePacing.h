@@ -0,0 +1,320 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <vector>
+#include <cstdio>
+
+#include <vulkan/vulkan.h>
+
+#include "VulkanDevice.h"
+
+namespace skel
+{
+	// How frames are queued and presented -- Changed at runtime with Renderer::SetFramePacing
+	struct FramePacingSettings
+	{
+		uint32_t framesInFlight = 2;								// 1 - 3
+		VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;	// Falls back to FIFO when unsupported
+		bool lowLatency = false;									// Delays input sampling until just before the GPU is free
+	};
+
+	// Returns a printable name for the present modes FramePacingSettings accepts
+	inline const char* PresentModeName(VkPresentModeKHR _mode)
+	{
+		switch (_mode)
+		{
+		case VK_PRESENT_MODE_IMMEDIATE_KHR:		return "IMMEDIATE";
+		case VK_PRESENT_MODE_MAILBOX_KHR:		return "MAILBOX";
+		case VK_PRESENT_MODE_FIFO_KHR:			return "FIFO";
+		case VK_PRESENT_MODE_FIFO_RELAXED_KHR:	return "FIFO_RELAXED";
+		default:								return "UNKNOWN";
+		}
+	}
+
+	// Input-to-present latency of the frames sampled under one combination of settings
+	struct PacingModeLatency
+	{
+		VkPresentModeKHR presentMode;	// The swapchain's, which may differ from the one asked for
+		uint32_t framesInFlight;
+		bool lowLatency;
+		uint32_t frames;
+		float total;					// Milliseconds
+		float worst;
+	};
+
+	// Measures GPU time, CPU time, and input-to-present latency
+	// In low-latency mode it sleeps before input is sampled so the frame is submitted as the GPU becomes free
+	struct FramePacer
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+
+		static const uint32_t maxFramesInFlight = 3;
+
+		FramePacingSettings settings;
+		VkPresentModeKHR activePresentMode = VK_PRESENT_MODE_MAX_ENUM_KHR;	// Set with the swapchain -- Stays MAX_ENUM offscreen
+
+		// Two timestamps (start, end) per frame in flight
+		VkQueryPool timestampPool = VK_NULL_HANDLE;
+		float timestampPeriod = 1.0f;	// Nanoseconds per tick
+		bool timestampsSupported = false;
+
+		// Exponential moving averages in milliseconds
+		float smoothing = 0.1f;
+		float gpuTime = 0.0f;
+		float cpuTime = 0.0f;
+		float latency = 0.0f;			// Input sampled -> presented (or GPU complete without present wait)
+		float sleepTime = 0.0f;
+		float sleepMargin = 0.5f;		// Slack left for scheduling jitter
+
+		// Every combination of settings used so far -- See PrintLatencyReport
+		std::vector<PacingModeLatency> modeLatencies;
+
+		// Per frame slot
+		Clock::time_point inputSampled[maxFramesInFlight];
+		uint32_t inputMode[maxFramesInFlight] = {};	// Index in modeLatencies
+		bool frameSubmitted[maxFramesInFlight] = {};
+		Clock::time_point predictedGpuEnd;
+
+		// Compiled out with the vendored 1.2.154 headers, which predate VK_KHR_present_wait -- Needs newer headers to build
+#if defined(VK_KHR_present_wait) && defined(VK_KHR_present_id)
+		PFN_vkWaitForPresentKHR vkWaitForPresent = nullptr;
+		uint64_t lastPresentId = 0;
+		Clock::time_point lastPresentInput;
+		uint32_t lastPresentMode = 0;
+#endif
+
+		void Create(VulkanDevice* _device)
+		{
+			timestampPeriod = _device->properties.limits.timestampPeriod;
+			timestampsSupported = _device->properties.limits.timestampComputeAndGraphics
+				&& _device->queueProperties[_device->queueFamilyIndices.graphics].timestampValidBits > 0;
+
+			if (timestampsSupported)
+			{
+				VkQueryPoolCreateInfo createInfo = {};
+				createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+				createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+				createInfo.queryCount = 2 * maxFramesInFlight;
+
+				if (vkCreateQueryPool(_device->logicalDevice, &createInfo, nullptr, &timestampPool) != VK_SUCCESS)
+					throw std::runtime_error("Failed to create frame timestamp query pool");
+			}
+
+#if defined(VK_KHR_present_wait) && defined(VK_KHR_present_id)
+			if (_device->presentWaitEnabled)
+				vkWaitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(_device->logicalDevice, "vkWaitForPresentKHR"));
+#endif
+
+			predictedGpuEnd = Clock::now();
+		}
+
+		void Cleanup(VkDevice _device)
+		{
+			if (timestampPool != VK_NULL_HANDLE)
+				vkDestroyQueryPool(_device, timestampPool, nullptr);
+			timestampPool = VK_NULL_HANDLE;
+		}
+
+		// Clamps settings to what the pacer supports
+		static FramePacingSettings Validate(FramePacingSettings _settings)
+		{
+			_settings.framesInFlight = std::max(1u, std::min(_settings.framesInFlight, maxFramesInFlight));
+			return _settings;
+		}
+
+		// Called once the frame slot's fence has signaled -- Its timestamps are available
+		void FrameCompleted(VkDevice _device, uint32_t _frameIndex)
+		{
+			if (!frameSubmitted[_frameIndex])
+				return;
+			frameSubmitted[_frameIndex] = false;
+
+			if (timestampsSupported)
+			{
+				uint64_t timestamps[2];
+				VkResult result = vkGetQueryPoolResults(
+					_device,
+					timestampPool,
+					2 * _frameIndex,
+					2,
+					sizeof(timestamps),
+					timestamps,
+					sizeof(uint64_t),
+					VK_QUERY_RESULT_64_BIT
+					);
+
+				if (result == VK_SUCCESS)
+					Accumulate(gpuTime, (timestamps[1] - timestamps[0]) * timestampPeriod / 1000000.0f);
+			}
+
+			// Without present wait the fence is the closest observable point to presentation
+			if (!MeasuresPresent(settings.lowLatency))
+				RecordLatency(Milliseconds(Clock::now() - inputSampled[_frameIndex]), inputMode[_frameIndex]);
+		}
+
+		// Blocks until the previous frame is on screen -- Bounds the present queue to one frame
+		void WaitForPresent(VkDevice _device, VkSwapchainKHR _swapchain)
+		{
+#if defined(VK_KHR_present_wait) && defined(VK_KHR_present_id)
+			if (vkWaitForPresent == nullptr || lastPresentId == 0)
+				return;
+
+			// Time out after a second so a lost swapchain can't hang the application
+			if (vkWaitForPresent(_device, _swapchain, lastPresentId, 1000000000ull) == VK_SUCCESS)
+				RecordLatency(Milliseconds(Clock::now() - lastPresentInput), lastPresentMode);
+#else
+			(void)_device;
+			(void)_swapchain;
+#endif
+		}
+
+		// Present wait is only used in low-latency mode -- Other modes measure up to the GPU finishing the frame
+		bool MeasuresPresent(bool _lowLatency) const
+		{
+#if defined(VK_KHR_present_wait) && defined(VK_KHR_present_id)
+			return _lowLatency && vkWaitForPresent != nullptr;
+#else
+			(void)_lowLatency;
+			return false;
+#endif
+		}
+
+		// Prints the average and worst latency of every combination of settings used so far
+		void PrintLatencyReport() const
+		{
+			std::printf("Input-to-present latency by pacing mode:\n");
+			for (const auto& mode : modeLatencies)
+			{
+				if (mode.frames == 0)
+					continue;
+
+				std::printf("    %-12s %u in flight, low latency %-3s : avg %6.2f ms, worst %6.2f ms over %u frames (to %s)\n",
+					mode.presentMode == VK_PRESENT_MODE_MAX_ENUM_KHR ? "OFFSCREEN" : PresentModeName(mode.presentMode),
+					mode.framesInFlight, mode.lowLatency ? "on" : "off", mode.total / mode.frames, mode.worst, mode.frames,
+					MeasuresPresent(mode.lowLatency) ? "present" : "GPU done");
+			}
+		}
+
+		// Sleeps until the CPU's work for the next frame would finish as the GPU finishes its current work
+		void SleepUntilInput()
+		{
+			Clock::time_point wake = predictedGpuEnd
+				- std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float, std::milli>(cpuTime + sleepMargin));
+
+			Clock::time_point now = Clock::now();
+			sleepTime = wake > now ? Milliseconds(wake - now) : 0.0f;
+			if (sleepTime > 0.0f)
+				std::this_thread::sleep_until(wake);
+		}
+
+		// Records when the frame's input was sampled, and under which settings
+		void InputSampled(uint32_t _frameIndex)
+		{
+			inputSampled[_frameIndex] = Clock::now();
+			inputMode[_frameIndex] = ModeIndex();
+		}
+
+		// The frame being prepared in _from is recorded in _to instead
+		void MoveFrame(uint32_t _from, uint32_t _to)
+		{
+			inputSampled[_to] = inputSampled[_from];
+			inputMode[_to] = inputMode[_from];
+		}
+
+		// Resets the frame slot's queries -- Recorded before any other command
+		void BeginFrame(VkCommandBuffer _commandBuffer, uint32_t _frameIndex)
+		{
+			if (!timestampsSupported)
+				return;
+
+			vkCmdResetQueryPool(_commandBuffer, timestampPool, 2 * _frameIndex, 2);
+			vkCmdWriteTimestamp(_commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, 2 * _frameIndex);
+		}
+
+		void EndFrame(VkCommandBuffer _commandBuffer, uint32_t _frameIndex)
+		{
+			if (!timestampsSupported)
+				return;
+
+			vkCmdWriteTimestamp(_commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, 2 * _frameIndex + 1);
+		}
+
+		// Called right after the frame is submitted
+		// The GPU starts this frame once it finishes the previous one, and is busy for about gpuTime
+		void FrameSubmitted(uint32_t _frameIndex)
+		{
+			Clock::time_point now = Clock::now();
+			Accumulate(cpuTime, Milliseconds(now - inputSampled[_frameIndex]));
+
+			Clock::time_point gpuStart = std::max(now, predictedGpuEnd);
+			predictedGpuEnd = gpuStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float, std::milli>(gpuTime));
+			frameSubmitted[_frameIndex] = true;
+		}
+
+		// Present IDs belong to a swapchain -- Forget the last one when it is replaced
+		void SwapchainRecreated()
+		{
+#if defined(VK_KHR_present_wait) && defined(VK_KHR_present_id)
+			lastPresentId = 0;
+#endif
+		}
+
+#if defined(VK_KHR_present_wait) && defined(VK_KHR_present_id)
+		// Chains a present ID onto the present info -- _presentId must outlive the present call
+		void AttachPresentId(VkPresentInfoKHR& _presentInfo, VkPresentIdKHR& _presentId, uint64_t& _id, uint64_t _frameNumber, uint32_t _frameIndex)
+		{
+			if (vkWaitForPresent == nullptr)
+				return;
+
+			// IDs must increase for every present to the swapchain -- 0 means "no ID"
+			_id = _frameNumber + 1;
+			_presentId = {};
+			_presentId.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+			_presentId.swapchainCount = 1;
+			_presentId.pPresentIds = &_id;
+			_presentInfo.pNext = &_presentId;
+
+			lastPresentId = _id;
+			lastPresentInput = inputSampled[_frameIndex];
+			lastPresentMode = inputMode[_frameIndex];
+		}
+#endif
+
+	private:
+		uint32_t ModeIndex()
+		{
+			for (uint32_t i = 0; i < static_cast<uint32_t>(modeLatencies.size()); i++)
+			{
+				const PacingModeLatency& mode = modeLatencies[i];
+				if (mode.presentMode == activePresentMode && mode.framesInFlight == settings.framesInFlight && mode.lowLatency == settings.lowLatency)
+					return i;
+			}
+
+			modeLatencies.push_back({ activePresentMode, settings.framesInFlight, settings.lowLatency, 0, 0.0f, 0.0f });
+			return static_cast<uint32_t>(modeLatencies.size()) - 1;
+		}
+
+		void RecordLatency(float _sample, uint32_t _mode)
+		{
+			Accumulate(latency, _sample);
+
+			PacingModeLatency& mode = modeLatencies[_mode];
+			mode.frames++;
+			mode.total += _sample;
+			mode.worst = std::max(mode.worst, _sample);
+		}
+
+		void Accumulate(float& _average, float _sample)
+		{
+			_average = _average == 0.0f ? _sample : _average + (_sample - _average) * smoothing;
+		}
+
+		static float Milliseconds(Clock::duration _duration)
+		{
+			return std::chrono::duration<float, std::milli>(_duration).count();
+		}
+	}; // FramePacer
+
+} // namespace skel
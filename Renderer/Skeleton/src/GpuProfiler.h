@@ -0,0 +1,264 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+
+#include <vulkan/vulkan.h>
+
+#include "VulkanDevice.h"
+#include "FramePacing.h"
+
+namespace skel
+{
+	// One timed GPU range of a frame
+	struct GpuProfileZone
+	{
+		std::string name;
+		const char* category;	// "frame", "pass", "pipeline", or "batch"
+		uint32_t depth;			// Nesting level -- The frame is 0
+		double start;			// Milliseconds since the frame began on the GPU
+		double duration;		// Milliseconds
+	};
+
+	// Times nested GPU ranges with timestamp queries -- One query pool per frame slot
+	// A slot's results are read when the slot is reused, so they arrive a few frames late and never stall
+	struct GpuProfiler
+	{
+		static const uint32_t maxFramesInFlight = FramePacer::maxFramesInFlight;
+		static const uint32_t maxQueriesPerFrame = 1024;	// Zones past the limit are dropped
+
+		struct ZoneRecord
+		{
+			std::string name;
+			const char* category;
+			uint32_t depth;
+			uint32_t beginQuery;
+			uint32_t endQuery;
+		};
+
+		struct FrameSlot
+		{
+			VkQueryPool queryPool = VK_NULL_HANDLE;
+			uint32_t queryCount = 0;
+			uint64_t frameNumber = 0;
+			bool pending = false;	// Recorded, but not yet read back
+			std::vector<ZoneRecord> zones;
+		};
+
+		bool enabled = true;
+		bool supported = false;
+		float timestampPeriod = 1.0f;	// Nanoseconds per tick
+		uint64_t timestampMask = ~0ull;
+		VkDevice device = VK_NULL_HANDLE;
+
+		FrameSlot slots[maxFramesInFlight];
+		uint32_t activeSlot = 0;
+		std::vector<uint32_t> openZones;	// Indices into the active slot's zones
+
+		// The most recently read-back frame
+		std::vector<GpuProfileZone> results;
+		uint64_t resultsFrame = 0;
+
+		// Chrome trace capture
+		uint32_t captureFramesLeft = 0;
+		std::string capturePath;
+		std::vector<GpuProfileZone> captureEvents;	// Starts are relative to the first captured frame
+		uint64_t captureBaseTicks = 0;
+		bool captureStarted = false;
+
+		void Create(VulkanDevice* _device)
+		{
+			device = _device->logicalDevice;
+			timestampPeriod = _device->properties.limits.timestampPeriod;
+
+			uint32_t validBits = _device->queueProperties[_device->queueFamilyIndices.graphics].timestampValidBits;
+			supported = _device->properties.limits.timestampComputeAndGraphics && validBits > 0;
+			timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+			if (!supported)
+				return;
+
+			VkQueryPoolCreateInfo createInfo = {};
+			createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			createInfo.queryCount = maxQueriesPerFrame;
+
+			for (auto& slot : slots)
+			{
+				if (vkCreateQueryPool(device, &createInfo, nullptr, &slot.queryPool) != VK_SUCCESS)
+					throw std::runtime_error("Failed to create GPU profiler query pool");
+				slot.zones.reserve(maxQueriesPerFrame / 2);
+			}
+		}
+
+		void Cleanup()
+		{
+			for (auto& slot : slots)
+			{
+				if (slot.queryPool != VK_NULL_HANDLE)
+					vkDestroyQueryPool(device, slot.queryPool, nullptr);
+				slot.queryPool = VK_NULL_HANDLE;
+			}
+		}
+
+		// Reads back the slot's previous frame, then starts recording a new one
+		// The slot's previous submission must be complete -- Recorded before any other profiled command
+		void BeginFrame(VkCommandBuffer _commandBuffer, uint32_t _slot, uint64_t _frameNumber)
+		{
+			if (!supported || !enabled)
+				return;
+
+			activeSlot = _slot;
+			FrameSlot& slot = slots[_slot];
+			if (slot.pending)
+				Collect(slot);
+
+			slot.frameNumber = _frameNumber;
+			slot.queryCount = 0;
+			slot.zones.clear();
+			openZones.clear();
+			slot.pending = true;
+
+			vkCmdResetQueryPool(_commandBuffer, slot.queryPool, 0, maxQueriesPerFrame);
+			BeginZone(_commandBuffer, "Frame", "frame");
+		}
+
+		void EndFrame(VkCommandBuffer _commandBuffer)
+		{
+			if (!supported || !enabled)
+				return;
+
+			while (!openZones.empty())
+				EndZone(_commandBuffer);
+		}
+
+		// Zones nest -- Every BeginZone needs a matching EndZone in the same command buffer
+		void BeginZone(VkCommandBuffer _commandBuffer, const std::string& _name, const char* _category)
+		{
+			if (!supported || !enabled)
+				return;
+
+			FrameSlot& slot = slots[activeSlot];
+			if (slot.queryCount + 2 > maxQueriesPerFrame)
+			{
+				// Still pushed so EndZone stays balanced
+				openZones.push_back(UINT32_MAX);
+				return;
+			}
+
+			openZones.push_back(static_cast<uint32_t>(slot.zones.size()));
+			slot.zones.push_back({ _name, _category, static_cast<uint32_t>(openZones.size()) - 1, slot.queryCount, slot.queryCount + 1 });
+			vkCmdWriteTimestamp(_commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, slot.queryPool, slot.queryCount);
+			slot.queryCount += 2;
+		}
+
+		void EndZone(VkCommandBuffer _commandBuffer)
+		{
+			if (!supported || !enabled || openZones.empty())
+				return;
+
+			uint32_t zone = openZones.back();
+			openZones.pop_back();
+			if (zone == UINT32_MAX)
+				return;
+
+			FrameSlot& slot = slots[activeSlot];
+			vkCmdWriteTimestamp(_commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, slot.queryPool, slot.zones[zone].endQuery);
+		}
+
+		// Records the next _frames read-back frames, then writes them to _path as a Chrome trace (chrome://tracing)
+		void CaptureTrace(const char* _path, uint32_t _frames)
+		{
+			capturePath = _path;
+			captureFramesLeft = _frames;
+			captureEvents.clear();
+			captureStarted = false;
+		}
+
+		// Writes the events in the Chrome trace event format -- Times are in microseconds
+		static void WriteChromeTrace(const char* _path, const std::vector<GpuProfileZone>& _events)
+		{
+			std::ofstream file(_path, std::ios::out | std::ios::trunc);
+			if (!file.is_open())
+			{
+				std::printf("Failed to write GPU trace to %s\n", _path);
+				return;
+			}
+
+			file << "{\"traceEvents\":[\n";
+			for (size_t i = 0; i < _events.size(); i++)
+			{
+				const GpuProfileZone& e = _events[i];
+				file << "{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category
+					<< "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << e.start * 1000.0
+					<< ",\"dur\":" << e.duration * 1000.0 << "}"
+					<< (i + 1 < _events.size() ? ",\n" : "\n");
+			}
+			file << "],\"displayTimeUnit\":\"ms\",\"otherData\":{\"source\":\"GPU timestamps\"}}\n";
+		}
+
+	private:
+		void Collect(FrameSlot& _slot)
+		{
+			_slot.pending = false;
+			if (_slot.queryCount == 0)
+				return;
+
+			// No wait flag -- The slot's frame has completed, anything else is skipped rather than waited on
+			uint64_t timestamps[maxQueriesPerFrame];
+			VkResult result = vkGetQueryPoolResults(
+				device,
+				_slot.queryPool,
+				0,
+				_slot.queryCount,
+				sizeof(timestamps),
+				timestamps,
+				sizeof(uint64_t),
+				VK_QUERY_RESULT_64_BIT
+				);
+			if (result != VK_SUCCESS || _slot.frameNumber < resultsFrame)
+				return;
+
+			uint64_t frameStart = timestamps[_slot.zones[0].beginQuery] & timestampMask;
+
+			results.clear();
+			for (const auto& zone : _slot.zones)
+			{
+				uint64_t begin = timestamps[zone.beginQuery] & timestampMask;
+				uint64_t end = timestamps[zone.endQuery] & timestampMask;
+				results.push_back({ zone.name, zone.category, zone.depth, Milliseconds(begin - frameStart), Milliseconds(end - begin) });
+			}
+			resultsFrame = _slot.frameNumber;
+
+			if (captureFramesLeft == 0)
+				return;
+
+			if (!captureStarted)
+			{
+				captureBaseTicks = frameStart;
+				captureStarted = true;
+			}
+
+			double offset = Milliseconds(frameStart - captureBaseTicks);
+			for (auto zone : results)
+			{
+				zone.start += offset;
+				captureEvents.push_back(zone);
+			}
+
+			if (--captureFramesLeft == 0)
+			{
+				WriteChromeTrace(capturePath.c_str(), captureEvents);
+				std::printf("GPU trace written to %s\n", capturePath.c_str());
+				captureEvents.clear();
+			}
+		}
+
+		double Milliseconds(uint64_t _ticks)
+		{
+			return static_cast<double>(_ticks) * timestampPeriod / 1000000.0;
+		}
+	}; // GpuProfiler
+
+} // namespace skel
@@ -83,6 +83,19 @@ namespace skel
 			return createInfo;
 		}
 
+		inline VkPushConstantRange PushConstantRange(
+			VkShaderStageFlags _stages,
+			uint32_t _size,
+			uint32_t _offset = 0
+			)
+		{
+			VkPushConstantRange range = {};
+			range.stageFlags = _stages;
+			range.size = _size;
+			range.offset = _offset;
+			return range;
+		}
+
 		inline VkGraphicsPipelineCreateInfo GraphicsPipelineCreateInfo(
 			VkPipelineLayout _layout,
 			VkRenderPass _renderpass,
@@ -103,7 +116,7 @@ namespace skel
 		)
 		{
 			VkComputePipelineCreateInfo createInfo = {};
-			createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+			createInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
 			createInfo.layout = _layout;
 			createInfo.flags = _flags;
 			return createInfo;
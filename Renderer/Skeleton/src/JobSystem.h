@@ -0,0 +1,441 @@
+#pragma once
+
+// Work-stealing job system -- One worker per extra core (at least one), each with its own deque
+//   skel::jobs::Counter counter;
+//   skel::jobs::Run([&]() { ... }, &counter);	Queued on this thread, may be stolen by any other
+//   skel::jobs::Wait(counter);					Runs queued jobs until every job on the counter is done
+//   skel::jobs::ParallelFor(count, [&](uint32_t _i) { ... });
+//   skel::jobs::RunBackground([=]() { ... });	Only run by workers -- For blocking work like file reads
+//
+// The thread that first touches the scheduler is thread 0 (the main thread, see SkeletonApplication::Initialize)
+// Workers are 1..ThreadCount()-1 -- ThreadIndex() can index per-thread pools and arenas
+// Other threads may call everything too, but their jobs run inline
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <deque>
+#include <type_traits>
+#include <new>
+#include <cstdint>
+
+namespace skel
+{
+namespace jobs
+{
+	// Jobs added to a counter while running one of its jobs keep it above zero -- A parent is done once its children are
+	struct Counter
+	{
+		std::atomic<uint32_t> pending{ 0 };
+
+		bool Done() const { return pending.load(std::memory_order_acquire) == 0; }
+	};
+
+	// 128 bytes -- The function is stored inline, so it must be trivially copyable and fit in `data`
+	struct Job
+	{
+		void (*function)(const void*) = nullptr;
+		Counter* counter = nullptr;
+		std::atomic<uint32_t> free{ 1 };	// Set once the job has run, by whichever thread ran it
+		alignas(16) uint8_t data[96];
+	};
+
+	static const uint32_t invalidThread = UINT32_MAX;
+
+// ==============================================
+// Deque
+// ==============================================
+
+	// Chase-Lev deque -- The owner pushes and pops the bottom, any thread steals the top
+	// Fixed capacity: Push fails when full, and the caller runs the job itself
+	class WorkStealingDeque
+	{
+	public:
+		static const int64_t capacity = 4096;	// Power of two
+
+		WorkStealingDeque() : jobs(new std::atomic<Job*>[capacity]) {}
+
+		// Owner only
+		bool Push(Job* _job)
+		{
+			int64_t b = bottom.load(std::memory_order_relaxed);
+			int64_t t = top.load(std::memory_order_acquire);
+			if (b - t >= capacity)
+				return false;
+
+			// Released with the bottom, so a thief that sees the new bottom sees the job
+			jobs[b & (capacity - 1)].store(_job, std::memory_order_relaxed);
+			bottom.store(b + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Owner only -- Newest first, while its data is still in cache
+		Job* Pop()
+		{
+			int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+			bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t t = top.load(std::memory_order_relaxed);
+
+			if (t > b)
+			{
+				bottom.store(b + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			Job* job = jobs[b & (capacity - 1)].load(std::memory_order_relaxed);
+			if (t == b)
+			{
+				// The last job -- Thieves may be racing for it
+				if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+					job = nullptr;
+				bottom.store(b + 1, std::memory_order_relaxed);
+			}
+			return job;
+		}
+
+		// Any thread -- Oldest first, usually the biggest piece of work
+		Job* Steal()
+		{
+			int64_t t = top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t b = bottom.load(std::memory_order_acquire);
+			if (t >= b)
+				return nullptr;
+
+			Job* job = jobs[t & (capacity - 1)].load(std::memory_order_relaxed);
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				return nullptr;
+			return job;
+		}
+
+	private:
+		// On separate cache lines -- Thieves write the top, the owner writes the bottom
+		std::atomic<int64_t> top{ 0 };
+		uint8_t padding[56];
+		std::atomic<int64_t> bottom{ 0 };
+		std::unique_ptr<std::atomic<Job*>[]> jobs;
+	};
+
+// ==============================================
+// Scheduler
+// ==============================================
+
+	inline uint32_t& LocalThreadIndex()
+	{
+		static thread_local uint32_t index = invalidThread;
+		return index;
+	}
+
+	class Scheduler
+	{
+	public:
+		static const uint32_t jobsPerThread = 4096;	// Ring of job slots, reused once their jobs have run
+
+		Scheduler()
+		{
+			// At least one worker, so background jobs never run on the thread that queued them
+			coreCount = std::max(1u, std::thread::hardware_concurrency());
+			threadCount = std::max(2u, coreCount);
+			threads.reserve(threadCount);
+			for (uint32_t i = 0; i < threadCount; i++)
+				threads.emplace_back(new ThreadState());
+
+			LocalThreadIndex() = 0;
+			for (uint32_t i = 1; i < threadCount; i++)
+				workers.emplace_back([this, i]() { WorkerLoop(i); });
+		}
+
+		~Scheduler()
+		{
+			{
+				std::lock_guard<std::mutex> lock(sleepMutex);
+				quit.store(true);
+			}
+			wake.notify_all();
+			for (auto& worker : workers)
+				worker.join();
+		}
+
+		Scheduler(const Scheduler&) = delete;
+		Scheduler& operator=(const Scheduler&) = delete;
+
+		uint32_t ThreadCount() const { return threadCount; }
+		uint32_t CoreCount() const { return coreCount; }
+
+		// Queues _function on this thread's deque -- Runs it right away from unknown threads, or when the deque is full
+		template<typename F>
+		void Run(const F& _function, Counter* _counter)
+		{
+			static_assert(std::is_trivially_copyable<F>::value, "Jobs are copied as bytes -- Capture by reference or value of trivial types");
+			static_assert(sizeof(F) <= sizeof(Job::data) && alignof(F) <= 16, "Job function too large -- Capture by reference");
+
+			uint32_t index = LocalThreadIndex();
+			Job* job = index == invalidThread ? nullptr : Allocate(*threads[index]);
+			if (job == nullptr)
+			{
+				_function();
+				return;
+			}
+
+			new (job->data) F(_function);
+			job->function = [](const void* _data) { (*static_cast<const F*>(_data))(); };
+			job->counter = _counter;
+			if (_counter != nullptr)
+				_counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+			if (!threads[index]->deque.Push(job))
+			{
+				Execute(job);
+				return;
+			}
+
+			queued.fetch_add(1);
+			if (sleeping.load() > 0)
+			{
+				std::lock_guard<std::mutex> lock(sleepMutex);
+				wake.notify_one();
+			}
+		}
+
+		// Queues _function where only workers look, after their own and stolen jobs -- Waits never pick it up,
+		// so a wait on the main thread can't get stuck behind a file read
+		template<typename F>
+		void RunBackground(const F& _function, Counter* _counter)
+		{
+			static_assert(std::is_trivially_copyable<F>::value, "Jobs are copied as bytes -- Capture by reference or value of trivial types");
+			static_assert(sizeof(F) <= sizeof(Job::data) && alignof(F) <= 16, "Job function too large -- Capture by reference");
+
+			uint32_t index = LocalThreadIndex();
+			Job* job = index == invalidThread ? nullptr : Allocate(*threads[index]);
+			if (job == nullptr)
+			{
+				_function();
+				return;
+			}
+
+			new (job->data) F(_function);
+			job->function = [](const void* _data) { (*static_cast<const F*>(_data))(); };
+			job->counter = _counter;
+			if (_counter != nullptr)
+				_counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+			{
+				std::lock_guard<std::mutex> lock(backgroundMutex);
+				background.push_back(job);
+			}
+
+			queued.fetch_add(1);
+			if (sleeping.load() > 0)
+			{
+				std::lock_guard<std::mutex> lock(sleepMutex);
+				wake.notify_one();
+			}
+		}
+
+		// Runs other jobs until the counter's are done -- Never sleeps, so a waiting thread keeps its core busy
+		void Wait(const Counter& _counter)
+		{
+			uint32_t index = LocalThreadIndex();
+			while (!_counter.Done())
+			{
+				Job* job = index == invalidThread ? nullptr : FindJob(index, false);
+				if (job != nullptr)
+					Execute(job);
+				else
+					std::this_thread::yield();
+			}
+		}
+
+	private:
+		struct ThreadState
+		{
+			WorkStealingDeque deque;
+			std::unique_ptr<Job[]> jobs{ new Job[jobsPerThread] };
+			uint32_t next = 0;
+			uint32_t random = 0;
+		};
+
+		// The next free slot in the thread's ring -- Null if a whole lap is still queued or running
+		Job* Allocate(ThreadState& _thread)
+		{
+			for (uint32_t i = 0; i < jobsPerThread; i++)
+			{
+				Job* job = &_thread.jobs[_thread.next++ & (jobsPerThread - 1)];
+				if (job->free.load(std::memory_order_acquire) != 0)
+				{
+					job->free.store(0, std::memory_order_relaxed);
+					return job;
+				}
+			}
+			return nullptr;
+		}
+
+		void Execute(Job* _job)
+		{
+			_job->function(_job->data);
+			Counter* counter = _job->counter;
+			_job->free.store(1, std::memory_order_release);
+			if (counter != nullptr)
+				counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+		}
+
+		// This thread's newest job, or another thread's oldest, or the oldest background job
+		Job* FindJob(uint32_t _index, bool _background)
+		{
+			ThreadState& thread = *threads[_index];
+			Job* job = thread.deque.Pop();
+			if (job == nullptr && threadCount > 1)
+			{
+				// Victims in a random order, so thieves spread out
+				thread.random = thread.random * 1664525u + 1013904223u;
+				uint32_t first = thread.random >> 8;
+				for (uint32_t i = 0; i < threadCount && job == nullptr; i++)
+				{
+					uint32_t victim = (first + i) % threadCount;
+					if (victim != _index)
+						job = threads[victim]->deque.Steal();
+				}
+			}
+
+			if (job == nullptr && _background)
+			{
+				std::lock_guard<std::mutex> lock(backgroundMutex);
+				if (!background.empty())
+				{
+					job = background.front();
+					background.pop_front();
+				}
+			}
+
+			if (job != nullptr)
+				queued.fetch_sub(1);
+			return job;
+		}
+
+		void WorkerLoop(uint32_t _index)
+		{
+			LocalThreadIndex() = _index;
+			threads[_index]->random = _index * 2654435761u;
+
+			while (!quit.load(std::memory_order_relaxed))
+			{
+				Job* job = FindJob(_index, true);
+				if (job != nullptr)
+				{
+					Execute(job);
+					continue;
+				}
+
+				// Nothing to steal -- Sleep until a job is queued anywhere
+				std::unique_lock<std::mutex> lock(sleepMutex);
+				sleeping.fetch_add(1);
+				wake.wait(lock, [this]() { return queued.load() > 0 || quit.load(); });
+				sleeping.fetch_sub(1);
+			}
+		}
+
+		uint32_t threadCount = 1;
+		uint32_t coreCount = 1;
+		std::vector<std::unique_ptr<ThreadState>> threads;
+		std::vector<std::thread> workers;
+
+		// Queued jobs across every deque -- Workers sleep while it's zero
+		std::atomic<int32_t> queued{ 0 };
+		std::atomic<uint32_t> sleeping{ 0 };
+		std::atomic<bool> quit{ false };
+		std::deque<Job*> background;
+		std::mutex backgroundMutex;
+		std::mutex sleepMutex;
+		std::condition_variable wake;
+	};
+
+	// Started on first use -- Workers are joined at exit
+	inline Scheduler& GetScheduler()
+	{
+		static Scheduler scheduler;
+		return scheduler;
+	}
+
+// ==============================================
+// Interface
+// ==============================================
+
+	// Thread 0 is the main thread, workers follow -- invalidThread for threads the scheduler doesn't know
+	inline uint32_t ThreadIndex() { return LocalThreadIndex(); }
+	inline uint32_t ThreadCount() { return GetScheduler().ThreadCount(); }
+	// Hardware threads -- Parallel work is only split when there is more than one
+	inline uint32_t CoreCount() { return GetScheduler().CoreCount(); }
+
+	template<typename F>
+	inline void Run(const F& _function, Counter* _counter = nullptr)
+	{
+		GetScheduler().Run(_function, _counter);
+	}
+
+	template<typename F>
+	inline void RunBackground(const F& _function, Counter* _counter = nullptr)
+	{
+		GetScheduler().RunBackground(_function, _counter);
+	}
+
+	inline void Wait(const Counter& _counter)
+	{
+		GetScheduler().Wait(_counter);
+	}
+
+	// _function(i) for i in [0, _count) across every thread -- Returns once all are done
+	// The range is halved into jobs until pieces reach the grain size, so idle threads steal the largest piece left
+	// Grain adapts to the count and core count (about 8 pieces per core), never below _minGrain
+	// Runs on the calling thread below 2 * _minGrain, or with a single core
+	template<typename F>
+	inline void ParallelFor(uint32_t _count, F&& _function, uint32_t _minGrain = 4)
+	{
+		_minGrain = std::max(1u, _minGrain);
+		Scheduler& scheduler = GetScheduler();
+		uint32_t coreCount = scheduler.CoreCount();
+		if (coreCount <= 1 || _count < 2 * _minGrain || ThreadIndex() == invalidThread)
+		{
+			for (uint32_t i = 0; i < _count; i++)
+				_function(i);
+			return;
+		}
+
+		using Function = typename std::remove_reference<F>::type;
+		struct Range
+		{
+			Function* function;
+			Counter* counter;
+			uint32_t begin;
+			uint32_t end;
+			uint32_t grain;
+
+			void operator()() const
+			{
+				// The upper halves go to the deque, where thieves find them
+				uint32_t last = end;
+				while (last - begin > grain)
+				{
+					uint32_t middle = begin + (last - begin) / 2;
+					Range upper = { function, counter, middle, last, grain };
+					GetScheduler().Run(upper, counter);
+					last = middle;
+				}
+				for (uint32_t i = begin; i < last; i++)
+					(*function)(i);
+			}
+		};
+
+		Counter counter;
+		uint32_t grain = std::max(_minGrain, _count / (coreCount * 8));
+		Range all = { &_function, &counter, 0, _count, grain };
+		all();
+		scheduler.Wait(counter);
+	}
+
+} // namespace jobs
+} // namespace skel
@@ -0,0 +1,443 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+
+#include <glm/glm.hpp>
+
+#include "ecs/ecs.h"
+#include "Culling.h"
+#include "Bvh.h"
+
+namespace skel
+{
+	// A missing octree node or child
+	static const uint32_t noOctreeNode = UINT32_MAX;
+
+	// A spatial index for entities that move every frame -- Insert, remove, & move touch one path of at most maxDepth nodes,
+	// and a move that stays in its cell only rewrites the entity's slot. Nothing degrades, so nothing is ever rebuilt
+	// Loose: a cell takes the entities whose centers are inside it and whose boxes fit in twice its size
+	// Entities centered outside the root cell, or larger than it, stay in the root
+	class LooseOctree
+	{
+	private:
+		static const uint32_t stackSize = 256;	// Enough for maxDepth levels of 7 pending siblings each
+		static const uint32_t batchSize = 64;	// Bounds culled per SIMD call
+
+		struct Node
+		{
+			glm::vec3 center;
+			float halfSize;			// Of the cell -- Its loose box is twice as large
+			uint32_t level;
+			uint32_t parent;
+			uint32_t children[8];
+			uint32_t subtreeCount;	// Entities in this node & below -- Empty nodes are freed
+
+			std::vector<ecs::Entity> entities;	// Swap-removed
+		};
+
+		// An entity's bounds & where it lives, by entity index -- Holds a copy of the cell, so a move that stays
+		// in it touches nothing but the slot. Entities usually move in index order, so that is a linear walk
+		struct Slot
+		{
+			WorldBounds bounds;
+			glm::vec3 center = glm::vec3(0.0f);
+			float halfSize = 0.0f;
+			uint32_t level = 0;
+			uint32_t node = noOctreeNode;
+			uint32_t index = 0;
+			uint32_t generation = 0;
+		};
+
+		uint32_t maxDepth;
+		std::vector<Node> nodes;		// The root is node 0
+		std::vector<uint32_t> freeNodes;
+		std::vector<Slot> slots;
+		uint32_t count = 0;
+
+	public:
+		// The root cell is a cube -- Entities outside it still work, they are just never culled as a group
+		explicit LooseOctree(const glm::vec3& _center = glm::vec3(0.0f), float _halfSize = 1024.0f, uint32_t _maxDepth = 8)
+			: maxDepth(_maxDepth)
+		{
+			nodes.push_back(MakeNode(_center, _halfSize, 0, noOctreeNode));
+		}
+
+		// Inserts the entity if it isn't indexed yet
+		void Move(ecs::Entity _entity, const WorldBounds& _bounds)
+		{
+			if (!Contains(_entity))
+			{
+				Insert(_entity, _bounds);
+				return;
+			}
+
+			Slot& slot = slots[_entity.index];
+			if (Fits(slot, _bounds))
+			{
+				slot.bounds = _bounds;
+				return;
+			}
+
+			RemoveFromNode(_entity);
+			AddToNode(FindNode(_bounds), _entity, _bounds);
+		}
+
+		void Insert(ecs::Entity _entity, const WorldBounds& _bounds)
+		{
+			if (Contains(_entity))
+				throw std::runtime_error("Entity is already in the octree");
+			if (_entity.index >= slots.size())
+				slots.resize(_entity.index + 1);
+
+			AddToNode(FindNode(_bounds), _entity, _bounds);
+			count++;
+		}
+
+		void Remove(ecs::Entity _entity)
+		{
+			if (!Contains(_entity))
+				return;
+
+			RemoveFromNode(_entity);
+			slots[_entity.index] = Slot();
+			count--;
+		}
+
+		bool Contains(ecs::Entity _entity) const
+		{
+			if (_entity.index >= slots.size() || slots[_entity.index].node == noOctreeNode)
+				return false;
+			return slots[_entity.index].generation == _entity.generation;
+		}
+
+		uint32_t Count() const { return count; }
+		uint32_t NodeCount() const { return static_cast<uint32_t>(nodes.size() - freeNodes.size()); }
+
+		// Queries
+		// ==========================================
+
+		// Appends every entity in the frustum -- Cells fully inside are taken whole, crossing cells go through the SIMD kernels
+		void CullFrustum(const Frustum& _frustum, std::vector<ecs::Entity>& _visible) const
+		{
+			uint32_t stack[stackSize];
+			uint32_t stackCount = 0;
+			stack[stackCount++] = 0;
+
+			WorldBounds bounds[batchSize];
+			Visibility visibilities[batchSize];
+			while (stackCount > 0)
+			{
+				uint32_t index = stack[--stackCount];
+				const Node& node = nodes[index];
+				if (node.subtreeCount == 0)
+					continue;
+
+				// The root also holds whatever is outside it
+				int side = index == 0 ? 0 : ClassifyBox(_frustum, node.center - node.halfSize * 2.0f, node.center + node.halfSize * 2.0f);
+				if (side < 0)
+					continue;
+				if (side > 0)
+				{
+					AppendSubtree(index, _visible);
+					continue;
+				}
+
+				uint32_t entityCount = static_cast<uint32_t>(node.entities.size());
+				for (uint32_t first = 0; first < entityCount; first += batchSize)
+				{
+					uint32_t batch = std::min(entityCount - first, static_cast<uint32_t>(batchSize));
+					for (uint32_t i = 0; i < batch; i++)
+						bounds[i] = slots[node.entities[first + i].index].bounds;
+					simd::CullBounds(_frustum, bounds, batch, visibilities);
+					for (uint32_t i = 0; i < batch; i++)
+						if (visibilities[i].visible)
+							_visible.push_back(node.entities[first + i]);
+				}
+
+				for (const auto& child : node.children)
+					if (child != noOctreeNode)
+						stack[stackCount++] = child;
+			}
+		}
+
+		// The closest entity whose box the ray hits -- Cells the ray enters past the best hit are skipped
+		BvhHit Raycast(const glm::vec3& _origin, const glm::vec3& _direction, float _maxDistance = FLT_MAX) const
+		{
+			BvhHit hit;
+			hit.distance = _maxDistance;
+			glm::vec3 inverseDirection = InverseRayDirection(_direction);
+
+			uint32_t stack[stackSize];
+			float stackDistances[stackSize];
+			uint32_t stackCount = 0;
+			stack[stackCount] = 0;
+			stackDistances[stackCount++] = 0.0f;
+
+			while (stackCount > 0)
+			{
+				stackCount--;
+				if (stackDistances[stackCount] > hit.distance)
+					continue;
+				const Node& node = nodes[stack[stackCount]];
+
+				for (uint32_t i = 0; i < static_cast<uint32_t>(node.entities.size()); i++)
+				{
+					const WorldBounds& bounds = slots[node.entities[i].index].bounds;
+					glm::vec3 center = glm::vec3(bounds.sphere);
+					glm::vec3 extents = glm::vec3(bounds.extents);
+					float distance = RayBoxDistance(_origin, inverseDirection, center - extents, center + extents, hit.distance);
+					if (distance < hit.distance)
+					{
+						hit.distance = distance;
+						hit.entity = node.entities[i];
+					}
+				}
+
+				for (const auto& child : node.children)
+				{
+					if (child == noOctreeNode)
+						continue;
+					const Node& childNode = nodes[child];
+					float distance = RayBoxDistance(_origin, inverseDirection, childNode.center - childNode.halfSize * 2.0f, childNode.center + childNode.halfSize * 2.0f, hit.distance);
+					if (distance != FLT_MAX)
+					{
+						stack[stackCount] = child;
+						stackDistances[stackCount++] = distance;
+					}
+				}
+			}
+
+			if (hit.entity.IsNull())
+				hit.distance = FLT_MAX;
+			return hit;
+		}
+
+		// Appends every entity whose box is within _radius of _center
+		void QuerySphere(const glm::vec3& _center, float _radius, std::vector<ecs::Entity>& _found) const
+		{
+			float radiusSquared = _radius * _radius;
+			uint32_t stack[stackSize];
+			uint32_t stackCount = 0;
+			stack[stackCount++] = 0;
+
+			while (stackCount > 0)
+			{
+				uint32_t index = stack[--stackCount];
+				const Node& node = nodes[index];
+				if (index != 0 && PointBoxDistanceSquared(_center, node.center - node.halfSize * 2.0f, node.center + node.halfSize * 2.0f) > radiusSquared)
+					continue;
+
+				for (uint32_t i = 0; i < static_cast<uint32_t>(node.entities.size()); i++)
+				{
+					const WorldBounds& bounds = slots[node.entities[i].index].bounds;
+					glm::vec3 center = glm::vec3(bounds.sphere);
+					glm::vec3 extents = glm::vec3(bounds.extents);
+					if (PointBoxDistanceSquared(_center, center - extents, center + extents) <= radiusSquared)
+						_found.push_back(node.entities[i]);
+				}
+
+				for (const auto& child : node.children)
+					if (child != noOctreeNode)
+						stack[stackCount++] = child;
+			}
+		}
+
+		// The entity whose box is closest to _point, within _maxDistance -- 0 if the point is inside it
+		BvhHit Nearest(const glm::vec3& _point, float _maxDistance = FLT_MAX) const
+		{
+			BvhHit hit;
+			float bestSquared = _maxDistance == FLT_MAX ? FLT_MAX : _maxDistance * _maxDistance;
+
+			uint32_t stack[stackSize];
+			float stackDistances[stackSize];
+			uint32_t stackCount = 0;
+			stack[stackCount] = 0;
+			stackDistances[stackCount++] = 0.0f;
+
+			while (stackCount > 0)
+			{
+				stackCount--;
+				if (stackDistances[stackCount] > bestSquared)
+					continue;
+				const Node& node = nodes[stack[stackCount]];
+
+				for (uint32_t i = 0; i < static_cast<uint32_t>(node.entities.size()); i++)
+				{
+					const WorldBounds& bounds = slots[node.entities[i].index].bounds;
+					glm::vec3 center = glm::vec3(bounds.sphere);
+					glm::vec3 extents = glm::vec3(bounds.extents);
+					float distanceSquared = PointBoxDistanceSquared(_point, center - extents, center + extents);
+					if (distanceSquared <= bestSquared)
+					{
+						bestSquared = distanceSquared;
+						hit.entity = node.entities[i];
+					}
+				}
+
+				for (const auto& child : node.children)
+				{
+					if (child == noOctreeNode)
+						continue;
+					const Node& childNode = nodes[child];
+					float distanceSquared = PointBoxDistanceSquared(_point, childNode.center - childNode.halfSize * 2.0f, childNode.center + childNode.halfSize * 2.0f);
+					if (distanceSquared <= bestSquared)
+					{
+						stack[stackCount] = child;
+						stackDistances[stackCount++] = distanceSquared;
+					}
+				}
+			}
+
+			if (!hit.entity.IsNull())
+				hit.distance = std::sqrt(bestSquared);
+			return hit;
+		}
+
+	private:
+		static Node MakeNode(const glm::vec3& _center, float _halfSize, uint32_t _level, uint32_t _parent)
+		{
+			Node node;
+			node.center = _center;
+			node.halfSize = _halfSize;
+			node.level = _level;
+			node.parent = _parent;
+			std::fill(node.children, node.children + 8, noOctreeNode);
+			node.subtreeCount = 0;
+			return node;
+		}
+
+		static float LargestExtent(const WorldBounds& _bounds)
+		{
+			return std::max(_bounds.extents.x, std::max(_bounds.extents.y, _bounds.extents.z));
+		}
+
+		static bool CenterInCell(const Node& _node, const WorldBounds& _bounds)
+		{
+			glm::vec3 offset = glm::abs(glm::vec3(_bounds.sphere) - _node.center);
+			return offset.x <= _node.halfSize && offset.y <= _node.halfSize && offset.z <= _node.halfSize;
+		}
+
+		// Can stay in the cell -- Still too big for a child, and inside the loose box even if the center left the cell,
+		// so an entity moving along a cell's edge doesn't hop back & forth every frame
+		bool Fits(const Slot& _slot, const WorldBounds& _bounds) const
+		{
+			// Bitwise ands -- Every move takes this path, and the short circuits would be branches it can't predict
+			float extent = LargestExtent(_bounds);
+			bool tooBigForChild = (_slot.level == maxDepth) | (extent > _slot.halfSize * 0.5f);
+			glm::vec3 offset = glm::abs(glm::vec3(_bounds.sphere) - _slot.center);
+			if (_slot.level == 0)
+				return tooBigForChild | (offset.x > _slot.halfSize) | (offset.y > _slot.halfSize) | (offset.z > _slot.halfSize);
+
+			glm::vec3 reach = offset + glm::vec3(_bounds.extents);
+			float looseSize = _slot.halfSize * 2.0f;
+			return tooBigForChild & (extent <= _slot.halfSize) & (reach.x <= looseSize) & (reach.y <= looseSize) & (reach.z <= looseSize);
+		}
+
+		// The deepest cell whose loose box holds the bounds -- Creates the path down to it
+		uint32_t FindNode(const WorldBounds& _bounds)
+		{
+			glm::vec3 center = glm::vec3(_bounds.sphere);
+			float extent = LargestExtent(_bounds);
+			if (!CenterInCell(nodes[0], _bounds))
+				return 0;
+
+			uint32_t index = 0;
+			while (nodes[index].level < maxDepth && extent <= nodes[index].halfSize * 0.5f)
+			{
+				const Node& node = nodes[index];
+				uint32_t octant = (center.x >= node.center.x ? 1 : 0) | (center.y >= node.center.y ? 2 : 0) | (center.z >= node.center.z ? 4 : 0);
+				uint32_t child = node.children[octant];
+				if (child == noOctreeNode)
+				{
+					float childHalfSize = node.halfSize * 0.5f;
+					glm::vec3 childCenter = node.center + glm::vec3(
+						octant & 1 ? childHalfSize : -childHalfSize,
+						octant & 2 ? childHalfSize : -childHalfSize,
+						octant & 4 ? childHalfSize : -childHalfSize);
+					child = AllocateNode(childCenter, childHalfSize, node.level + 1, index);
+					nodes[index].children[octant] = child;
+				}
+				index = child;
+			}
+			return index;
+		}
+
+		uint32_t AllocateNode(const glm::vec3& _center, float _halfSize, uint32_t _level, uint32_t _parent)
+		{
+			if (!freeNodes.empty())
+			{
+				uint32_t index = freeNodes.back();
+				freeNodes.pop_back();
+				nodes[index] = MakeNode(_center, _halfSize, _level, _parent);
+				return index;
+			}
+			nodes.push_back(MakeNode(_center, _halfSize, _level, _parent));
+			return static_cast<uint32_t>(nodes.size() - 1);
+		}
+
+		void AddToNode(uint32_t _node, ecs::Entity _entity, const WorldBounds& _bounds)
+		{
+			Node& node = nodes[_node];
+			Slot& slot = slots[_entity.index];
+			slot.center = node.center;
+			slot.halfSize = node.halfSize;
+			slot.level = node.level;
+			slot.node = _node;
+			slot.index = static_cast<uint32_t>(node.entities.size());
+			slot.generation = _entity.generation;
+			slot.bounds = _bounds;
+			node.entities.push_back(_entity);
+
+			for (uint32_t index = _node; index != noOctreeNode; index = nodes[index].parent)
+				nodes[index].subtreeCount++;
+		}
+
+		// Swap-removes the entity, then frees the nodes left empty
+		void RemoveFromNode(ecs::Entity _entity)
+		{
+			Slot slot = slots[_entity.index];
+			Node& node = nodes[slot.node];
+
+			ecs::Entity last = node.entities.back();
+			node.entities[slot.index] = last;
+			slots[last.index].index = slot.index;
+			node.entities.pop_back();
+
+			for (uint32_t index = slot.node; index != noOctreeNode;)
+			{
+				Node& current = nodes[index];
+				uint32_t parent = current.parent;
+				if (--current.subtreeCount == 0 && parent != noOctreeNode)
+				{
+					// Its children were freed when they emptied
+					for (auto& child : nodes[parent].children)
+						if (child == index)
+							child = noOctreeNode;
+					current.entities = std::vector<ecs::Entity>();
+					freeNodes.push_back(index);
+				}
+				index = parent;
+			}
+		}
+
+		void AppendSubtree(uint32_t _node, std::vector<ecs::Entity>& _out) const
+		{
+			uint32_t stack[stackSize];
+			uint32_t stackCount = 0;
+			stack[stackCount++] = _node;
+			while (stackCount > 0)
+			{
+				const Node& node = nodes[stack[--stackCount]];
+				_out.insert(_out.end(), node.entities.begin(), node.entities.end());
+				for (const auto& child : node.children)
+					if (child != noOctreeNode)
+						stack[stackCount++] = child;
+			}
+		}
+	}; // LooseOctree
+
+} // namespace skel
@@ -1,5 +1,6 @@
 
 #include <iostream>
+#include <string>
 
 #include "Common.h"
 
@@ -11,7 +12,6 @@ class Application : public skel::SkeletonApplication
 {
 private:
 	VulkanDevice* device;
-	std::vector<std::vector<skel::Object*>*> renderableObjects;
 	std::vector<skel::Object*> bulbs;
 	std::vector<skel::Object*> subjects;
 
@@ -29,7 +29,7 @@ protected:
 		device = renderer->device;
 
 		bulbs.resize(4);
-		subjects.resize(4);
+		subjects.resize(benchmark.active ? benchmark.settings.sceneObjects : 4);
 
 		BindShaderDescriptors();
 
@@ -66,22 +66,52 @@ protected:
 
 		#pragma endregion
 
+		// Every object streams its files -- Each is drawn as soon as they arrive, nothing here waits for them
 		uint32_t index = 0;
 		for (auto& object : bulbs)
 		{
-			object = new skel::Object(device, skel::ShaderTypes::Unlit, ".\\res\\models\\TestShapes\\SphereSmooth.obj");
+			object = new skel::Object(device, &scene, skel::ShaderTypes::Unlit, ".\\res\\models\\TestShapes\\SphereSmooth.obj", &renderer->streamer);
 			object->AttachBuffer(sizeof(glm::vec3));
-			VkDeviceMemory* bulbColorMemory = &object->shader.buffers[1]->memory;
-			renderer->shaderDescriptors[object->shader.type]->CreateDescriptorSets(device->logicalDevice, object->shader);
-			object->transform.position = finalLights.pointLights[index].position;
-			object->transform.scale *= 0.05f;
+			VkDeviceMemory* bulbColorMemory = &object->shader.buffers[0]->memory;
+			object->CreateDescriptorSet(renderer->shaderDescriptors[object->shader.type]);
+			object->SetPosition(finalLights.pointLights[index].position);
+			object->SetScale(glm::vec3(0.05f));
+			object->SetStatic(true);
 			device->CopyDataToBufferMemory(&finalLights.pointLights[index].color, sizeof(glm::vec3), *bulbColorMemory);
 
 			index++;
 		}
 
-		renderableObjects.push_back(&bulbs);
-		renderer->RecordRenderingCommandBuffers(&renderableObjects);
+		CreateSubjects();
+	}
+
+	void CreateSubjects()
+	{
+		// Subjects are laid out on a square grid, two units apart
+		uint32_t index = 0;
+		uint32_t gridSide = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(subjects.size()))));
+		float gridOffset = (gridSide - 1) * 0.5f;
+
+		// Every subject shares one material -- Each texture is loaded once
+		skel::MaterialInfo subjectMaterial = {};
+		subjectMaterial.albedo    = renderer->StreamTexture(albedoTextureDir);
+		subjectMaterial.normal    = renderer->StreamTexture(normalTextureDir);
+		subjectMaterial.metallic  = renderer->StreamTexture(metallicTextureDir);
+		subjectMaterial.roughness = renderer->StreamTexture(roughnessTextureDir);
+		subjectMaterial.ao        = renderer->StreamTexture(aoTextureDir);
+		uint32_t subjectMaterialIndex = renderer->CreateMaterial(subjectMaterial);
+
+		for (auto& object : subjects)
+		{
+			object = new skel::Object(device, &scene, skel::ShaderTypes::Opaque, ".\\res\\models\\TestShapes\\Cube.obj", &renderer->streamer);
+			object->SetMaterialIndex(subjectMaterialIndex);
+
+			object->SetPosition({ (index % gridSide - gridOffset) * 2.0f, (index / gridSide - gridOffset) * 2.0f, 0.0f });
+			object->SetScale(glm::vec3(0.99f));
+			object->SetStatic(true);
+
+			index++;
+		}
 	}
 
 	void BindShaderDescriptors()
@@ -90,113 +120,52 @@ protected:
 		renderer->AddShader(
 			"unlit",
 			{
-				// MVP matrices
-				skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0),
 				// Object color
-				skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1),
+				skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 0),
 			},
 			4
 			);
+		// Lights, materials, and textures are read from the global bindless set
 		renderer->AddShader(
 			"PBR",
-			{
-				// MVP matrices
-				skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0),
-				// Lights info
-				skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1),
-				// Albedo map
-				skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 2),
-				// Normal map
-				skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 3),
-				// Metallic
-				skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 4),
-				// Roughness
-				skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 5),
-				// AO
-				skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 6),
-			},
+			{},
 			4
 			);
 	}
 
 	void MainLoopCore()
 	{
-		static bool addedSubjects = false;
-
 		// TODO : Create an input manager
 		HandleInput();
 
 		UpdateObjectUniforms();
 
-		if (!addedSubjects && time.totalTime > 1.0f)
-		{
-			addedSubjects = true;
-
-			uint32_t index = 0;
-
-			for (auto& object : subjects)
-			{
-				object = new skel::Object(device, skel::ShaderTypes::Opaque, ".\\res\\models\\TestShapes\\Cube.obj");
-				//object->AttachBuffer(sizeof(glm::vec3));
-				//VkDeviceMemory* colorMemory = &object->shader.buffers[1]->memory;
-				//device->CopyDataToBufferMemory(&finalLights.pointLights[index].color, sizeof(glm::vec3), *colorMemory);
-				object->AttachBuffer(sizeof(finalLights));
-				VkDeviceMemory* lightsMemory = &object->shader.buffers[1]->memory;
-				object->AttachTexture(albedoTextureDir);
-				object->AttachTexture(normalTextureDir);
-				object->AttachTexture(metallicTextureDir);
-				object->AttachTexture(roughnessTextureDir);
-				object->AttachTexture(aoTextureDir);
-				device->CopyDataToBufferMemory(&finalLights, sizeof(finalLights), *lightsMemory);
-
-				renderer->shaderDescriptors[object->shader.type]->CreateDescriptorSets(device->logicalDevice, object->shader);
-
-				object->transform.position = {index & 1 ? 1.0f : -1.0f, index & 2 ? 1.0f : -1.0f, 0.0f};
-				object->transform.scale *= 0.99f;
-
-				index++;
-			}
-
-			renderableObjects.push_back(&subjects);
-			renderer->RecordRenderingCommandBuffers(&renderableObjects);
-		}
-
 		renderer->RenderFrame();
 	}
 
 	void UpdateObjectUniforms()
 	{
+		SKEL_PROFILE_FUNCTION();
+
 		finalLights.spotLights[0].position = cam->cameraPosition;
 		finalLights.spotLights[0].direction = cam->cameraFront;
 
 		finalLights.spotLights[1].position = cam->cameraPosition;
 		finalLights.spotLights[1].direction = cam->cameraFront;
-
-		for (auto& object : bulbs)
-		{
-			object->UpdateMVPBuffer(cam->cameraPosition, cam->projection, cam->view);
-		}
-
-		if (static_cast<uint32_t>(renderableObjects.size()) > 1)
-		{
-			for (auto& object : subjects)
-			{
-				device->CopyDataToBufferMemory(&finalLights, sizeof(finalLights), object->shader.buffers[1]->memory);
-				object->UpdateMVPBuffer(cam->cameraPosition, cam->projection, cam->view);
-			}
-		}
+		renderer->lights = finalLights;
 	}
 
 	void ChildCleanup()
 	{
+		// Destructors return descriptor sets to their allocators
 		for (const auto& object : bulbs)
 		{
-			free(object);
+			delete object;
 		}
 
 		for (const auto& object : subjects)
 		{
-			free(object);
+			delete object;
 		}
 	}
 
@@ -208,7 +177,33 @@ int main(int argc, char** argv)
 	try
 	{
 		Application app;
-		app.Run();
+
+		// --headless [frames] renders offscreen without a window
+		// --benchmark [frames] [objects] [report] follows a scripted camera and writes a frame time report
+		//   Can follow --headless
+		bool headless = false;
+		int arg = 1;
+		if (arg < argc && std::string(argv[arg]) == "--headless")
+		{
+			headless = true;
+			arg++;
+		}
+
+		if (arg < argc && std::string(argv[arg]) == "--benchmark")
+		{
+			skel::BenchmarkSettings settings;
+			if (arg + 1 < argc)
+				settings.frameCount = (uint32_t)std::stoul(argv[arg + 1]);
+			if (arg + 2 < argc)
+				settings.sceneObjects = (uint32_t)std::stoul(argv[arg + 2]);
+			if (arg + 3 < argc)
+				settings.reportPath = argv[arg + 3];
+			app.RunBenchmark(settings, headless);
+		}
+		else if (headless)
+			app.RunHeadless(arg < argc ? (uint32_t)std::stoul(argv[arg]) : 1000);
+		else
+			app.Run();
 	}
 	catch (std::exception& e)
 	{
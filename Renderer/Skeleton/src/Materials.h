@@ -0,0 +1,142 @@
+#pragma once
+
+#include <vector>
+
+#include "Common.h"
+#include "VulkanDevice.h"
+#include "FileLoader.h"
+
+#include "ecs/ecs.h"
+
+namespace skel
+{
+	// Indices into the bindless texture array -- Matches MaterialInfo in PBR.frag (std430)
+	struct MaterialInfo
+	{
+		alignas(4) uint32_t albedo;
+		alignas(4) uint32_t normal;
+		alignas(4) uint32_t metallic;
+		alignas(4) uint32_t roughness;
+		alignas(4) uint32_t ao;
+	};
+
+	// Owns every texture and material used by bindless shaders
+	// Textures are referenced by their index in one update-after-bind sampler array
+	// Materials are stored in a storage buffer and referenced by index from each object's entry in the object buffer
+	struct MaterialLibrary
+	{
+		uint32_t maxTextures = 1024;
+		uint32_t maxMaterials = 1024;
+
+		std::vector<TextureComponent*> textures;
+		std::vector<MaterialInfo> materials;
+
+		// 1 x 1 white -- Sampled through slots whose texture is still streaming
+		TextureComponent placeholder = {};
+
+		VkBuffer materialBuffer;
+		VkDeviceMemory materialMemory;
+
+		// Creates the material storage buffer
+		// Clamps the texture capacity to the device's update-after-bind limits
+		void Create(VulkanDevice* _device, const VkPhysicalDeviceVulkan12Properties& _limits)
+		{
+			maxTextures = glm::min(maxTextures, _limits.maxDescriptorSetUpdateAfterBindSampledImages);
+			maxTextures = glm::min(maxTextures, _limits.maxPerStageDescriptorUpdateAfterBindSamplers);
+
+			_device->CreateBuffer(
+				sizeof(MaterialInfo) * maxMaterials,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				materialBuffer,
+				materialMemory
+			);
+
+			const uint8_t white[4] = { 255, 255, 255, 255 };
+			UploadTextureImage(_device, white, 1, 1, placeholder.image, placeholder.memory);
+			CreateTextureImageView(_device, placeholder.image, placeholder.view);
+			CreateTextureSampler(_device, placeholder.sampler);
+		}
+
+		// Loads a texture into the next free slot of the texture array
+		// _directory is from the base texture resource folder
+		uint32_t LoadTexture(VulkanDevice* _device, const char* _directory)
+		{
+			if (static_cast<uint32_t>(textures.size()) >= maxTextures)
+				throw std::runtime_error("Bindless texture array is full");
+
+			TextureComponent* texture = new TextureComponent();
+			CreateTexture(_device, _directory, texture->image, texture->memory, texture->view, texture->sampler);
+			textures.push_back(texture);
+
+			return static_cast<uint32_t>(textures.size()) - 1;
+		}
+
+		// Takes the next free slot for a texture that arrives later -- It reads as the placeholder until then
+		uint32_t ReserveTexture()
+		{
+			if (static_cast<uint32_t>(textures.size()) >= maxTextures)
+				throw std::runtime_error("Bindless texture array is full");
+
+			textures.push_back(new TextureComponent());
+			return static_cast<uint32_t>(textures.size()) - 1;
+		}
+
+		// Appends a material and copies it to the material buffer
+		uint32_t AddMaterial(VulkanDevice* _device, const MaterialInfo& _material)
+		{
+			if (static_cast<uint32_t>(materials.size()) >= maxMaterials)
+				throw std::runtime_error("Material buffer is full");
+
+			uint32_t index = static_cast<uint32_t>(materials.size());
+			materials.push_back(_material);
+			_device->CopyDataToBufferMemory(&_material, sizeof(MaterialInfo), materialMemory, sizeof(MaterialInfo) * index);
+
+			return index;
+		}
+
+		// Writes a single texture into the bindless array of _set -- The placeholder if it hasn't arrived
+		void WriteTextureDescriptor(VkDevice _device, VkDescriptorSet _set, uint32_t _binding, uint32_t _textureIndex)
+		{
+			const TextureComponent* texture = textures[_textureIndex]->view != VK_NULL_HANDLE ? textures[_textureIndex] : &placeholder;
+
+			VkDescriptorImageInfo imageInfo = {};
+			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			imageInfo.imageView = texture->view;
+			imageInfo.sampler = texture->sampler;
+
+			VkWriteDescriptorSet write =
+				skel::initializers::WriteDescriptorSet(
+					_set,
+					VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+					&imageInfo,
+					_binding
+				);
+			write.dstArrayElement = _textureIndex;
+
+			vkUpdateDescriptorSets(_device, 1, &write, 0, nullptr);
+		}
+
+		void Cleanup(VkDevice _device)
+		{
+			for (auto& tex : textures)
+			{
+				vkDestroyImage(_device, tex->image, nullptr);
+				vkDestroyImageView(_device, tex->view, nullptr);
+				vkDestroySampler(_device, tex->sampler, nullptr);
+				vkFreeMemory(_device, tex->memory, nullptr);
+				delete tex;
+			}
+			textures.clear();
+
+			vkDestroyImage(_device, placeholder.image, nullptr);
+			vkDestroyImageView(_device, placeholder.view, nullptr);
+			vkDestroySampler(_device, placeholder.sampler, nullptr);
+			vkFreeMemory(_device, placeholder.memory, nullptr);
+
+			vkDestroyBuffer(_device, materialBuffer, nullptr);
+			vkFreeMemory(_device, materialMemory, nullptr);
+		}
+	}; // MaterialLibrary
+
+} // namespace skel
@@ -8,6 +8,8 @@
 #include <array>
 #include <chrono>
 #include <unordered_map>
+#include <algorithm>
+#include <cmath>
 
 #include "Common.h"
 
@@ -71,11 +73,39 @@ struct Mesh
 	std::vector<Vertex> vertices;
 	std::vector<uint32_t> indices;
 
+	// Object space, from the vertices at import -- The sphere is centered on the box
+	glm::vec3 boundsMin = { 0.0f, 0.0f, 0.0f };
+	glm::vec3 boundsMax = { 0.0f, 0.0f, 0.0f };
+	float boundsRadius = 0.0f;
+
 	VkBuffer vertexBuffer;
 	VkDeviceMemory vertexBufferMemory;
 	VkBuffer indexBuffer;
 	VkDeviceMemory indexBufferMemory;
 
+	// Fits the box, then the sphere around its center -- Often tighter than the box's corners
+	void ComputeBounds()
+	{
+		if (vertices.empty())
+			return;
+
+		boundsMin = boundsMax = vertices[0].position;
+		for (const auto& vertex : vertices)
+		{
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
+
+		glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		float radiusSquared = 0.0f;
+		for (const auto& vertex : vertices)
+		{
+			glm::vec3 offset = vertex.position - center;
+			radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+		}
+		boundsRadius = std::sqrt(radiusSquared);
+	}
+
 	void Cleanup(VkDevice& _device)
 	{
 		vkDestroyBuffer(_device, vertexBuffer, nullptr);
@@ -9,28 +9,24 @@
 #include "Lights.h"
 #include "Shaders.h"
 #include "FileLoader.h"
+#include "TransformBatch.h"
+#include "Scene.h"
+#include "AssetStreaming.h"
 
 #include <iostream>
 
 namespace skel
 {
-// Matrices for translating objects to clip space
-struct MvpInfo {
+// One entry of the renderer's per-frame object buffer (std430) -- Draws select theirs with firstInstance
+// View, projection, and camera position live in the renderer's frame-wide camera buffer
+struct ObjectData {
 	alignas(16) glm::mat4 model;
-	alignas(16) glm::mat4 view;
-	alignas(16) glm::mat4 proj;
-	alignas(16) glm::vec3 camPosition;
+	alignas(16) glm::mat4 modelViewProjection;
+	alignas(4) uint32_t materialIndex;
 };
 
-// Vectors transformed into the object's model matrix
-struct Transform {
-	glm::vec3 position	= { 0.0f, 0.0f, 0.0f };
-	glm::vec3 rotation	= { 0.0f, 0.0f, 0.0f };
-	glm::vec3 scale		= { 1.0f, 1.0f, 1.0f };
-};
-
-// TODO : Only create each image once
-// TODO : Share BaseShader between objects using the same shader
+// Owns a renderable's mesh and shader resources -- Its per-frame data lives in the scene as an entity
+// TODO : Share meshes between objects loading the same file
 class Object
 {
 // ==============================================
@@ -38,48 +34,85 @@ class Object
 // ==============================================
 private:
 	VulkanDevice* device;
+	Scene* scene;
 	Mesh* mesh = nullptr;
 
-	skel::MvpInfo mvp;
-
-	// Texture data
-	std::vector<VkImage> images;
-	std::vector<VkDeviceMemory> imageMemories;
+	// Set when the object's files are streamed -- It is drawn once all of them arrived
+	AssetStreamer* streamer = nullptr;
+	std::vector<StreamHandle> streaming;
+	ShaderDescriptorInformation* pendingDescriptor = nullptr;
 
 public:
-	skel::Transform transform;
+	ecs::Entity entity;
 	skel::BaseShader shader;
 
 // ==============================================
 // Functions
 // ==============================================
 public:
-	// Builds the object's mesh and loads its textures
+	// Builds the object's mesh and creates its entity as a root of the scene's transform hierarchy
+	// With a _streamer, returns right away -- The mesh & textures are loaded in the background and the object isn't drawn until they are
 	Object(
 		VulkanDevice* _device,
+		Scene* _scene,
 		skel::ShaderTypes _shaderType,
-		const char* _modelDirectory = nullptr
-		) : device(_device)
+		const char* _modelDirectory = nullptr,
+		AssetStreamer* _streamer = nullptr
+		) : device(_device), scene(_scene), streamer(_streamer)
 	{
 		shader.type = _shaderType;
 
-		// Guarantee the MVP matrices will be buffer 0
-		AttachBuffer(sizeof(skel::MvpInfo));
-		mvp.model = glm::mat4(1.0f);
-
-		if (_modelDirectory != nullptr)
+		if (_modelDirectory != nullptr && streamer == nullptr)
 			mesh = LoadMesh(device, _modelDirectory);
+
+		skel::Material material = {};
+		material.shaderType = _shaderType;
+
+		skel::Bounds bounds = {};
+		if (mesh)
+		{
+			bounds.min = mesh->boundsMin;
+			bounds.max = mesh->boundsMax;
+			bounds.radius = mesh->boundsRadius;
+		}
+
+		entity = scene->world.Create(
+			skel::Position(),
+			skel::Rotation(),
+			skel::Scale(),
+			skel::LocalToWorld(),
+			skel::MeshRef{ mesh },
+			material,
+			bounds,
+			skel::WorldBounds(),
+			skel::Visibility()
+			);
+		scene->transforms.Add(entity);
+
+		if (_modelDirectory != nullptr && streamer != nullptr)
+		{
+			streaming.push_back(streamer->LoadMesh(_modelDirectory, [this](StreamRequest& _request) {
+				mesh = _request.mesh;
+				_request.mesh = nullptr;
+				OnStreamed();
+			}));
+		}
 	}
 
-	// Destroy this object's buffers
+	// Destroy this object's entity and buffers
 	~Object()
 	{
+		// The streamer frees anything that arrives after this
+		for (auto& request : streaming)
+			request->Cancel();
+
+		scene->Destroy(entity);
 		shader.Cleanup(device->logicalDevice);
 
 		if (mesh)
 		{
 			mesh->Cleanup(device->logicalDevice);
-			free(mesh);
+			delete mesh;
 		}
 	}
 
@@ -90,7 +123,17 @@ public:
 		TextureComponent* texture = new TextureComponent();
 		shader.textures.push_back(texture);
 
-		CreateTexture(device, _directory, texture->image, texture->memory, texture->view, texture->sampler);
+		if (streamer == nullptr)
+		{
+			CreateTexture(device, _directory, texture->image, texture->memory, texture->view, texture->sampler);
+			return;
+		}
+
+		streaming.push_back(streamer->LoadTexture(_directory, [this, texture](StreamRequest& _request) {
+			*texture = _request.texture;
+			_request.texture = {};
+			OnStreamed();
+		}));
 	}
 
 	// Binds a buffer to the shader & allocates memory for it
@@ -109,35 +152,127 @@ public:
 		);
 	}
 
-	// Records commands to the input CommandBuffer
-	void Draw(VkCommandBuffer _commandBuffer, VkPipelineLayout _pipelineLayout)
+	// Writes the attached buffers & textures to a new descriptor set, drawn with the entity
+	// Waits for streamed textures -- The set is written once they arrived
+	void CreateDescriptorSet(skel::ShaderDescriptorInformation* _shaderDescriptor)
 	{
-		if (!mesh)
+		if (!streaming.empty())
+		{
+			pendingDescriptor = _shaderDescriptor;
 			return;
+		}
+
+		_shaderDescriptor->CreateDescriptorSets(device->logicalDevice, shader);
+		scene->world.Get<skel::Material>(entity)->descriptorSet = shader.descriptorSet;
+	}
+
+	// False while any of the object's files are still streaming
+	bool IsLoaded() const { return streaming.empty(); }
+
+	// Local to the parent, if there is one
+	// Setters mark the transform dirty -- Objects that never move cost nothing per frame
+	glm::vec3 GetPosition() { return scene->world.Get<skel::Position>(entity)->value; }
+	glm::quat GetRotation() { return scene->world.Get<skel::Rotation>(entity)->value; }
+	glm::vec3 GetScale() { return scene->world.Get<skel::Scale>(entity)->value; }
+
+	void SetPosition(const glm::vec3& _position)
+	{
+		scene->world.Get<skel::Position>(entity)->value = _position;
+		scene->transforms.MarkDirty(entity);
+	}
+
+	void SetRotation(const glm::quat& _rotation)
+	{
+		scene->world.Get<skel::Rotation>(entity)->value = _rotation;
+		scene->transforms.MarkDirty(entity);
+	}
 
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(_commandBuffer, 0, 1, &mesh->vertexBuffer, offsets);
-		vkCmdBindIndexBuffer(_commandBuffer, mesh->indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-		vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, 0, 1, &shader.descriptorSet, 0, nullptr);
-		vkCmdDrawIndexed(_commandBuffer, (uint32_t)mesh->indices.size(), 1, 0, 0, 0);
+	// XYZ Euler degrees -- Converted once here, the per-frame update only reads the quaternion
+	void SetRotation(const glm::vec3& _eulerDegrees)
+	{
+		SetRotation(glm::quat(glm::radians(_eulerDegrees)));
+	}
+
+	void SetScale(const glm::vec3& _scale)
+	{
+		scene->world.Get<skel::Scale>(entity)->value = _scale;
+		scene->transforms.MarkDirty(entity);
+	}
+
+	// Moves with _parent from now on -- nullptr detaches
+	void SetParent(Object* _parent)
+	{
+		scene->transforms.SetParent(entity, _parent ? _parent->entity : ecs::Entity());
+	}
+
+	// Static objects are culled & picked through the scene's BVH -- Moving one afterwards rebuilds it
+	void SetStatic(bool _static)
+	{
+		scene->SetStatic(entity, _static);
+	}
+
+	// Occluders are drawn into the renderer's software occlusion buffer while they are in view
+	void SetOccluder(bool _occluder)
+	{
+		if (_occluder && !scene->world.Has<skel::Occluder>(entity))
+			scene->world.Add(entity, skel::Occluder());
+		else if (!_occluder && scene->world.Has<skel::Occluder>(entity))
+			scene->world.Remove<skel::Occluder>(entity);
+	}
+
+	void SetMaterialIndex(uint32_t _materialIndex)
+	{
+		scene->world.Get<skel::Material>(entity)->materialIndex = _materialIndex;
+		scene->MarkChanged(entity);
 	}
 
-	// Turns the Transform into its model matrix
-	// Updates the other matrices
-	void UpdateMVPBuffer(glm::vec3 _camPosition, glm::mat4 _projection, glm::mat4 _view)
+private:
+	// Called by the streamer as each file arrives -- The object joins the draw list with the last one
+	void OnStreamed()
 	{
-		mvp.model = glm::translate(glm::mat4(1.0f), transform.position);
-		glm::fquat rotationQuaternion = {glm::radians(transform.rotation)};
-		mvp.model *= glm::mat4_cast(rotationQuaternion);
-		mvp.model = glm::scale(mvp.model, transform.scale);
-
-		mvp.view		= _view;
-		mvp.proj		= _projection;
-		mvp.camPosition = _camPosition;
-		device->CopyDataToBufferMemory(&mvp, sizeof(mvp), shader.buffers[0]->memory);
+		for (const auto& request : streaming)
+		{
+			if (!request->IsReady())
+				return;
+		}
+		streaming.clear();
+
+		if (pendingDescriptor != nullptr)
+		{
+			CreateDescriptorSet(pendingDescriptor);
+			pendingDescriptor = nullptr;
+		}
+
+		if (mesh)
+		{
+			skel::Bounds* bounds = scene->world.Get<skel::Bounds>(entity);
+			bounds->min = mesh->boundsMin;
+			bounds->max = mesh->boundsMax;
+			bounds->radius = mesh->boundsRadius;
+			scene->world.Get<skel::MeshRef>(entity)->mesh = mesh;
+
+			// Recomputes the world bounds, and the spatial index with them
+			scene->transforms.MarkDirty(entity);
+		}
 	}
 
 };
 
-} // namespace skel
+// Recomputes every entity's model matrix, ignoring parents -- Chunks are split across threads
+// For worlds without a TransformHierarchy
+// Each chunk's components are already packed arrays, so they go straight to the batch kernels
+inline void UpdateModelMatrices(ecs::World& _world)
+{
+	typedef ecs::ChunkView<skel::Position, skel::Rotation, skel::Scale, skel::LocalToWorld> View;
+	_world.ParallelForEachChunk<skel::Position, skel::Rotation, skel::Scale, skel::LocalToWorld>([](View& _view) {
+		simd::ComposeModelMatrices(
+			&_view.Get<skel::Position>()->value,
+			&_view.Get<skel::Rotation>()->value,
+			&_view.Get<skel::Scale>()->value,
+			_view.count,
+			&_view.Get<skel::LocalToWorld>()->model
+			);
+	});
+}
 
+} // namespace skel
@@ -0,0 +1,515 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include "VulkanDevice.h"
+#include "Initializers.h"
+#include "Descriptors.h"
+#include "FramePacing.h"
+#include "Timeline.h"
+#include "Texture.h"
+
+namespace skel
+{
+	// One frame's occlusion results -- Read back when its frame slot is reused, so a few frames late
+	struct OcclusionStats
+	{
+		uint32_t tested = 0;		// Draws that survived frustum culling
+		uint32_t occluded = 0;		// Hidden behind the pyramid's depth
+		uint32_t drawnEarly = 0;	// Visible last frame -- Drawn before the pyramid was built
+		uint32_t drawnLate = 0;		// Newly visible
+
+		float OccludedRatio() const { return tested > 0 ? static_cast<float>(occluded) / static_cast<float>(tested) : 0.0f; }
+	};
+
+	// One frustum-visible draw -- Matches Candidate in the occlusion shaders
+	struct OcclusionCandidate
+	{
+		glm::vec3 center;	// World-space box
+		uint32_t objectIndex;
+		glm::vec3 extents;
+		uint32_t padding;
+	};
+
+	// Matches the occlusion shaders' push constants
+	struct OcclusionConstants
+	{
+		glm::mat4 viewProjection;
+		glm::vec2 pyramidSize;
+		uint32_t candidateCount;
+		uint32_t pyramidLevels;
+	};
+
+	// Matches hiz_reduce.comp's push constants
+	struct HiZConstants
+	{
+		int32_t sourceSize[2];
+		int32_t targetSize[2];
+	};
+
+	// Two-phase hierarchical-Z occlusion culling
+	//  - Early: draws that were visible last frame are drawn first
+	//  - Their depth is reduced into a pyramid of farthest depths
+	//  - Late: every draw is tested against the pyramid -- Newly visible ones are drawn, and the results kept for the next frame
+	// The CPU frustum culls and writes both phases' indirect commands; the GPU only fills in their instance counts
+	struct OcclusionCulling
+	{
+		static const uint32_t maxFramesInFlight = FramePacer::maxFramesInFlight;
+		static const uint32_t cullGroupSize = 64;	// local_size_x of the occlusion shaders
+		static const uint32_t reduceGroupSize = 8;	// local_size_x & y of hiz_reduce.comp
+
+		// Written by the CPU for every frame, read back through statsData -- Host visible, persistently mapped
+		struct FrameSlot
+		{
+			VkBuffer candidateBuffer = VK_NULL_HANDLE;
+			VkDeviceMemory candidateMemory = VK_NULL_HANDLE;
+			OcclusionCandidate* candidates = nullptr;
+
+			// The early phase's commands, then the late phase's
+			VkBuffer commandBuffer = VK_NULL_HANDLE;
+			VkDeviceMemory commandMemory = VK_NULL_HANDLE;
+			VkDrawIndexedIndirectCommand* commands = nullptr;
+
+			// drawnEarly, drawnLate, occluded, padding
+			VkBuffer statsBuffer = VK_NULL_HANDLE;
+			VkDeviceMemory statsMemory = VK_NULL_HANDLE;
+			uint32_t* statsData = nullptr;
+
+			uint32_t capacity = 0;		// Candidates
+			uint32_t candidateCount = 0;
+			bool pending = false;		// Culled on the GPU, but not yet read back
+		};
+
+		VulkanDevice* device = nullptr;
+		FrameSlot slots[maxFramesInFlight];
+
+		// Whether each object buffer entry passed the last late phase -- Shared by every frame slot, since frames run in order
+		VkBuffer visibilityBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory visibilityMemory = VK_NULL_HANDLE;
+		uint32_t visibilityCapacity = 0;
+		bool visibilityCleared = false;
+
+		VkSampler pointSampler = VK_NULL_HANDLE;
+		VkDescriptorSetLayout reduceSetLayout = VK_NULL_HANDLE;		// Source, target level
+		VkDescriptorSetLayout cullSetLayout = VK_NULL_HANDLE;		// Candidates, commands, visibility, stats
+		VkDescriptorSetLayout pyramidSetLayout = VK_NULL_HANDLE;	// Every pyramid level
+		VkPipelineLayout reducePipelineLayout = VK_NULL_HANDLE;
+		VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;		// The early phase only uses set 0
+		// Created by the renderer with its other pipelines
+		VkPipeline reducePipeline = VK_NULL_HANDLE;
+		VkPipeline earlyPipeline = VK_NULL_HANDLE;
+		VkPipeline latePipeline = VK_NULL_HANDLE;
+
+		// Single-level views for the reduction -- Made for each compiled frame graph
+		VkImage pyramidImage = VK_NULL_HANDLE;
+		VkExtent2D pyramidExtent = {};
+		uint32_t pyramidLevels = 0;
+		std::vector<VkImageView> pyramidLevelViews;
+
+		OcclusionStats stats;
+
+		void Create(VulkanDevice* _device)
+		{
+			device = _device;
+			VkDevice logicalDevice = device->logicalDevice;
+
+			std::array<VkDescriptorSetLayoutBinding, 2> reduceBindings = {
+				skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+				skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 1)
+			};
+			std::array<VkDescriptorSetLayoutBinding, 4> cullBindings = {
+				skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+				skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+				skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2),
+				skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 3)
+			};
+			VkDescriptorSetLayoutBinding pyramidBinding =
+				skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 0);
+
+			reduceSetLayout = CreateSetLayout(reduceBindings.data(), static_cast<uint32_t>(reduceBindings.size()));
+			cullSetLayout = CreateSetLayout(cullBindings.data(), static_cast<uint32_t>(cullBindings.size()));
+			pyramidSetLayout = CreateSetLayout(&pyramidBinding, 1);
+
+			VkPushConstantRange reduceRange = skel::initializers::PushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(HiZConstants));
+			VkPipelineLayoutCreateInfo layoutInfo = skel::initializers::PipelineLayoutCreateInfo(&reduceSetLayout, 1);
+			layoutInfo.pushConstantRangeCount = 1;
+			layoutInfo.pPushConstantRanges = &reduceRange;
+			if (vkCreatePipelineLayout(logicalDevice, &layoutInfo, nullptr, &reducePipelineLayout) != VK_SUCCESS)
+				throw std::runtime_error("Failed to create the Hi-Z pipeline layout");
+
+			VkDescriptorSetLayout cullSetLayouts[] = { cullSetLayout, pyramidSetLayout };
+			VkPushConstantRange cullRange = skel::initializers::PushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(OcclusionConstants));
+			layoutInfo = skel::initializers::PipelineLayoutCreateInfo(cullSetLayouts, 2);
+			layoutInfo.pushConstantRangeCount = 1;
+			layoutInfo.pPushConstantRanges = &cullRange;
+			if (vkCreatePipelineLayout(logicalDevice, &layoutInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS)
+				throw std::runtime_error("Failed to create the occlusion culling pipeline layout");
+
+			// Only read with texelFetch
+			VkSamplerCreateInfo samplerInfo = {};
+			samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+			samplerInfo.magFilter = VK_FILTER_NEAREST;
+			samplerInfo.minFilter = VK_FILTER_NEAREST;
+			samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+			samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+			samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+			samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+			samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+			if (vkCreateSampler(logicalDevice, &samplerInfo, nullptr, &pointSampler) != VK_SUCCESS)
+				throw std::runtime_error("Failed to create the Hi-Z sampler");
+
+			for (uint32_t i = 0; i < maxFramesInFlight; i++)
+				CreateSlotBuffers(slots[i], 1024);
+			CreateVisibilityBuffer(1024);
+		}
+
+		void Cleanup()
+		{
+			VkDevice logicalDevice = device->logicalDevice;
+
+			DestroyPyramidViews();
+			for (auto& slot : slots)
+				DestroySlotBuffers(slot, true);
+			vkDestroyBuffer(logicalDevice, visibilityBuffer, nullptr);
+			vkFreeMemory(logicalDevice, visibilityMemory, nullptr);
+
+			vkDestroySampler(logicalDevice, pointSampler, nullptr);
+			vkDestroyPipelineLayout(logicalDevice, reducePipelineLayout, nullptr);
+			vkDestroyPipelineLayout(logicalDevice, cullPipelineLayout, nullptr);
+			vkDestroyDescriptorSetLayout(logicalDevice, reduceSetLayout, nullptr);
+			vkDestroyDescriptorSetLayout(logicalDevice, cullSetLayout, nullptr);
+			vkDestroyDescriptorSetLayout(logicalDevice, pyramidSetLayout, nullptr);
+		}
+
+		void DestroyPipelines()
+		{
+			vkDestroyPipeline(device->logicalDevice, reducePipeline, nullptr);
+			vkDestroyPipeline(device->logicalDevice, earlyPipeline, nullptr);
+			vkDestroyPipeline(device->logicalDevice, latePipeline, nullptr);
+			reducePipeline = earlyPipeline = latePipeline = VK_NULL_HANDLE;
+		}
+
+		// Pyramid =====================================
+
+		// Level 0 is the largest power of two that fits in the depth buffer on each axis
+		// Rounding down keeps every level exactly half of the one before it
+		static VkExtent2D PyramidExtent(VkExtent2D _depthExtent)
+		{
+			VkExtent2D extent = { 1, 1 };
+			while (extent.width * 2 <= _depthExtent.width)
+				extent.width *= 2;
+			while (extent.height * 2 <= _depthExtent.height)
+				extent.height *= 2;
+			return extent;
+		}
+
+		static uint32_t PyramidLevels(VkExtent2D _extent)
+		{
+			uint32_t levels = 1;
+			while ((std::max(_extent.width, _extent.height) >> levels) > 0)
+				levels++;
+			return levels;
+		}
+
+		// Called after every frame graph compile -- The graph owns the image itself
+		void CreatePyramidViews(VkImage _image, VkExtent2D _extent, uint32_t _levels)
+		{
+			pyramidImage = _image;
+			pyramidExtent = _extent;
+			pyramidLevels = _levels;
+			pyramidLevelViews.resize(_levels);
+			for (uint32_t i = 0; i < _levels; i++)
+				pyramidLevelViews[i] = skel::CreateImageView(device, _image, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 1, i);
+		}
+
+		// Destroys the views once the timeline reaches _value
+		void RetirePyramidViews(DeletionQueue& _queue, uint64_t _value)
+		{
+			VkDevice logicalDevice = device->logicalDevice;
+			std::vector<VkImageView> views = pyramidLevelViews;
+			_queue.Push(_value, [logicalDevice, views]() {
+				for (const auto& view : views)
+					vkDestroyImageView(logicalDevice, view, nullptr);
+			});
+			pyramidLevelViews.clear();
+		}
+
+		void DestroyPyramidViews()
+		{
+			for (const auto& view : pyramidLevelViews)
+				vkDestroyImageView(device->logicalDevice, view, nullptr);
+			pyramidLevelViews.clear();
+		}
+
+		// Frames ======================================
+
+		// Reads back the slot's last results and makes room for _count candidates
+		// The slot's previous frame must be complete -- The caller then fills candidates and both phases' commands
+		FrameSlot& BeginFrame(uint32_t _slot, uint32_t _count)
+		{
+			FrameSlot& slot = slots[_slot];
+			if (slot.pending)
+			{
+				stats.tested = slot.candidateCount;
+				stats.drawnEarly = slot.statsData[0];
+				stats.drawnLate = slot.statsData[1];
+				stats.occluded = slot.statsData[2];
+				slot.pending = false;
+			}
+			std::memset(slot.statsData, 0, 4 * sizeof(uint32_t));
+
+			if (_count > slot.capacity)
+			{
+				DestroySlotBuffers(slot);
+				CreateSlotBuffers(slot, std::max(_count, slot.capacity * 2));
+			}
+			slot.candidateCount = _count;
+			return slot;
+		}
+
+		// Grows the visibility buffer to cover _objectCapacity object buffer entries
+		// The old buffer may still be in use by frames in flight -- It is destroyed once the timeline reaches _retireValue
+		// The new one starts cleared, so every draw waits for the late phase for a frame
+		void ReserveVisibility(uint32_t _objectCapacity, uint64_t _retireValue)
+		{
+			if (_objectCapacity <= visibilityCapacity)
+				return;
+
+			device->DestroyBufferAfter(_retireValue, visibilityBuffer, visibilityMemory);
+			CreateVisibilityBuffer(std::max(_objectCapacity, visibilityCapacity * 2));
+		}
+
+		// Early phase -- Sets the early commands' instance counts from last frame's visibility
+		void RecordEarly(VkCommandBuffer _commandBuffer, uint32_t _slot, TransientDescriptorAllocator& _descriptors)
+		{
+			FrameSlot& slot = slots[_slot];
+
+			// A new visibility buffer is cleared on the GPU before its first use
+			if (!visibilityCleared)
+			{
+				vkCmdFillBuffer(_commandBuffer, visibilityBuffer, 0, VK_WHOLE_SIZE, 0);
+
+				VkBufferMemoryBarrier barrier = {};
+				barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.buffer = visibilityBuffer;
+				barrier.size = VK_WHOLE_SIZE;
+				vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+				visibilityCleared = true;
+			}
+
+			if (slot.candidateCount == 0)
+				return;
+
+			VkDescriptorSet set = AllocateCullSet(_slot, _descriptors);
+			OcclusionConstants constants = {};
+			constants.candidateCount = slot.candidateCount;
+
+			vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, earlyPipeline);
+			vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &set, 0, nullptr);
+			vkCmdPushConstants(_commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+			vkCmdDispatch(_commandBuffer, (slot.candidateCount + cullGroupSize - 1) / cullGroupSize, 1, 1);
+		}
+
+		// Reduces the depth buffer into every pyramid level -- Each level waits for the one before it
+		// The pyramid is in the general layout throughout; _depthView is sampled in the read-only layout
+		void RecordPyramid(VkCommandBuffer _commandBuffer, uint32_t _slot, TransientDescriptorAllocator& _descriptors, VkImageView _depthView, VkExtent2D _depthExtent)
+		{
+			vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, reducePipeline);
+
+			VkExtent2D sourceExtent = _depthExtent;
+			for (uint32_t level = 0; level < pyramidLevels; level++)
+			{
+				VkExtent2D targetExtent = { std::max(pyramidExtent.width >> level, 1u), std::max(pyramidExtent.height >> level, 1u) };
+
+				VkDescriptorImageInfo sourceInfo = {
+					pointSampler,
+					level == 0 ? _depthView : pyramidLevelViews[level - 1],
+					level == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL
+				};
+				VkDescriptorImageInfo targetInfo = { VK_NULL_HANDLE, pyramidLevelViews[level], VK_IMAGE_LAYOUT_GENERAL };
+
+				VkDescriptorSet set = _descriptors.Allocate(device->logicalDevice, _slot, reduceSetLayout);
+				std::array<VkWriteDescriptorSet, 2> writes = {
+					skel::initializers::WriteDescriptorSet(set, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &sourceInfo, 0),
+					skel::initializers::WriteDescriptorSet(set, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &targetInfo, 1)
+				};
+				vkUpdateDescriptorSets(device->logicalDevice, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+				HiZConstants constants = {
+					{ static_cast<int32_t>(sourceExtent.width), static_cast<int32_t>(sourceExtent.height) },
+					{ static_cast<int32_t>(targetExtent.width), static_cast<int32_t>(targetExtent.height) }
+				};
+				vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, reducePipelineLayout, 0, 1, &set, 0, nullptr);
+				vkCmdPushConstants(_commandBuffer, reducePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+				vkCmdDispatch(
+					_commandBuffer,
+					(targetExtent.width + reduceGroupSize - 1) / reduceGroupSize,
+					(targetExtent.height + reduceGroupSize - 1) / reduceGroupSize,
+					1
+					);
+
+				// The next level reads this one -- The frame graph orders the last level against the late phase
+				if (level + 1 < pyramidLevels)
+				{
+					VkImageMemoryBarrier barrier = {};
+					barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+					barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+					barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+					barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+					barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+					barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					barrier.image = pyramidImage;
+					barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+					barrier.subresourceRange.baseMipLevel = level;
+					barrier.subresourceRange.levelCount = 1;
+					barrier.subresourceRange.layerCount = 1;
+					vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+				}
+
+				sourceExtent = targetExtent;
+			}
+		}
+
+		// Late phase -- Tests every candidate against the pyramid, sets the late commands' instance counts, and keeps the results
+		// _pyramidView covers every level, in the read-only layout
+		void RecordLate(VkCommandBuffer _commandBuffer, uint32_t _slot, TransientDescriptorAllocator& _descriptors, VkImageView _pyramidView, const glm::mat4& _viewProjection)
+		{
+			FrameSlot& slot = slots[_slot];
+			if (slot.candidateCount == 0)
+				return;
+
+			VkDescriptorSet sets[] = { AllocateCullSet(_slot, _descriptors), _descriptors.Allocate(device->logicalDevice, _slot, pyramidSetLayout) };
+			VkDescriptorImageInfo pyramidInfo = { pointSampler, _pyramidView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+			VkWriteDescriptorSet write = skel::initializers::WriteDescriptorSet(sets[1], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &pyramidInfo, 0);
+			vkUpdateDescriptorSets(device->logicalDevice, 1, &write, 0, nullptr);
+
+			OcclusionConstants constants = {};
+			constants.viewProjection = _viewProjection;
+			constants.pyramidSize = glm::vec2(static_cast<float>(pyramidExtent.width), static_cast<float>(pyramidExtent.height));
+			constants.candidateCount = slot.candidateCount;
+			constants.pyramidLevels = pyramidLevels;
+
+			vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, latePipeline);
+			vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 2, sets, 0, nullptr);
+			vkCmdPushConstants(_commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+			vkCmdDispatch(_commandBuffer, (slot.candidateCount + cullGroupSize - 1) / cullGroupSize, 1, 1);
+
+			// The counters are read on the host once the frame completes
+			VkMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+			slot.pending = true;
+		}
+
+	private:
+		VkDescriptorSetLayout CreateSetLayout(const VkDescriptorSetLayoutBinding* _bindings, uint32_t _count)
+		{
+			VkDescriptorSetLayoutCreateInfo createInfo = {};
+			createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+			createInfo.bindingCount = _count;
+			createInfo.pBindings = _bindings;
+
+			VkDescriptorSetLayout layout;
+			if (vkCreateDescriptorSetLayout(device->logicalDevice, &createInfo, nullptr, &layout) != VK_SUCCESS)
+				throw std::runtime_error("Failed to create an occlusion culling descriptor set layout");
+			return layout;
+		}
+
+		VkDescriptorSet AllocateCullSet(uint32_t _slot, TransientDescriptorAllocator& _descriptors)
+		{
+			const FrameSlot& slot = slots[_slot];
+			VkDescriptorSet set = _descriptors.Allocate(device->logicalDevice, _slot, cullSetLayout);
+
+			std::array<VkDescriptorBufferInfo, 4> bufferInfos = {
+				VkDescriptorBufferInfo{ slot.candidateBuffer, 0, VK_WHOLE_SIZE },
+				VkDescriptorBufferInfo{ slot.commandBuffer, 0, VK_WHOLE_SIZE },
+				VkDescriptorBufferInfo{ visibilityBuffer, 0, VK_WHOLE_SIZE },
+				VkDescriptorBufferInfo{ slot.statsBuffer, 0, VK_WHOLE_SIZE }
+			};
+			std::array<VkWriteDescriptorSet, 4> writes;
+			for (uint32_t i = 0; i < static_cast<uint32_t>(writes.size()); i++)
+				writes[i] = skel::initializers::WriteDescriptorSet(set, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &bufferInfos[i], i);
+			vkUpdateDescriptorSets(device->logicalDevice, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+			return set;
+		}
+
+		void CreateSlotBuffers(FrameSlot& _slot, uint32_t _capacity)
+		{
+			const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			void* data;
+
+			device->CreateBuffer(sizeof(OcclusionCandidate) * _capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, _slot.candidateBuffer, _slot.candidateMemory);
+			vkMapMemory(device->logicalDevice, _slot.candidateMemory, 0, VK_WHOLE_SIZE, 0, &data);
+			_slot.candidates = static_cast<OcclusionCandidate*>(data);
+
+			device->CreateBuffer(
+				sizeof(VkDrawIndexedIndirectCommand) * 2 * _capacity,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				hostVisible,
+				_slot.commandBuffer,
+				_slot.commandMemory
+				);
+			vkMapMemory(device->logicalDevice, _slot.commandMemory, 0, VK_WHOLE_SIZE, 0, &data);
+			_slot.commands = static_cast<VkDrawIndexedIndirectCommand*>(data);
+
+			if (_slot.statsBuffer == VK_NULL_HANDLE)
+			{
+				device->CreateBuffer(4 * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, _slot.statsBuffer, _slot.statsMemory);
+				vkMapMemory(device->logicalDevice, _slot.statsMemory, 0, VK_WHOLE_SIZE, 0, &data);
+				_slot.statsData = static_cast<uint32_t*>(data);
+				std::memset(_slot.statsData, 0, 4 * sizeof(uint32_t));
+			}
+
+			_slot.capacity = _capacity;
+		}
+
+		// Keeps the stats buffer unless _all -- It doesn't grow
+		void DestroySlotBuffers(FrameSlot& _slot, bool _all = false)
+		{
+			VkDevice logicalDevice = device->logicalDevice;
+			vkDestroyBuffer(logicalDevice, _slot.candidateBuffer, nullptr);
+			vkFreeMemory(logicalDevice, _slot.candidateMemory, nullptr);
+			vkDestroyBuffer(logicalDevice, _slot.commandBuffer, nullptr);
+			vkFreeMemory(logicalDevice, _slot.commandMemory, nullptr);
+			_slot.candidates = nullptr;
+			_slot.commands = nullptr;
+			_slot.capacity = 0;
+
+			if (_all)
+			{
+				vkDestroyBuffer(logicalDevice, _slot.statsBuffer, nullptr);
+				vkFreeMemory(logicalDevice, _slot.statsMemory, nullptr);
+				_slot.statsBuffer = VK_NULL_HANDLE;
+				_slot.statsData = nullptr;
+			}
+		}
+
+		void CreateVisibilityBuffer(uint32_t _capacity)
+		{
+			device->CreateBuffer(
+				sizeof(uint32_t) * _capacity,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				visibilityBuffer,
+				visibilityMemory
+				);
+			visibilityCapacity = _capacity;
+			visibilityCleared = false;
+		}
+	}; // OcclusionCulling
+
+} // namespace skel
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstring>
+
+#include <vulkan/vulkan.h>
+
+#include "VulkanDevice.h"
+
+namespace skel
+{
+	// The header Vulkan writes at the start of vkGetPipelineCacheData (VkPipelineCacheHeaderVersionOne)
+	struct PipelineCacheHeader
+	{
+		uint32_t headerSize;
+		uint32_t headerVersion;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	};
+
+	// A VkPipelineCache persisted to disk between runs
+	struct PipelineCache
+	{
+		VkPipelineCache cache = VK_NULL_HANDLE;
+		std::string path;
+		bool loadedFromDisk = false;
+
+		// Loads the cache file if its header matches this device, otherwise starts empty
+		void Create(VulkanDevice* _device, const char* _path)
+		{
+			path = _path;
+
+			std::vector<char> data;
+			std::ifstream stream(path, std::ios::ate | std::ios::binary);
+			if (stream.is_open())
+			{
+				size_t size = static_cast<size_t>(stream.tellg());
+				stream.seekg(0);
+				data.resize(size);
+				stream.read(data.data(), size);
+				stream.close();
+			}
+
+			loadedFromDisk = !data.empty() && IsCompatible(data, _device->properties);
+			if (!data.empty() && !loadedFromDisk)
+				std::printf("Discarding pipeline cache %s: created by a different device or driver\n", path.c_str());
+
+			VkPipelineCacheCreateInfo createInfo = {};
+			createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+			createInfo.initialDataSize = loadedFromDisk ? data.size() : 0;
+			createInfo.pInitialData = loadedFromDisk ? data.data() : nullptr;
+
+			if (vkCreatePipelineCache(_device->logicalDevice, &createInfo, nullptr, &cache) != VK_SUCCESS)
+				throw std::runtime_error("Failed to create pipeline cache");
+		}
+
+		// Compares the cache header against the device's vendor, device, and cache UUID
+		static bool IsCompatible(const std::vector<char>& _data, const VkPhysicalDeviceProperties& _properties)
+		{
+			if (_data.size() < sizeof(PipelineCacheHeader))
+				return false;
+
+			PipelineCacheHeader header;
+			std::memcpy(&header, _data.data(), sizeof(header));
+
+			return header.headerSize >= sizeof(PipelineCacheHeader)
+				&& header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+				&& header.vendorID == _properties.vendorID
+				&& header.deviceID == _properties.deviceID
+				&& std::memcmp(header.pipelineCacheUUID, _properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+		}
+
+		// Writes the cache to disk
+		void Save(VkDevice _device)
+		{
+			if (cache == VK_NULL_HANDLE)
+				return;
+
+			size_t size = 0;
+			vkGetPipelineCacheData(_device, cache, &size, nullptr);
+			std::vector<char> data(size);
+			if (size == 0 || vkGetPipelineCacheData(_device, cache, &size, data.data()) != VK_SUCCESS)
+				return;
+
+			std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+			if (!stream.is_open())
+			{
+				std::printf("Failed to write pipeline cache %s\n", path.c_str());
+				return;
+			}
+			stream.write(data.data(), size);
+			stream.close();
+		}
+
+		void Cleanup(VkDevice _device)
+		{
+			vkDestroyPipelineCache(_device, cache, nullptr);
+			cache = VK_NULL_HANDLE;
+		}
+	}; // PipelineCache
+
+} // namespace skel
@@ -0,0 +1,178 @@
+#pragma once
+
+// Scoped CPU zones -- Compiled out unless SKEL_ENABLE_PROFILER is defined (see Common.h)
+//   SKEL_PROFILE_SCOPE("Name");		Times the rest of the enclosing scope
+//   SKEL_PROFILE_FUNCTION();			Same, named after the function
+//   SKEL_PROFILE_WRITE_TRACE(path);	Writes every buffered zone as a Chrome/Perfetto trace
+
+#ifdef SKEL_ENABLE_PROFILER
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace skel
+{
+	namespace profiler
+	{
+		// Names must outlive the trace -- String literals and __FUNCTION__ do
+		struct Zone
+		{
+			const char* name;
+			uint64_t start;		// Nanoseconds since the profiler's epoch
+			uint64_t end;
+		};
+
+		inline std::chrono::steady_clock::time_point Epoch()
+		{
+			static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+			return epoch;
+		}
+
+		inline uint64_t Now()
+		{
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Epoch()).count());
+		}
+
+		// Single-producer ring owned by one thread -- The writer never blocks or allocates
+		// Flushing reads from the other end; zones recorded while the ring is full are dropped
+		struct ThreadBuffer
+		{
+			static const uint32_t capacity = 1 << 16;	// Power of two
+
+			std::vector<Zone> zones;
+			std::atomic<uint64_t> head;		// Written by the owning thread
+			std::atomic<uint64_t> tail;		// Written by the flushing thread
+			std::atomic<uint64_t> dropped;
+			uint32_t threadIndex;
+
+			explicit ThreadBuffer(uint32_t _threadIndex) : zones(capacity), head(0), tail(0), dropped(0), threadIndex(_threadIndex) {}
+
+			void Push(const Zone& _zone)
+			{
+				uint64_t index = head.load(std::memory_order_relaxed);
+				if (index - tail.load(std::memory_order_acquire) >= capacity)
+				{
+					dropped.fetch_add(1, std::memory_order_relaxed);
+					return;
+				}
+
+				zones[index & (capacity - 1)] = _zone;
+				head.store(index + 1, std::memory_order_release);
+			}
+
+			// Moves every completed zone into _out
+			void Drain(std::vector<Zone>& _out)
+			{
+				uint64_t end = head.load(std::memory_order_acquire);
+				uint64_t begin = tail.load(std::memory_order_relaxed);
+				for (uint64_t i = begin; i < end; i++)
+					_out.push_back(zones[i & (capacity - 1)]);
+				tail.store(end, std::memory_order_release);
+			}
+		};
+
+		// Every thread's buffer -- Locked only when a thread records its first zone, and when flushing
+		struct Registry
+		{
+			std::mutex mutex;
+			std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+		};
+
+		inline Registry& GetRegistry()
+		{
+			static Registry registry;
+			return registry;
+		}
+
+		inline ThreadBuffer* GetThreadBuffer()
+		{
+			static thread_local ThreadBuffer* buffer = nullptr;
+			if (buffer == nullptr)
+			{
+				Registry& registry = GetRegistry();
+				std::lock_guard<std::mutex> lock(registry.mutex);
+				registry.buffers.emplace_back(new ThreadBuffer(static_cast<uint32_t>(registry.buffers.size())));
+				buffer = registry.buffers.back().get();
+			}
+			return buffer;
+		}
+
+		class ScopedZone
+		{
+		public:
+			explicit ScopedZone(const char* _name) : name(_name), start(Now()) {}
+			~ScopedZone() { GetThreadBuffer()->Push({ name, start, Now() }); }
+
+			ScopedZone(const ScopedZone&) = delete;
+			ScopedZone& operator=(const ScopedZone&) = delete;
+
+		private:
+			const char* name;
+			uint64_t start;
+		};
+
+		// Drains every thread's buffer into a Chrome trace event file (chrome://tracing, ui.perfetto.dev)
+		// Zones are consumed -- The next trace only holds zones recorded after this one
+		inline void WriteTrace(const char* _path)
+		{
+			std::ofstream file(_path, std::ios::out | std::ios::trunc);
+			if (!file.is_open())
+			{
+				std::printf("Failed to write CPU trace to %s\n", _path);
+				return;
+			}
+
+			Registry& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+
+			file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+			bool first = true;
+			uint64_t dropped = 0;
+			std::vector<Zone> zones;
+
+			for (const auto& buffer : registry.buffers)
+			{
+				zones.clear();
+				buffer->Drain(zones);
+				dropped += buffer->dropped.exchange(0);
+
+				file << (first ? "" : ",\n")
+					<< "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadIndex
+					<< ",\"args\":{\"name\":\"Thread " << buffer->threadIndex << "\"}}";
+				first = false;
+
+				// Microseconds with nanosecond precision
+				for (const auto& zone : zones)
+				{
+					file << ",\n{\"name\":\"" << zone.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadIndex
+						<< ",\"ts\":" << zone.start / 1000.0 << ",\"dur\":" << (zone.end - zone.start) / 1000.0 << "}";
+				}
+			}
+			file << "\n],\"displayTimeUnit\":\"ns\"}\n";
+
+			std::printf("CPU trace written to %s (%llu zones dropped)\n", _path, static_cast<unsigned long long>(dropped));
+		}
+
+	} // namespace profiler
+} // namespace skel
+
+#define SKEL_PROFILE_CONCAT_INNER(a, b) a##b
+#define SKEL_PROFILE_CONCAT(a, b) SKEL_PROFILE_CONCAT_INNER(a, b)
+#define SKEL_PROFILE_SCOPE(name) skel::profiler::ScopedZone SKEL_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define SKEL_PROFILE_FUNCTION() SKEL_PROFILE_SCOPE(__FUNCTION__)
+#define SKEL_PROFILE_WRITE_TRACE(path) skel::profiler::WriteTrace(path)
+
+#else
+
+#define SKEL_PROFILE_SCOPE(name) ((void)0)
+#define SKEL_PROFILE_FUNCTION() ((void)0)
+#define SKEL_PROFILE_WRITE_TRACE(path) std::printf("CPU profiler is compiled out -- Define SKEL_ENABLE_PROFILER\n")
+
+#endif // SKEL_ENABLE_PROFILER
@@ -0,0 +1,910 @@
+
+#include "RenderGraph.h"
+
+#include <algorithm>
+
+#include "Texture.h"
+
+// ==============================================
+// Builder
+// ==============================================
+
+void skel::RenderGraphBuilder::WriteColor(RenderGraphHandle _handle, VkAttachmentLoadOp _loadOp, VkClearColorValue _clear)
+{
+	RenderGraph::Pass& pass = graph->passes[passIndex];
+
+	VkClearValue clearValue = {};
+	clearValue.color = _clear;
+	pass.colorAttachments.push_back({ _handle, _loadOp, clearValue });
+
+	// Loading keeps the previous contents, so the attachment is read as well
+	VkAccessFlags access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	if (_loadOp == VK_ATTACHMENT_LOAD_OP_LOAD)
+		access |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+
+	pass.accesses.push_back({
+		_handle,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		access,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+		_loadOp == VK_ATTACHMENT_LOAD_OP_LOAD,
+		true
+		});
+}
+
+void skel::RenderGraphBuilder::WriteDepth(RenderGraphHandle _handle, VkAttachmentLoadOp _loadOp, VkClearDepthStencilValue _clear)
+{
+	RenderGraph::Pass& pass = graph->passes[passIndex];
+
+	VkClearValue clearValue = {};
+	clearValue.depthStencil = _clear;
+	pass.depthAttachment = { _handle, _loadOp, clearValue };
+
+	// Depth testing always reads
+	pass.accesses.push_back({
+		_handle,
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+		_loadOp == VK_ATTACHMENT_LOAD_OP_LOAD,
+		true
+		});
+}
+
+// Depth tested against, but not written
+void skel::RenderGraphBuilder::ReadDepth(RenderGraphHandle _handle)
+{
+	RenderGraph::Pass& pass = graph->passes[passIndex];
+	pass.depthAttachment = { _handle, VK_ATTACHMENT_LOAD_OP_LOAD, {} };
+
+	pass.accesses.push_back({
+		_handle,
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+		true,
+		false
+		});
+}
+
+void skel::RenderGraphBuilder::ReadTexture(RenderGraphHandle _handle, VkPipelineStageFlags _stages)
+{
+	graph->passes[passIndex].accesses.push_back({
+		_handle, _stages, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, true, false
+		});
+}
+
+void skel::RenderGraphBuilder::ReadStorageImage(RenderGraphHandle _handle, VkPipelineStageFlags _stages)
+{
+	graph->passes[passIndex].accesses.push_back({
+		_handle, _stages, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, true, false
+		});
+}
+
+void skel::RenderGraphBuilder::WriteStorageImage(RenderGraphHandle _handle, VkPipelineStageFlags _stages)
+{
+	graph->passes[passIndex].accesses.push_back({
+		_handle, _stages, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, false, true
+		});
+}
+
+void skel::RenderGraphBuilder::ReadTransferImage(RenderGraphHandle _handle)
+{
+	graph->passes[passIndex].accesses.push_back({
+		_handle, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, true, false
+		});
+}
+
+void skel::RenderGraphBuilder::WriteTransferImage(RenderGraphHandle _handle)
+{
+	graph->passes[passIndex].accesses.push_back({
+		_handle, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT, false, true
+		});
+}
+
+void skel::RenderGraphBuilder::ReadBuffer(RenderGraphHandle _handle, VkPipelineStageFlags _stages, VkAccessFlags _access)
+{
+	graph->passes[passIndex].accesses.push_back({
+		_handle, _stages, _access, VK_IMAGE_LAYOUT_UNDEFINED, 0, true, false
+		});
+}
+
+void skel::RenderGraphBuilder::WriteBuffer(RenderGraphHandle _handle, VkPipelineStageFlags _stages, VkAccessFlags _access)
+{
+	graph->passes[passIndex].accesses.push_back({
+		_handle, _stages, _access, VK_IMAGE_LAYOUT_UNDEFINED, 0, false, true
+		});
+}
+
+void skel::RenderGraphBuilder::SideEffect()
+{
+	graph->passes[passIndex].sideEffect = true;
+}
+
+// ==============================================
+// Resources & passes
+// ==============================================
+
+skel::RenderGraphHandle skel::RenderGraph::CreateImage(const char* _name, VkFormat _format, VkExtent2D _extent, VkImageAspectFlags _aspect, uint32_t _mipLevels /*= 1*/)
+{
+	Resource resource = {};
+	resource.name = _name;
+	resource.isImage = true;
+	resource.imported = false;
+	resource.format = _format;
+	resource.extent = _extent;
+	resource.aspect = _aspect;
+	resource.mipLevels = _mipLevels;
+
+	resources.push_back(resource);
+	return static_cast<RenderGraphHandle>(resources.size()) - 1;
+}
+
+skel::RenderGraphHandle skel::RenderGraph::ImportImage(
+	const char* _name,
+	VkFormat _format,
+	VkExtent2D _extent,
+	VkImageAspectFlags _aspect,
+	VkImageLayout _initialLayout,
+	VkImageLayout _finalLayout,
+	VkPipelineStageFlags _initialStages /*= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT*/
+	)
+{
+	RenderGraphHandle handle = CreateImage(_name, _format, _extent, _aspect);
+	Resource& resource = resources[handle];
+	resource.imported = true;
+	resource.initialLayout = _initialLayout;
+	resource.finalLayout = _finalLayout;
+	resource.initialStages = _initialStages;
+	return handle;
+}
+
+skel::RenderGraphHandle skel::RenderGraph::ImportBuffer(const char* _name, VkBuffer _buffer, VkDeviceSize _size)
+{
+	Resource resource = {};
+	resource.name = _name;
+	resource.isImage = false;
+	resource.imported = true;
+	resource.buffer = _buffer;
+	resource.size = _size;
+
+	resources.push_back(resource);
+	return static_cast<RenderGraphHandle>(resources.size()) - 1;
+}
+
+void skel::RenderGraph::SetImportedImage(RenderGraphHandle _handle, VkImage _image, VkImageView _view)
+{
+	resources[_handle].image = _image;
+	resources[_handle].view = _view;
+}
+
+void skel::RenderGraph::SetImportedBuffer(RenderGraphHandle _handle, VkBuffer _buffer)
+{
+	resources[_handle].buffer = _buffer;
+}
+
+void skel::RenderGraph::SetOutput(RenderGraphHandle _handle)
+{
+	resources[_handle].output = true;
+}
+
+void skel::RenderGraph::AddPass(const char* _name, const SetupCallback& _setup, const ExecuteCallback& _execute)
+{
+	Pass pass;
+	pass.name = _name;
+	pass.execute = _execute;
+	passes.push_back(pass);
+
+	RenderGraphBuilder builder(this, static_cast<uint32_t>(passes.size()) - 1);
+	_setup(builder);
+}
+
+// ==============================================
+// Compilation
+// ==============================================
+
+void skel::RenderGraph::Compile(VulkanDevice* _device)
+{
+	device = _device;
+	stats = {};
+	stats.passes = static_cast<uint32_t>(passes.size());
+
+	CullPasses();
+	ComputeLifetimes();
+	CreateTransientImages();
+	BuildBarriers();
+	CreateRenderPasses();
+}
+
+// Walks the passes backwards from the outputs -- A pass survives if a later surviving pass (or an output) needs what it writes
+void skel::RenderGraph::CullPasses()
+{
+	std::vector<bool> needed(resources.size(), false);
+	for (uint32_t i = 0; i < static_cast<uint32_t>(resources.size()); i++)
+		needed[i] = resources[i].output;
+
+	for (int i = static_cast<int>(passes.size()) - 1; i >= 0; i--)
+	{
+		Pass& pass = passes[i];
+
+		bool alive = pass.sideEffect;
+		for (const auto& access : pass.accesses)
+			if (access.write && needed[access.resource])
+				alive = true;
+
+		pass.culled = !alive;
+		if (!alive)
+		{
+			stats.culledPasses++;
+			continue;
+		}
+
+		// A full overwrite hides earlier writers, unless this pass also reads the old contents
+		for (const auto& access : pass.accesses)
+			if (access.write && !access.read)
+				needed[access.resource] = false;
+		for (const auto& access : pass.accesses)
+			if (access.read)
+				needed[access.resource] = true;
+	}
+}
+
+void skel::RenderGraph::ComputeLifetimes()
+{
+	for (auto& resource : resources)
+	{
+		resource.firstPass = -1;
+		resource.lastPass = -1;
+	}
+
+	for (int i = 0; i < static_cast<int>(passes.size()); i++)
+	{
+		if (passes[i].culled)
+			continue;
+
+		for (const auto& access : passes[i].accesses)
+		{
+			Resource& resource = resources[access.resource];
+			if (resource.firstPass < 0)
+				resource.firstPass = i;
+			resource.lastPass = i;
+			resource.usage |= access.usage;
+		}
+	}
+}
+
+// Creates every transient image that survived culling
+// Images whose lifetimes don't overlap share a memory block sized to the largest of them
+void skel::RenderGraph::CreateTransientImages()
+{
+	struct MemoryBlock
+	{
+		VkDeviceSize size;
+		uint32_t memoryTypeBits;
+		std::vector<RenderGraphHandle> images;
+	};
+
+	std::vector<RenderGraphHandle> transients;
+	std::vector<VkMemoryRequirements> requirements(resources.size());
+
+	for (uint32_t i = 0; i < static_cast<uint32_t>(resources.size()); i++)
+	{
+		Resource& resource = resources[i];
+		if (!resource.isImage || resource.imported || resource.firstPass < 0)
+			continue;
+
+		VkImageCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		createInfo.imageType = VK_IMAGE_TYPE_2D;
+		createInfo.extent = { resource.extent.width, resource.extent.height, 1 };
+		createInfo.mipLevels = resource.mipLevels;
+		createInfo.arrayLayers = 1;
+		createInfo.format = resource.format;
+		createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		createInfo.usage = resource.usage;
+		createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateImage(device->logicalDevice, &createInfo, nullptr, &resource.image) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create render graph image");
+
+		vkGetImageMemoryRequirements(device->logicalDevice, resource.image, &requirements[i]);
+		stats.transientBytesRequested += requirements[i].size;
+		stats.transientImages++;
+		transients.push_back(i);
+	}
+
+	// Largest first so small images fill blocks made for large ones
+	std::sort(transients.begin(), transients.end(), [&](RenderGraphHandle a, RenderGraphHandle b) {
+		return requirements[a].size > requirements[b].size;
+	});
+
+	std::vector<MemoryBlock> blocks;
+	for (const auto& handle : transients)
+	{
+		const Resource& resource = resources[handle];
+		const VkMemoryRequirements& reqs = requirements[handle];
+
+		int chosen = -1;
+		for (int b = 0; b < static_cast<int>(blocks.size()) && chosen < 0; b++)
+		{
+			if ((blocks[b].memoryTypeBits & reqs.memoryTypeBits) == 0)
+				continue;
+
+			bool overlaps = false;
+			for (const auto& other : blocks[b].images)
+				if (resources[other].firstPass <= resource.lastPass && resource.firstPass <= resources[other].lastPass)
+					overlaps = true;
+
+			if (!overlaps)
+				chosen = b;
+		}
+
+		if (chosen < 0)
+		{
+			blocks.push_back({ 0, reqs.memoryTypeBits, {} });
+			chosen = static_cast<int>(blocks.size()) - 1;
+		}
+
+		MemoryBlock& block = blocks[chosen];
+		block.size = std::max(block.size, reqs.size);
+		block.memoryTypeBits &= reqs.memoryTypeBits;
+		block.images.push_back(handle);
+		resources[handle].memoryBlock = chosen;
+	}
+
+	for (auto& block : blocks)
+	{
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = block.size;
+		allocInfo.memoryTypeIndex = skel::FindMemoryType(device, block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		VkDeviceMemory memory;
+		if (vkAllocateMemory(device->logicalDevice, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+			throw std::runtime_error("Failed to allocate render graph memory");
+		memoryBlocks.push_back(memory);
+		stats.transientBytesAllocated += block.size;
+
+		// In execution order -- Each image takes over the memory from the one before it
+		// The first image follows the last one of the previous frame
+		std::sort(block.images.begin(), block.images.end(), [&](RenderGraphHandle a, RenderGraphHandle b) {
+			return resources[a].firstPass < resources[b].firstPass;
+		});
+
+		for (uint32_t i = 0; i < static_cast<uint32_t>(block.images.size()); i++)
+		{
+			Resource& resource = resources[block.images[i]];
+			resource.previousAlias = block.images[(i + static_cast<uint32_t>(block.images.size()) - 1) % block.images.size()];
+
+			vkBindImageMemory(device->logicalDevice, resource.image, memory, 0);
+			resource.view = skel::CreateImageView(device, resource.image, resource.format, resource.aspect, resource.mipLevels);
+		}
+	}
+	stats.memoryBlocks = static_cast<uint32_t>(blocks.size());
+}
+
+// Tracks each resource's last write and the reads since, emitting a barrier only for
+// layout changes, read-after-write, write-after-write, and write-after-read
+void skel::RenderGraph::BuildBarriers()
+{
+	struct State
+	{
+		VkImageLayout layout;
+		VkPipelineStageFlags writeStages;
+		VkAccessFlags writeAccess;
+		VkPipelineStageFlags readStages;
+		VkAccessFlags readAccess;
+	};
+
+	// Accesses of one resource in one pass are merged
+	struct MergedAccess
+	{
+		RenderGraphHandle resource;
+		VkPipelineStageFlags stages;
+		VkAccessFlags access;
+		VkImageLayout layout;
+		bool read;
+		bool write;
+	};
+
+	std::vector<State> states(resources.size());
+
+	auto simulate = [&](bool _record) {
+		for (auto& pass : passes)
+		{
+			if (pass.culled)
+				continue;
+
+			std::vector<MergedAccess> merged;
+			for (const auto& access : pass.accesses)
+			{
+				auto found = std::find_if(merged.begin(), merged.end(), [&](const MergedAccess& m) { return m.resource == access.resource; });
+				if (found == merged.end())
+				{
+					merged.push_back({ access.resource, access.stages, access.access, access.layout, access.read, access.write });
+					continue;
+				}
+
+				if (resources[access.resource].isImage && found->layout != access.layout)
+					throw std::runtime_error("Render graph pass uses an image in two layouts");
+				found->stages |= access.stages;
+				found->access |= access.access;
+				found->read |= access.read;
+				found->write |= access.write;
+			}
+
+			for (const auto& access : merged)
+			{
+				const Resource& resource = resources[access.resource];
+				State& state = states[access.resource];
+
+				bool transition = resource.isImage && access.layout != state.layout;
+				VkPipelineStageFlags srcStages = 0;
+				VkAccessFlags srcAccess = 0;
+				bool barrier = false;
+
+				if (transition || access.write)
+				{
+					// Wait for the last write and every read since
+					srcStages = state.writeStages | state.readStages;
+					srcAccess = state.writeAccess;
+					barrier = transition || srcStages != 0;
+
+					state.writeStages = access.stages;
+					state.writeAccess = access.write ? access.access : 0;
+					state.readStages = access.read ? access.stages : 0;
+					state.readAccess = access.read ? access.access : 0;
+					state.layout = access.layout;
+				}
+				else
+				{
+					// Read-after-write -- Only stages that haven't already waited for the write
+					bool covered = (access.stages & ~state.readStages) == 0 && (access.access & ~state.readAccess) == 0;
+					srcStages = state.writeStages;
+					srcAccess = state.writeAccess;
+					barrier = state.writeStages != 0 && !covered;
+
+					state.readStages |= access.stages;
+					state.readAccess |= access.access;
+				}
+
+				if (!_record || !barrier)
+					continue;
+
+				pass.barrierSrcStages |= srcStages != 0 ? srcStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+				pass.barrierDstStages |= access.stages;
+
+				if (resource.isImage)
+				{
+					VkImageMemoryBarrier imageBarrier = {};
+					imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+					imageBarrier.srcAccessMask = srcAccess;
+					imageBarrier.dstAccessMask = access.access;
+					// A transient image starts each frame undefined, but keeps its contents between passes
+					imageBarrier.oldLayout = transition ? state.layout : access.layout;
+					imageBarrier.newLayout = access.layout;
+					imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					imageBarrier.subresourceRange.aspectMask = resource.aspect;
+					imageBarrier.subresourceRange.levelCount = resource.mipLevels;
+					imageBarrier.subresourceRange.layerCount = 1;
+					pass.imageBarriers.push_back(imageBarrier);
+					pass.imageBarrierResources.push_back(access.resource);
+				}
+				else
+				{
+					VkBufferMemoryBarrier bufferBarrier = {};
+					bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+					bufferBarrier.srcAccessMask = srcAccess;
+					bufferBarrier.dstAccessMask = access.access;
+					bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					bufferBarrier.offset = 0;
+					bufferBarrier.size = VK_WHOLE_SIZE;
+					pass.bufferBarriers.push_back(bufferBarrier);
+					pass.bufferBarrierResources.push_back(access.resource);
+				}
+			}
+		}
+	};
+
+	// The first run finds the state every resource is left in at the end of a frame
+	for (auto& state : states)
+		state = { VK_IMAGE_LAYOUT_UNDEFINED, 0, 0, 0, 0 };
+	simulate(false);
+	std::vector<State> endStates = states;
+
+	// The second records barriers, starting from the previous frame's end states
+	for (uint32_t i = 0; i < static_cast<uint32_t>(resources.size()); i++)
+	{
+		const Resource& resource = resources[i];
+		if (resource.isImage && resource.imported)
+		{
+			// Whatever brought the image into its initial layout (ex: acquire) is waited for at initialStages
+			states[i] = { resource.initialLayout, resource.initialStages, 0, 0, 0 };
+		}
+		else if (resource.isImage)
+		{
+			// Contents are discarded each frame, but the previous user of the memory must be finished
+			const State& previous = endStates[resource.previousAlias != RenderGraphNullHandle ? resource.previousAlias : i];
+			states[i] = { VK_IMAGE_LAYOUT_UNDEFINED, previous.writeStages | previous.readStages, previous.writeAccess, 0, 0 };
+		}
+		else
+		{
+			states[i] = endStates[i];
+			states[i].readStages = 0;
+			states[i].readAccess = 0;
+			states[i].writeStages |= endStates[i].readStages;
+		}
+	}
+	simulate(true);
+
+	// Imported images are handed back in their final layouts
+	for (uint32_t i = 0; i < static_cast<uint32_t>(resources.size()); i++)
+	{
+		const Resource& resource = resources[i];
+		const State& state = states[i];
+		if (!resource.isImage || !resource.imported || resource.firstPass < 0)
+			continue;
+		if (resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || resource.finalLayout == state.layout)
+			continue;
+
+		VkPipelineStageFlags dstStages;
+		VkAccessFlags dstAccess;
+		switch (resource.finalLayout)
+		{
+		case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+			dstStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+			dstAccess = 0;
+			break;
+		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+			dstStages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			dstAccess = VK_ACCESS_TRANSFER_READ_BIT;
+			break;
+		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+			dstStages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+			dstAccess = VK_ACCESS_SHADER_READ_BIT;
+			break;
+		default:
+			dstStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			dstAccess = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+		}
+
+		VkImageMemoryBarrier imageBarrier = {};
+		imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageBarrier.srcAccessMask = state.writeAccess;
+		imageBarrier.dstAccessMask = dstAccess;
+		imageBarrier.oldLayout = state.layout;
+		imageBarrier.newLayout = resource.finalLayout;
+		imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.subresourceRange.aspectMask = resource.aspect;
+		imageBarrier.subresourceRange.levelCount = resource.mipLevels;
+		imageBarrier.subresourceRange.layerCount = 1;
+
+		finalSrcStages |= (state.writeStages | state.readStages) != 0 ? (state.writeStages | state.readStages) : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+		finalDstStages |= dstStages;
+		finalBarriers.push_back(imageBarrier);
+		finalBarrierResources.push_back(i);
+	}
+
+	for (const auto& pass : passes)
+	{
+		stats.imageBarriers += static_cast<uint32_t>(pass.imageBarriers.size());
+		stats.bufferBarriers += static_cast<uint32_t>(pass.bufferBarriers.size());
+		if (!pass.imageBarriers.empty() || !pass.bufferBarriers.empty())
+			stats.pipelineBarrierCalls++;
+	}
+	stats.imageBarriers += static_cast<uint32_t>(finalBarriers.size());
+	if (!finalBarriers.empty())
+		stats.pipelineBarrierCalls++;
+}
+
+// Barriers handle every transition, so attachments start and end in the layout the pass uses
+void skel::RenderGraph::CreateRenderPasses()
+{
+	for (int p = 0; p < static_cast<int>(passes.size()); p++)
+	{
+		Pass& pass = passes[p];
+		if (pass.culled || (pass.colorAttachments.empty() && pass.depthAttachment.resource == RenderGraphNullHandle))
+			continue;
+
+		std::vector<VkAttachmentDescription> attachments;
+		std::vector<VkAttachmentReference> colorReferences;
+		VkAttachmentReference depthReference = {};
+
+		// Contents that nothing reads later don't need to be written back to memory
+		auto storeOp = [&](RenderGraphHandle _handle) {
+			const Resource& resource = resources[_handle];
+			return (resource.imported || resource.lastPass > p) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		};
+
+		for (const auto& color : pass.colorAttachments)
+		{
+			const Resource& resource = resources[color.resource];
+
+			VkAttachmentDescription description = {};
+			description.format = resource.format;
+			description.samples = VK_SAMPLE_COUNT_1_BIT;
+			description.loadOp = color.loadOp;
+			description.storeOp = storeOp(color.resource);
+			description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			description.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			description.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+			colorReferences.push_back({ static_cast<uint32_t>(attachments.size()), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
+			attachments.push_back(description);
+			pass.renderArea = resource.extent;
+		}
+
+		if (pass.depthAttachment.resource != RenderGraphNullHandle)
+		{
+			const Resource& resource = resources[pass.depthAttachment.resource];
+			bool readOnly = true;
+			for (const auto& access : pass.accesses)
+				if (access.resource == pass.depthAttachment.resource && access.write)
+					readOnly = false;
+			VkImageLayout layout = readOnly ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+			VkAttachmentDescription description = {};
+			description.format = resource.format;
+			description.samples = VK_SAMPLE_COUNT_1_BIT;
+			description.loadOp = pass.depthAttachment.loadOp;
+			description.storeOp = readOnly ? VK_ATTACHMENT_STORE_OP_DONT_CARE : storeOp(pass.depthAttachment.resource);
+			description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			description.initialLayout = layout;
+			description.finalLayout = layout;
+
+			depthReference = { static_cast<uint32_t>(attachments.size()), layout };
+			attachments.push_back(description);
+			pass.renderArea = resource.extent;
+		}
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
+		subpass.pColorAttachments = colorReferences.data();
+		subpass.pDepthStencilAttachment = pass.depthAttachment.resource != RenderGraphNullHandle ? &depthReference : nullptr;
+
+		std::vector<uint32_t> key;
+		for (const auto& attachment : attachments)
+		{
+			key.push_back(attachment.format);
+			key.push_back(attachment.loadOp);
+			key.push_back(attachment.storeOp);
+			key.push_back(attachment.initialLayout);
+			key.push_back(attachment.finalLayout);
+		}
+		key.push_back(static_cast<uint32_t>(colorReferences.size()));
+
+		auto cached = renderPassCache.find(key);
+		if (cached != renderPassCache.end())
+		{
+			pass.renderPass = cached->second;
+			continue;
+		}
+
+		VkRenderPassCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		createInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+		createInfo.pAttachments = attachments.data();
+		createInfo.subpassCount = 1;
+		createInfo.pSubpasses = &subpass;
+
+		if (vkCreateRenderPass(device->logicalDevice, &createInfo, nullptr, &pass.renderPass) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create render graph render pass");
+		renderPassCache[key] = pass.renderPass;
+	}
+}
+
+// ==============================================
+// Execution
+// ==============================================
+
+void skel::RenderGraph::Execute(VkCommandBuffer _commandBuffer, GpuProfiler* _profiler /*= nullptr*/)
+{
+	for (auto& pass : passes)
+	{
+		if (pass.culled)
+			continue;
+
+		// Barriers are included in the pass' time
+		if (_profiler != nullptr)
+			_profiler->BeginZone(_commandBuffer, pass.name, "pass");
+
+		if (!pass.imageBarriers.empty() || !pass.bufferBarriers.empty())
+		{
+			// Imported handles can change between frames
+			for (uint32_t i = 0; i < static_cast<uint32_t>(pass.imageBarriers.size()); i++)
+				pass.imageBarriers[i].image = resources[pass.imageBarrierResources[i]].image;
+			for (uint32_t i = 0; i < static_cast<uint32_t>(pass.bufferBarriers.size()); i++)
+				pass.bufferBarriers[i].buffer = resources[pass.bufferBarrierResources[i]].buffer;
+
+			vkCmdPipelineBarrier(
+				_commandBuffer,
+				pass.barrierSrcStages,
+				pass.barrierDstStages,
+				0,
+				0, nullptr,
+				static_cast<uint32_t>(pass.bufferBarriers.size()), pass.bufferBarriers.data(),
+				static_cast<uint32_t>(pass.imageBarriers.size()), pass.imageBarriers.data()
+				);
+		}
+
+		if (pass.renderPass != VK_NULL_HANDLE)
+		{
+			std::vector<VkClearValue> clearValues;
+			for (const auto& color : pass.colorAttachments)
+				clearValues.push_back(color.clearValue);
+			if (pass.depthAttachment.resource != RenderGraphNullHandle)
+				clearValues.push_back(pass.depthAttachment.clearValue);
+
+			VkRenderPassBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			beginInfo.renderPass = pass.renderPass;
+			beginInfo.framebuffer = GetFramebuffer(pass);
+			beginInfo.renderArea.offset = { 0, 0 };
+			beginInfo.renderArea.extent = pass.renderArea;
+			beginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+			beginInfo.pClearValues = clearValues.data();
+
+			vkCmdBeginRenderPass(_commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+			pass.execute(_commandBuffer);
+			vkCmdEndRenderPass(_commandBuffer);
+		}
+		else
+		{
+			pass.execute(_commandBuffer);
+		}
+
+		if (_profiler != nullptr)
+			_profiler->EndZone(_commandBuffer);
+	}
+
+	if (!finalBarriers.empty())
+	{
+		for (uint32_t i = 0; i < static_cast<uint32_t>(finalBarriers.size()); i++)
+			finalBarriers[i].image = resources[finalBarrierResources[i]].image;
+
+		vkCmdPipelineBarrier(
+			_commandBuffer,
+			finalSrcStages,
+			finalDstStages,
+			0,
+			0, nullptr,
+			0, nullptr,
+			static_cast<uint32_t>(finalBarriers.size()), finalBarriers.data()
+			);
+	}
+}
+
+// Framebuffers are cached by their attachments -- Imported images create one per distinct view
+VkFramebuffer skel::RenderGraph::GetFramebuffer(Pass& _pass)
+{
+	std::vector<VkImageView> views;
+	for (const auto& color : _pass.colorAttachments)
+		views.push_back(resources[color.resource].view);
+	if (_pass.depthAttachment.resource != RenderGraphNullHandle)
+		views.push_back(resources[_pass.depthAttachment.resource].view);
+
+	auto found = framebuffers.find(views);
+	if (found != framebuffers.end())
+		return found->second;
+
+	VkFramebufferCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	createInfo.renderPass = _pass.renderPass;
+	createInfo.attachmentCount = static_cast<uint32_t>(views.size());
+	createInfo.pAttachments = views.data();
+	createInfo.width = _pass.renderArea.width;
+	createInfo.height = _pass.renderArea.height;
+	createInfo.layers = 1;
+
+	VkFramebuffer framebuffer;
+	if (vkCreateFramebuffer(device->logicalDevice, &createInfo, nullptr, &framebuffer) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create render graph framebuffer");
+
+	framebuffers[views] = framebuffer;
+	return framebuffer;
+}
+
+// ==============================================
+// Cleanup
+// ==============================================
+
+void skel::RenderGraph::Retire(DeletionQueue& _queue, uint64_t _value)
+{
+	if (device == nullptr)
+		return;
+
+	std::vector<VkFramebuffer> retiredFramebuffers;
+	for (const auto& framebuffer : framebuffers)
+		retiredFramebuffers.push_back(framebuffer.second);
+
+	std::vector<VkImage> retiredImages;
+	std::vector<VkImageView> retiredViews;
+	for (const auto& resource : resources)
+	{
+		if (!resource.isImage || resource.imported || resource.image == VK_NULL_HANDLE)
+			continue;
+		retiredImages.push_back(resource.image);
+		retiredViews.push_back(resource.view);
+	}
+
+	VkDevice logicalDevice = device->logicalDevice;
+	std::vector<VkDeviceMemory> retiredMemory = memoryBlocks;
+	_queue.Push(_value, [=]() {
+		for (const auto& framebuffer : retiredFramebuffers)
+			vkDestroyFramebuffer(logicalDevice, framebuffer, nullptr);
+		for (uint32_t i = 0; i < static_cast<uint32_t>(retiredImages.size()); i++)
+		{
+			vkDestroyImageView(logicalDevice, retiredViews[i], nullptr);
+			vkDestroyImage(logicalDevice, retiredImages[i], nullptr);
+		}
+		for (const auto& memory : retiredMemory)
+			vkFreeMemory(logicalDevice, memory, nullptr);
+	});
+
+	framebuffers.clear();
+	resources.clear();
+	memoryBlocks.clear();
+	Reset();
+}
+
+void skel::RenderGraph::Cleanup()
+{
+	if (device == nullptr)
+		return;
+
+	for (const auto& framebuffer : framebuffers)
+		vkDestroyFramebuffer(device->logicalDevice, framebuffer.second, nullptr);
+	framebuffers.clear();
+
+	for (const auto& renderPass : renderPassCache)
+		vkDestroyRenderPass(device->logicalDevice, renderPass.second, nullptr);
+	renderPassCache.clear();
+
+	for (const auto& resource : resources)
+	{
+		if (!resource.isImage || resource.imported || resource.image == VK_NULL_HANDLE)
+			continue;
+		vkDestroyImageView(device->logicalDevice, resource.view, nullptr);
+		vkDestroyImage(device->logicalDevice, resource.image, nullptr);
+	}
+	resources.clear();
+
+	for (const auto& memory : memoryBlocks)
+		vkFreeMemory(device->logicalDevice, memory, nullptr);
+	memoryBlocks.clear();
+
+	Reset();
+}
+
+// Forgets the passes and compile results -- Vulkan objects must already be destroyed or retired
+void skel::RenderGraph::Reset()
+{
+	passes.clear();
+	finalSrcStages = 0;
+	finalDstStages = 0;
+	finalBarriers.clear();
+	finalBarrierResources.clear();
+}
+
+void skel::RenderGraph::PrintStats()
+{
+	std::printf(
+		"Render graph: %d/%d passes (%d culled), %d image & %d buffer barriers in %d calls\n"
+		"              %d transient images in %d blocks, %.2f MB aliased into %.2f MB\n",
+		stats.passes - stats.culledPasses, stats.passes, stats.culledPasses,
+		stats.imageBarriers, stats.bufferBarriers, stats.pipelineBarrierCalls,
+		stats.transientImages, stats.memoryBlocks,
+		stats.transientBytesRequested / (1024.0f * 1024.0f), stats.transientBytesAllocated / (1024.0f * 1024.0f)
+		);
+}
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <map>
+#include <stdexcept>
+
+#include <vulkan/vulkan.h>
+
+#include "VulkanDevice.h"
+#include "GpuProfiler.h"
+#include "Timeline.h"
+
+namespace skel
+{
+	// Index of a resource in a RenderGraph
+	typedef uint32_t RenderGraphHandle;
+	static const RenderGraphHandle RenderGraphNullHandle = UINT32_MAX;
+
+	// How a pass touches a resource
+	struct RenderGraphAccess
+	{
+		RenderGraphHandle resource;
+		VkPipelineStageFlags stages;
+		VkAccessFlags access;
+		VkImageLayout layout;		// Images only
+		VkImageUsageFlags usage;	// Images only -- Gathered into the transient image's usage
+		bool read;
+		bool write;
+	};
+
+	// An image or depth attachment written by a raster pass
+	struct RenderGraphAttachment
+	{
+		RenderGraphHandle resource;
+		VkAttachmentLoadOp loadOp;
+		VkClearValue clearValue;
+	};
+
+	// Barrier and aliasing counters for the last compile
+	struct RenderGraphStats
+	{
+		uint32_t passes = 0;
+		uint32_t culledPasses = 0;
+		uint32_t imageBarriers = 0;			// Per frame
+		uint32_t bufferBarriers = 0;		// Per frame
+		uint32_t pipelineBarrierCalls = 0;	// Per frame
+		uint32_t transientImages = 0;
+		uint32_t memoryBlocks = 0;
+		VkDeviceSize transientBytesRequested = 0;	// Without aliasing
+		VkDeviceSize transientBytesAllocated = 0;	// With aliasing
+	};
+
+	class RenderGraph;
+
+	// Handed to a pass' setup callback to declare what it reads and writes
+	class RenderGraphBuilder
+	{
+	public:
+		RenderGraphBuilder(RenderGraph* _graph, uint32_t _passIndex) : graph(_graph), passIndex(_passIndex) {}
+
+		// Raster attachments -- A pass with attachments runs inside a render pass created by the graph
+		void WriteColor(RenderGraphHandle, VkAttachmentLoadOp, VkClearColorValue = {});
+		void WriteDepth(RenderGraphHandle, VkAttachmentLoadOp, VkClearDepthStencilValue = { 1.0f, 0 });
+		void ReadDepth(RenderGraphHandle);
+
+		// Images
+		void ReadTexture(RenderGraphHandle, VkPipelineStageFlags);
+		void ReadStorageImage(RenderGraphHandle, VkPipelineStageFlags);
+		void WriteStorageImage(RenderGraphHandle, VkPipelineStageFlags);
+		void ReadTransferImage(RenderGraphHandle);
+		void WriteTransferImage(RenderGraphHandle);
+
+		// Buffers
+		void ReadBuffer(RenderGraphHandle, VkPipelineStageFlags, VkAccessFlags);
+		void WriteBuffer(RenderGraphHandle, VkPipelineStageFlags, VkAccessFlags);
+
+		// Keeps the pass even if nothing reads its output
+		void SideEffect();
+
+	private:
+		RenderGraph* graph;
+		uint32_t passIndex;
+	};
+
+	// Passes declare their reads and writes; the graph orders nothing itself, but on Compile it
+	//  - Culls passes whose results never reach an output
+	//  - Derives the image & buffer barriers and layout transitions between passes
+	//  - Creates transient images and aliases their memory when their lifetimes don't overlap
+	// The compiled graph is executed every frame -- Rebuild it when the swapchain changes
+	class RenderGraph
+	{
+		friend class RenderGraphBuilder;
+
+	public:
+		typedef std::function<void(RenderGraphBuilder&)> SetupCallback;
+		typedef std::function<void(VkCommandBuffer)> ExecuteCallback;
+
+		struct Resource
+		{
+			std::string name;
+			bool isImage;
+			bool imported;
+
+			// Images
+			VkFormat format = VK_FORMAT_UNDEFINED;
+			VkExtent2D extent = {};
+			VkImageAspectFlags aspect = 0;
+			uint32_t mipLevels = 1;		// Barriers cover every level -- Passes order the levels among themselves
+			VkImageUsageFlags usage = 0;
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;	// Imported -- Layout at the start of the frame
+			VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;		// Imported -- Layout left at the end of the frame
+			VkPipelineStageFlags initialStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+			// Buffers
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkDeviceSize size = 0;
+
+			// Compile results
+			bool output = false;
+			int firstPass = -1;
+			int lastPass = -1;
+			int memoryBlock = -1;
+			RenderGraphHandle previousAlias = RenderGraphNullHandle;	// Last image to use the same memory
+		};
+
+		struct Pass
+		{
+			std::string name;
+			ExecuteCallback execute;
+			std::vector<RenderGraphAccess> accesses;
+			std::vector<RenderGraphAttachment> colorAttachments;
+			RenderGraphAttachment depthAttachment = { RenderGraphNullHandle, VK_ATTACHMENT_LOAD_OP_DONT_CARE, {} };
+			bool sideEffect = false;
+
+			// Compile results
+			bool culled = false;
+			VkPipelineStageFlags barrierSrcStages = 0;
+			VkPipelineStageFlags barrierDstStages = 0;
+			std::vector<VkImageMemoryBarrier> imageBarriers;
+			std::vector<VkBufferMemoryBarrier> bufferBarriers;
+			std::vector<RenderGraphHandle> imageBarrierResources;	// Patched into the barriers on Execute
+			std::vector<RenderGraphHandle> bufferBarrierResources;
+			VkRenderPass renderPass = VK_NULL_HANDLE;
+			VkExtent2D renderArea = {};
+		};
+
+		// Resources ====================================
+
+		// A transient image -- Created, and possibly aliased, by the graph. Its view covers every mip level
+		RenderGraphHandle CreateImage(const char* _name, VkFormat _format, VkExtent2D _extent, VkImageAspectFlags _aspect, uint32_t _mipLevels = 1);
+		// An image owned elsewhere (ex: the swapchain image) -- Its handles can change every frame
+		RenderGraphHandle ImportImage(
+			const char* _name,
+			VkFormat _format,
+			VkExtent2D _extent,
+			VkImageAspectFlags _aspect,
+			VkImageLayout _initialLayout,
+			VkImageLayout _finalLayout,
+			VkPipelineStageFlags _initialStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT
+			);
+		RenderGraphHandle ImportBuffer(const char* _name, VkBuffer _buffer, VkDeviceSize _size);
+		void SetImportedImage(RenderGraphHandle, VkImage, VkImageView);
+		void SetImportedBuffer(RenderGraphHandle, VkBuffer);
+		// Passes that contribute to an output are kept
+		void SetOutput(RenderGraphHandle);
+
+		VkImage GetImage(RenderGraphHandle _handle) { return resources[_handle].image; }
+		VkImageView GetImageView(RenderGraphHandle _handle) { return resources[_handle].view; }
+		VkBuffer GetBuffer(RenderGraphHandle _handle) { return resources[_handle].buffer; }
+
+		// Passes =======================================
+
+		// Passes execute in the order they are added
+		void AddPass(const char* _name, const SetupCallback& _setup, const ExecuteCallback& _execute);
+
+		// Building =====================================
+
+		void Compile(VulkanDevice* _device);
+		// Records every pass that survived culling, with its barriers -- Each pass is a profiler zone
+		void Execute(VkCommandBuffer _commandBuffer, GpuProfiler* _profiler = nullptr);
+		// Hands transient resources and framebuffers to _queue, to be destroyed once the timeline reaches _value
+		// Render passes are kept -- A rebuilt graph with the same attachment formats reuses them
+		void Retire(DeletionQueue& _queue, uint64_t _value);
+		// Destroys transient resources, render passes, and framebuffers -- The graph can be rebuilt afterwards
+		void Cleanup();
+
+		const RenderGraphStats& GetStats() { return stats; }
+		void PrintStats();
+
+	private:
+		void CullPasses();
+		void ComputeLifetimes();
+		void CreateTransientImages();
+		void BuildBarriers();
+		void CreateRenderPasses();
+		VkFramebuffer GetFramebuffer(Pass& _pass);
+		void Reset();
+
+		VulkanDevice* device = nullptr;
+		std::vector<Resource> resources;
+		std::vector<Pass> passes;
+
+		std::vector<VkDeviceMemory> memoryBlocks;
+		std::map<std::vector<VkImageView>, VkFramebuffer> framebuffers;
+		// Keyed by each attachment's format, load & store ops, and layouts -- Survives Retire
+		std::map<std::vector<uint32_t>, VkRenderPass> renderPassCache;
+
+		// Transitions imported images to their final layouts after the last pass
+		VkPipelineStageFlags finalSrcStages = 0;
+		VkPipelineStageFlags finalDstStages = 0;
+		std::vector<VkImageMemoryBarrier> finalBarriers;
+		std::vector<RenderGraphHandle> finalBarrierResources;
+
+		RenderGraphStats stats;
+	}; // RenderGraph
+
+} // namespace skel
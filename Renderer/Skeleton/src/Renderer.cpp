@@ -4,52 +4,102 @@
 #include <set>
 #include <string>
 #include <fstream>
+#include <algorithm>
+#include <functional>
 
 skel::Renderer::Renderer(SDL_Window* _window, Camera* _cam)
+{
+	window = _window;
+	cam = _cam;
+
+	CreateVulkanObjects();
+}
+
+// Renders into offscreen images -- No window, surface, or presentation
+skel::Renderer::Renderer(VkExtent2D _extent, Camera* _cam)
+{
+	headless = true;
+	headlessExtent = _extent;
+	window = nullptr;
+	cam = _cam;
+
+	// No presentation, so no swapchain
+	deviceExtensions.clear();
+
+	CreateVulkanObjects();
+}
+
+// Creates everything that doesn't depend on the swapchain
+void skel::Renderer::CreateVulkanObjects()
 {
 	pipelineLayouts.resize(2);
 	pipelines.resize(2);
 
-	window = _window;
-	cam = _cam;
+	creationTime = std::chrono::high_resolution_clock::now();
 
 	CreateInstance();
-	CreateSurface();
+	if (!headless)
+		CreateSurface();
 	CreateVulkanDevice();
+	framePacer.Create(device);
+	gpuProfiler.Create(device);
+	pipelineCache.Create(device, pipelineCachePath);
 	CreateCommandPools();
+	streamer.Create(device);
+	asyncCompute.Create(device);
+	occlusion.Create(device);
+	CreateGlobalDescriptors();
 }
 
 skel::Renderer::~Renderer()
 {
-	vkFreeCommandBuffers(
-		device->logicalDevice,
-		device->commandPools[graphicsCommandPoolIndex],
-		static_cast<uint32_t>(commandBuffers.size()),
-		commandBuffers.data()
-	);
-
 	CleanupRenderer();
 
 	for (const auto& descriptor : shaderDescriptors)
 	{
 		descriptor->Cleanup(device->logicalDevice);
-		free(descriptor);
+		delete descriptor;
 	}
 
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		vkDestroyBuffer(device->logicalDevice, cameraBuffers[i], nullptr);
+		vkFreeMemory(device->logicalDevice, cameraBufferMemories[i], nullptr);
+		vkDestroyBuffer(device->logicalDevice, lightBuffers[i], nullptr);
+		vkFreeMemory(device->logicalDevice, lightBufferMemories[i], nullptr);
+		vkDestroyBuffer(device->logicalDevice, objectBuffers[i], nullptr);
+		vkFreeMemory(device->logicalDevice, objectBufferMemories[i], nullptr);
+	}
+	streamer.Cleanup();
+	materials.Cleanup(device->logicalDevice);
+	transientDescriptors.Cleanup(device->logicalDevice);
+	occlusion.Cleanup();
+	vkDestroyDescriptorPool(device->logicalDevice, globalDescriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device->logicalDevice, globalDescriptorSetLayout, nullptr);
+
 	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
 		vkDestroySemaphore(device->logicalDevice, renderCompleteSemaphores[i], nullptr);
 		vkDestroySemaphore(device->logicalDevice, imageAvailableSemaphores[i], nullptr);
-		vkDestroyFence(device->logicalDevice, inFlightFences[i], nullptr);
 	}
 
+	framePacer.Cleanup(device->logicalDevice);
+	gpuProfiler.Cleanup();
+	asyncCompute.Cleanup();
+	SavePipelineCache();
+	pipelineCache.Cleanup(device->logicalDevice);
+
 	device->Cleanup();
-	free(device);
-	vkDestroySurfaceKHR(instance, surface, nullptr);
+	delete device;
+	if (!headless)
+		vkDestroySurfaceKHR(instance, surface, nullptr);
 	vkDestroyInstance(instance, nullptr);
 
-	SDL_DestroyWindow(window);
-	SDL_Quit();
+	if (!headless)
+	{
+		SDL_DestroyWindow(window);
+		SDL_Quit();
+	}
 }
 
 // Creates the render pipeline & components
@@ -61,7 +111,9 @@ void skel::Renderer::Initialize()
 
 void skel::Renderer::RecreateRenderer()
 {
-	vkDeviceWaitIdle(device->logicalDevice);
+	// Offscreen images don't follow a window
+	if (headless)
+		return;
 
 	for (const auto& listener : resizeListeners)
 		listener(window);
@@ -80,24 +132,60 @@ void skel::Renderer::RecreateRenderer()
 		while (SDL_WaitEvent(nullptr) == 0) {}
 	}
 
+	auto recreateStart = std::chrono::high_resolution_clock::now();
 
+	// Nothing waits for the GPU -- The old objects are destroyed once every frame submitted so far completes,
+	// and the old swapchain once its presents are done (see ReleaseRetiredSwapchains)
+	// Pipelines use dynamic viewport & scissor, so only the extent-dependent objects are rebuilt
+	uint64_t retireValue = device->timeline.lastSubmitted;
+	VkFormat previousFormat = swapchainFormat;
+	VkSwapchainKHR oldSwapchain = swapchain;
 
-	// Destroy all renderer objects
-	CleanupRenderer();
-	// Create Renderer
-	CreateRenderer();
+	RetireSwapchainResources(retireValue);
+	CreateSwapchain(oldSwapchain);
+	framePacer.SwapchainRecreated();
+	retiredSwapchains.push_back(oldSwapchain);
+
+	// The render pass (and every pipeline made against it) only depends on the image formats
+	// Rare enough (ex: moving to an HDR display) to simply wait for the GPU
+	if (swapchainFormat != previousFormat)
+	{
+		vkDeviceWaitIdle(device->logicalDevice);
+		CleanupPipelines();
+		CreatePipelines();
+	}
+
+	CreateSwapchainResources();
+
+	startupStats.swapchainRecreates++;
+	startupStats.lastRecreateTime = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - recreateStart).count();
 }
 
 void skel::Renderer::CreateRenderer()
 {
 	CreateSwapchain();
+	CreatePipelines();
+	CreateSwapchainResources();
+}
+
+void skel::Renderer::CleanupRenderer()
+{
+	CleanupSwapchainResources();
+	CleanupPipelines();
+}
+
+// Creates the render pass and a pipeline for every shader
+void skel::Renderer::CreatePipelines()
+{
 	CreateRenderPass();
 
 	std::string shaderDirectory = std::string(shaderPrefix);
 
 	for (uint32_t i = 0; i < static_cast<uint32_t>(shaderDescriptors.size()); i++)
 	{
-		CreatePipelineLayout(pipelineLayouts[i], &shaderDescriptors[i]->descriptorSetLayout);
+		// Set 0 is shared by every shader, set 1 holds the shader's per-object bindings
+		VkDescriptorSetLayout setLayouts[] = { globalDescriptorSetLayout, shaderDescriptors[i]->descriptorSetLayout };
+		CreatePipelineLayout(pipelineLayouts[i], setLayouts, 2);
 		CreateGraphicsPipeline(
 			(shaderDirectory + shaderDescriptors[i]->shaderName + "_vert.spv").c_str(),
 			(shaderDirectory + shaderDescriptors[i]->shaderName + "_frag.spv").c_str(),
@@ -106,49 +194,142 @@ void skel::Renderer::CreateRenderer()
 			);
 	}
 
-	CreateDepthResources();
-	CreateFrameBuffers();
-	CreateAndBeginCommandBuffers();
-	RecordRenderingCommandBuffers();
+	// Occlusion culling's compute pipelines
+	CreateComputePipeline((shaderDirectory + "hiz_reduce_comp.spv").c_str(), occlusion.reducePipelineLayout, occlusion.reducePipeline);
+	CreateComputePipeline((shaderDirectory + "occlusion_early_comp.spv").c_str(), occlusion.cullPipelineLayout, occlusion.earlyPipeline);
+	CreateComputePipeline((shaderDirectory + "occlusion_late_comp.spv").c_str(), occlusion.cullPipelineLayout, occlusion.latePipeline);
 }
 
-void skel::Renderer::CleanupRenderer()
+void skel::Renderer::CleanupPipelines()
 {
-	vkDestroyImageView(device->logicalDevice, depthImageView, nullptr);
-	vkDestroyImage(device->logicalDevice, depthImage, nullptr);
-	vkFreeMemory(device->logicalDevice, depthImageMemory, nullptr);
-
-	for (const auto& f : swapchainFrameBuffers)
-		vkDestroyFramebuffer(device->logicalDevice, f, nullptr);
-
 	for (uint32_t i = 0; i < static_cast<uint32_t>(pipelines.size()); i++)
 	{
 		vkDestroyPipeline(device->logicalDevice, pipelines[i], nullptr);
 		vkDestroyPipelineLayout(device->logicalDevice, pipelineLayouts[i], nullptr);
 	}
+	occlusion.DestroyPipelines();
 	vkDestroyRenderPass(device->logicalDevice, renderpass, nullptr);
+}
+
+// Creates the objects sized to the swapchain's extent -- Expects the swapchain to exist
+void skel::Renderer::CreateSwapchainResources()
+{
+	BuildFrameGraph();
+	CreateAndBeginCommandBuffers();
+}
+
+// Destroys the swapchain and everything sized to its extent
+void skel::Renderer::CleanupSwapchainResources()
+{
+	vkFreeCommandBuffers(
+		device->logicalDevice,
+		device->commandPools[graphicsCommandPoolIndex],
+		static_cast<uint32_t>(commandBuffers.size()),
+		commandBuffers.data()
+		);
+	commandBuffers.clear();
+
+	occlusion.DestroyPyramidViews();
+	frameGraph.Cleanup();
 
 	for (const auto& v : swapchainImageViews)
 		vkDestroyImageView(device->logicalDevice, v, nullptr);
 
+	if (headless)
+	{
+		for (uint32_t i = 0; i < static_cast<uint32_t>(swapchainImages.size()); i++)
+		{
+			vkDestroyImage(device->logicalDevice, swapchainImages[i], nullptr);
+			vkFreeMemory(device->logicalDevice, offscreenImageMemories[i], nullptr);
+		}
+		return;
+	}
+
+	for (const auto& retired : retiredSwapchains)
+		vkDestroySwapchainKHR(device->logicalDevice, retired, nullptr);
+	retiredSwapchains.clear();
 	vkDestroySwapchainKHR(device->logicalDevice, swapchain, nullptr);
 }
 
+// Called after each acquire -- An image that was presented on the current swapchain and comes back from an acquire
+// had its present processed, and presents are processed in order, so every retired swapchain's presents are done too
+// Once every image has been presented, any acquired image qualifies
+void skel::Renderer::ReleaseRetiredSwapchains()
+{
+	if (retiredSwapchains.empty() || swapchainImagesUnpresented > 0)
+		return;
+
+	for (const auto& retired : retiredSwapchains)
+		vkDestroySwapchainKHR(device->logicalDevice, retired, nullptr);
+	retiredSwapchains.clear();
+}
+
+// Hands the swapchain-sized objects to the deletion queue -- The swapchain itself is retired by the caller
+void skel::Renderer::RetireSwapchainResources(uint64_t _value)
+{
+	VkDevice logicalDevice = device->logicalDevice;
+	VkCommandPool commandPool = device->commandPools[graphicsCommandPoolIndex];
+	std::vector<VkCommandBuffer> retiredCommandBuffers = commandBuffers;
+	std::vector<VkImageView> retiredViews = swapchainImageViews;
+
+	device->deletionQueue.Push(_value, [=]() {
+		vkFreeCommandBuffers(logicalDevice, commandPool, static_cast<uint32_t>(retiredCommandBuffers.size()), retiredCommandBuffers.data());
+		for (const auto& v : retiredViews)
+			vkDestroyImageView(logicalDevice, v, nullptr);
+	});
+	commandBuffers.clear();
+
+	occlusion.RetirePyramidViews(device->deletionQueue, _value);
+	frameGraph.Retire(device->deletionQueue, _value);
+}
+
+// Waits for the next frame slot to be free and paces the CPU -- Call before sampling input
+void skel::Renderer::WaitForNextFrame()
+{
+	SKEL_PROFILE_FUNCTION();
+
+	device->timeline.Wait(device->logicalDevice, frameTimelineValues[currentFrame]);
+	framePacer.FrameCompleted(device->logicalDevice, currentFrame);
+	device->CollectGarbage();
+
+	if (framePacer.settings.lowLatency)
+	{
+		framePacer.WaitForPresent(device->logicalDevice, swapchain);
+		framePacer.SleepUntilInput();
+	}
+
+	framePacer.InputSampled(currentFrame);
+	frameWaited = true;
+}
+
 // Handles rendering and presentation to the window
 void skel::Renderer::RenderFrame()
 {
+	SKEL_PROFILE_FUNCTION();
+
 	uint32_t imageIndex;
 
-	// Wait for and retrieve the next frame for rendering
-	vkWaitForFences(device->logicalDevice, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
-	VkResult result = vkAcquireNextImageKHR(
-		device->logicalDevice,
-		swapchain,
-		UINT64_MAX,
-		imageAvailableSemaphores[currentFrame],
-		VK_NULL_HANDLE,
-		&imageIndex
-		);
+	// Applications that don't pace themselves wait here
+	if (!frameWaited)
+		WaitForNextFrame();
+	frameWaited = false;
+
+	// Retrieve the next frame for rendering -- Headless frames render into the frame slot's offscreen image
+	VkResult result = VK_SUCCESS;
+	{
+		SKEL_PROFILE_SCOPE("Acquire");
+		if (headless)
+			imageIndex = currentFrame;
+		else
+			result = vkAcquireNextImageKHR(
+				device->logicalDevice,
+				swapchain,
+				UINT64_MAX,
+				imageAvailableSemaphores[currentFrame],
+				VK_NULL_HANDLE,
+				&imageIndex
+				);
+	}
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR)
 	{
@@ -160,9 +341,36 @@ void skel::Renderer::RenderFrame()
 		throw std::runtime_error("Failed to acquire swapchain image");
 	}
 
-	if (imageIsInFlight[imageIndex] != VK_NULL_HANDLE)
-		vkWaitForFences(device->logicalDevice, 1, &imageIsInFlight[imageIndex], VK_TRUE, UINT64_MAX);
-	imageIsInFlight[imageIndex] = inFlightFences[currentFrame];
+	if (!headless)
+		ReleaseRetiredSwapchains();
+
+	// The image's command buffer may belong to another frame slot that is still rendering
+	device->timeline.Wait(device->logicalDevice, imageTimelineValues[imageIndex]);
+
+	// The frame's uniform buffers and the image's command buffer are no longer in use
+	uint64_t completedValue = device->timeline.CompletedValue(device->logicalDevice);
+	for (const auto& descriptor : shaderDescriptors)
+		descriptor->allocator.Recycle(completedValue, device->timeline.PendingValue());
+	transientDescriptors.Reset(device->logicalDevice, currentFrame);
+
+	// Streamed assets that arrived join before the scene updates -- Never waits on a file or copy
+	streamer.Update();
+	for (const auto& texture : pendingTextureWrites[currentFrame])
+		materials.WriteTextureDescriptor(device->logicalDevice, globalDescriptorSets[currentFrame], 4, texture);
+	pendingTextureWrites[currentFrame].clear();
+
+	UpdateFrameBuffers(currentFrame);
+	UpdateObjectBuffer(currentFrame);
+	CullObjects();
+
+	// Submitted first so it can start while the previous frame is still rendering
+	std::vector<skel::TimelineWait> computeWaits;
+	{
+		SKEL_PROFILE_SCOPE("AsyncCompute");
+		computeWaits = asyncCompute.Execute(currentFrame, device->timeline.lastSubmitted);
+	}
+
+	RecordRenderingCommandBuffer(imageIndex);
 
 	// Define render command submittal synchronization elements
 	VkSubmitInfo submitInfo = {};
@@ -178,13 +386,29 @@ void skel::Renderer::RenderFrame()
 	submitInfo.signalSemaphoreCount = 1;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
-	vkResetFences(device->logicalDevice, 1, &inFlightFences[currentFrame]);
+	// Nothing is acquired or presented
+	if (headless)
+	{
+		submitInfo.waitSemaphoreCount = 0;
+		submitInfo.signalSemaphoreCount = 0;
+	}
 
 	// Render this frame
-	CheckResultCritical(
-		vkQueueSubmit(device->graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]),
-		"Failed to submit draw command buffer"
-		);
+	uint64_t frameValue;
+	{
+		SKEL_PROFILE_SCOPE("Submit");
+		frameValue = device->timeline.Submit(device->graphicsQueue, submitInfo, computeWaits);
+	}
+	frameTimelineValues[currentFrame] = frameValue;
+	imageTimelineValues[imageIndex] = frameValue;
+	framePacer.FrameSubmitted(currentFrame);
+	lastRenderedImage = imageIndex;
+
+	if (headless)
+	{
+		AdvanceFrame();
+		return;
+	}
 
 	// Define presentation command submittal synchronization elements
 	VkPresentInfoKHR presentInfo = {};
@@ -195,8 +419,24 @@ void skel::Renderer::RenderFrame()
 	presentInfo.pSwapchains = &swapchain;
 	presentInfo.pImageIndices = &imageIndex;
 
+#if defined(VK_KHR_present_wait) && defined(VK_KHR_present_id)
+	VkPresentIdKHR presentIdInfo;
+	uint64_t presentId;
+	framePacer.AttachPresentId(presentInfo, presentIdInfo, presentId, frameNumber, currentFrame);
+#endif
+
 	// Present this frame
-	result = vkQueuePresentKHR(device->presentQueue, &presentInfo);
+	{
+		SKEL_PROFILE_SCOPE("Present");
+		result = vkQueuePresentKHR(device->presentQueue, &presentInfo);
+	}
+
+	// Suboptimal presents still happen
+	if ((result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) && !swapchainImagesPresented[imageIndex])
+	{
+		swapchainImagesPresented[imageIndex] = 1;
+		swapchainImagesUnpresented--;
+	}
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || windowResized)
 	{
@@ -208,7 +448,53 @@ void skel::Renderer::RenderFrame()
 		throw std::runtime_error("Failed to present swapchain");
 	}
 
-	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	AdvanceFrame();
+}
+
+// Moves to the next frame slot
+void skel::Renderer::AdvanceFrame()
+{
+	if (frameNumber == 0)
+	{
+		startupStats.timeToFirstFrame = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - creationTime).count();
+		startupStats.warmPipelineCache = pipelineCache.loadedFromDisk;
+	}
+
+	currentFrame = (currentFrame + 1) % framePacer.settings.framesInFlight;
+	frameNumber++;
+}
+
+// Applies a new frames-in-flight count, present mode, or latency mode
+void skel::Renderer::SetFramePacing(const skel::FramePacingSettings& _settings)
+{
+	skel::FramePacingSettings settings = skel::FramePacer::Validate(_settings);
+
+	// Only the slots that drop out of the rotation are waited on -- Their timestamps & latency are collected now,
+	// so nothing stale is read when they are used again. Slots joining it are waited on as usual when reached
+	if (settings.framesInFlight < framePacer.settings.framesInFlight)
+	{
+		for (uint32_t i = settings.framesInFlight; i < framePacer.settings.framesInFlight; i++)
+		{
+			device->timeline.Wait(device->logicalDevice, frameTimelineValues[i]);
+			framePacer.FrameCompleted(device->logicalDevice, i);
+		}
+
+		// The frame being prepared moves to the first slot, which must be as free as the one it leaves
+		if (currentFrame >= settings.framesInFlight)
+		{
+			device->timeline.Wait(device->logicalDevice, frameTimelineValues[0]);
+			framePacer.FrameCompleted(device->logicalDevice, 0);
+			framePacer.MoveFrame(currentFrame, 0);
+			currentFrame = 0;
+		}
+	}
+
+	// The swapchain is rebuilt after the next present
+	if (settings.presentMode != framePacer.settings.presentMode)
+		windowResized = true;
+
+	framePacer.settings = settings;
+	framePacer.latency = 0.0f;
 }
 
 // ==============================================
@@ -218,23 +504,27 @@ void skel::Renderer::RenderFrame()
 // Creates a Vulkan instance with app information
 void skel::Renderer::CreateInstance()
 {
-	uint32_t count = 0;
-	if (!SDL_Vulkan_GetInstanceExtensions(window, &count, nullptr))
+	// Surface extensions are only needed to present to a window
+	if (!headless)
 	{
-		std::printf("SDL error : %s\n", SDL_GetError());
-		throw std::runtime_error("Failed to get number of SDL instance extensions");
-	}
+		uint32_t count = 0;
+		if (!SDL_Vulkan_GetInstanceExtensions(window, &count, nullptr))
+		{
+			std::printf("SDL error : %s\n", SDL_GetError());
+			throw std::runtime_error("Failed to get number of SDL instance extensions");
+		}
 
-	std::vector<const char*> names(count);
-	if (!SDL_Vulkan_GetInstanceExtensions(window, &count, names.data()))
-	{
-		std::printf("SDL error : %s\n", SDL_GetError());
-		throw std::runtime_error("Failed to get SDL instance extensions");
-	}
+		std::vector<const char*> names(count);
+		if (!SDL_Vulkan_GetInstanceExtensions(window, &count, names.data()))
+		{
+			std::printf("SDL error : %s\n", SDL_GetError());
+			throw std::runtime_error("Failed to get SDL instance extensions");
+		}
 
-	for (const char* extension : names)
-	{
-		instanceExtensions.push_back(extension);
+		for (const char* extension : names)
+		{
+			instanceExtensions.push_back(extension);
+		}
 	}
 
 	VkApplicationInfo appInfo = {};
@@ -279,14 +569,26 @@ void skel::Renderer::CreateVulkanDevice()
 
 	// Select the best candidate
 	// Get an index for each of the required queue families
-	uint32_t graphicsIndex, transferIndex, presentIndex;
-	uint32_t selectedDevice = ChooseSuitableDevice(devices, graphicsIndex, transferIndex, presentIndex);
+	uint32_t graphicsIndex, transferIndex, presentIndex, computeIndex;
+	uint32_t selectedDevice = ChooseSuitableDevice(devices, graphicsIndex, transferIndex, presentIndex, computeIndex);
 
 	// Create a VulkanDevice & logical device
 	device = new VulkanDevice(instance, devices[selectedDevice]);
 	device->queueFamilyIndices.graphics = graphicsIndex;
 	device->queueFamilyIndices.transfer = transferIndex;
 	device->queueFamilyIndices.present = presentIndex;
+	device->queueFamilyIndices.compute = computeIndex;
+
+#if defined(VK_KHR_present_wait) && defined(VK_KHR_present_id)
+	// Optional -- Lets the frame pacer wait for and time actual presentation
+	if (!headless && device->SupportsPresentWait())
+	{
+		deviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+		deviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+		device->presentWaitEnabled = true;
+	}
+#endif
+
 	device->enabledExtensions = deviceExtensions;
 	device->CreateLogicalDevice();
 }
@@ -296,7 +598,8 @@ uint32_t skel::Renderer::ChooseSuitableDevice(
 	std::vector<VkPhysicalDevice> _devices,
 	uint32_t& _graphicsIndex,
 	uint32_t& _transferIndex,
-	uint32_t& _presentIndex
+	uint32_t& _presentIndex,
+	uint32_t& _computeIndex
 	)
 {
 	uint32_t supportedExtensionsCount;
@@ -308,6 +611,7 @@ uint32_t skel::Renderer::ChooseSuitableDevice(
 	int graphics = -1;
 	int transfer = -1;
 	int present = -1;
+	int compute = -1;
 
 	uint32_t i = 0;
 
@@ -333,20 +637,26 @@ uint32_t skel::Renderer::ChooseSuitableDevice(
 
 		graphics = GetQueueFamilyIndex(qProps, VK_QUEUE_GRAPHICS_BIT);
 		transfer = GetQueueFamilyIndex(qProps, VK_QUEUE_TRANSFER_BIT);
-		present = GetPresentFamilyIndex(qProps, d);
+		// Headless rendering never presents -- The present queue is just the graphics queue
+		present = headless ? graphics : GetPresentFamilyIndex(qProps, d);
+		// Any graphics family supports compute, so this always finds one
+		compute = GetQueueFamilyIndex(qProps, VK_QUEUE_COMPUTE_BIT);
 
 		// If all required elements are present, use this device
 		if (requiredExtensions.empty()
 			&& graphics >= 0
 			&& transfer >= 0
 			&& present >= 0
-			&& GetSurfaceProperties(d).isSuitable()
+			&& (headless || GetSurfaceProperties(d).isSuitable())
 			&& supportedFeatures.samplerAnisotropy
+			&& VulkanDevice::SupportsBindless(d)
+			&& VulkanDevice::SupportsTimelineSemaphore(d)
 			)
 		{
 			_graphicsIndex = graphics;
 			_transferIndex = transfer;
 			_presentIndex = present;
+			_computeIndex = compute;
 			return i;
 		}
 
@@ -365,7 +675,8 @@ uint32_t skel::Renderer::GetQueueFamilyIndex(std::vector<VkQueueFamilyProperties
 	{
 		if (_flag & _families[i].queueFlags)
 		{
-			if (_flag == VK_QUEUE_TRANSFER_BIT) // Append additional queue families here (ex: compute)
+			// Prefer families dedicated to the work -- They run alongside the graphics queue
+			if (_flag == VK_QUEUE_TRANSFER_BIT || _flag == VK_QUEUE_COMPUTE_BIT)
 			{
 				if ((_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0)
 					return i;
@@ -425,21 +736,16 @@ void skel::Renderer::CreateSyncObjects()
 {
 	imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 	renderCompleteSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-	inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-	imageIsInFlight.resize(static_cast<uint32_t>(swapchainImages.size()), VK_NULL_HANDLE);
+	frameTimelineValues.resize(MAX_FRAMES_IN_FLIGHT, 0);
 
+	// Binary semaphores are still needed for acquire & present -- Frame completion is tracked on the timeline
 	VkSemaphoreCreateInfo semaphoreInfo = {};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	VkFenceCreateInfo fenceInfo = {};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
 	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
 		if (vkCreateSemaphore(device->logicalDevice, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-			vkCreateSemaphore(device->logicalDevice, &semaphoreInfo, nullptr, &renderCompleteSemaphores[i]) != VK_SUCCESS ||
-			vkCreateFence(device->logicalDevice, &fenceInfo, nullptr, &inFlightFences[i]))
+			vkCreateSemaphore(device->logicalDevice, &semaphoreInfo, nullptr, &renderCompleteSemaphores[i]) != VK_SUCCESS)
 			throw std::runtime_error("Failed to create semaphore");
 	}
 }
@@ -451,14 +757,401 @@ void skel::Renderer::CreateCommandPools()
 	device->graphicsCommandPoolIndex = graphicsCommandPoolIndex;
 }
 
+// Creates the frame-wide descriptor set (set 0) for every frame in flight
+// Holds the camera and lights buffers, the material buffer, the object buffer, and the bindless texture array
+void skel::Renderer::CreateGlobalDescriptors()
+{
+	materials.Create(device, device->properties12);
+
+	std::array<VkDescriptorSetLayoutBinding, 5> bindings = {
+		// Camera
+		skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0),
+		// Lights
+		skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1),
+		// Materials
+		skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 2),
+		// Objects
+		skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 3),
+		// Textures -- Must be the last binding to have a variable count
+		skel::initializers::DescriptorSetLyoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 4, materials.maxTextures)
+	};
+
+	// Only the texture array is written while the set may be in use
+	// The object buffer is only repointed when its frame slot is idle
+	std::array<VkDescriptorBindingFlags, 5> bindingFlags = {
+		0,
+		0,
+		0,
+		0,
+		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT
+	};
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+	bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.pNext = &bindingFlagsInfo;
+	layoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutCreateInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(device->logicalDevice, &layoutCreateInfo, nullptr, &globalDescriptorSetLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create the global descriptor set layout");
+
+	std::array<VkDescriptorPoolSize, 3> poolSizes = {
+		skel::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 * MAX_FRAMES_IN_FLIGHT),
+		skel::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * MAX_FRAMES_IN_FLIGHT),
+		skel::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, materials.maxTextures * MAX_FRAMES_IN_FLIGHT)
+	};
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolCreateInfo.pPoolSizes = poolSizes.data();
+	poolCreateInfo.maxSets = MAX_FRAMES_IN_FLIGHT;
+
+	if (vkCreateDescriptorPool(device->logicalDevice, &poolCreateInfo, nullptr, &globalDescriptorPool) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create the global descriptor pool");
+
+	std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, globalDescriptorSetLayout);
+	std::vector<uint32_t> textureCounts(MAX_FRAMES_IN_FLIGHT, materials.maxTextures);
+
+	VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo = {};
+	variableCountInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+	variableCountInfo.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
+	variableCountInfo.pDescriptorCounts = textureCounts.data();
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.pNext = &variableCountInfo;
+	allocInfo.descriptorPool = globalDescriptorPool;
+	allocInfo.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
+	allocInfo.pSetLayouts = layouts.data();
+
+	globalDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+	if (vkAllocateDescriptorSets(device->logicalDevice, &allocInfo, globalDescriptorSets.data()) != VK_SUCCESS)
+		throw std::runtime_error("Failed to allocate the global descriptor sets");
+
+	cameraBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	cameraBufferMemories.resize(MAX_FRAMES_IN_FLIGHT);
+	lightBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	lightBufferMemories.resize(MAX_FRAMES_IN_FLIGHT);
+	objectBuffers.resize(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+	objectBufferMemories.resize(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+	objectBufferData.resize(MAX_FRAMES_IN_FLIGHT, nullptr);
+	objectBufferCapacities.resize(MAX_FRAMES_IN_FLIGHT, 0);
+	objectBufferViewProjections.resize(MAX_FRAMES_IN_FLIGHT);
+	objectBufferCurrent.resize(MAX_FRAMES_IN_FLIGHT, false);
+	pendingObjectWrites.resize(MAX_FRAMES_IN_FLIGHT);
+	pendingTextureWrites.resize(MAX_FRAMES_IN_FLIGHT);
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		device->CreateBuffer(
+			sizeof(skel::CameraInfo),
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			cameraBuffers[i],
+			cameraBufferMemories[i]
+		);
+		device->CreateBuffer(
+			sizeof(skel::lights::ShaderLights),
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			lightBuffers[i],
+			lightBufferMemories[i]
+		);
+
+		std::array<VkDescriptorBufferInfo, 3> bufferInfos = {};
+		bufferInfos[0] = { cameraBuffers[i], 0, VK_WHOLE_SIZE };
+		bufferInfos[1] = { lightBuffers[i], 0, VK_WHOLE_SIZE };
+		bufferInfos[2] = { materials.materialBuffer, 0, VK_WHOLE_SIZE };
+
+		std::array<VkWriteDescriptorSet, 3> writes = {
+			skel::initializers::WriteDescriptorSet(globalDescriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &bufferInfos[0], 0),
+			skel::initializers::WriteDescriptorSet(globalDescriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &bufferInfos[1], 1),
+			skel::initializers::WriteDescriptorSet(globalDescriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &bufferInfos[2], 2)
+		};
+		vkUpdateDescriptorSets(device->logicalDevice, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+		CreateObjectBuffer(i, 1024);
+	}
+
+	// Sets that only live for one frame
+	transientDescriptors.Create(
+		{
+			skel::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 256),
+			skel::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 256),
+			skel::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 512),
+			skel::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 128)
+		},
+		MAX_FRAMES_IN_FLIGHT
+		);
+}
+
+// Copies the camera's matrices and the scene's lights into the frame's buffers
+void skel::Renderer::UpdateFrameBuffers(uint32_t _frameIndex)
+{
+	skel::CameraInfo cameraInfo = cam->GetShaderInfo();
+	device->CopyDataToBufferMemory(&cameraInfo, sizeof(cameraInfo), cameraBufferMemories[_frameIndex]);
+	device->CopyDataToBufferMemory(&lights, sizeof(lights), lightBufferMemories[_frameIndex]);
+}
+
+// (Re)creates a frame's object buffer with room for _capacity entries and points its global set at it
+// Only called while the frame slot is idle, so the old buffer can go immediately
+void skel::Renderer::CreateObjectBuffer(uint32_t _frameIndex, uint32_t _capacity)
+{
+	if (objectBuffers[_frameIndex] != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer(device->logicalDevice, objectBuffers[_frameIndex], nullptr);
+		vkFreeMemory(device->logicalDevice, objectBufferMemories[_frameIndex], nullptr);
+	}
+
+	device->CreateBuffer(
+		sizeof(skel::ObjectData) * _capacity,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		objectBuffers[_frameIndex],
+		objectBufferMemories[_frameIndex]
+	);
+
+	void* data;
+	vkMapMemory(device->logicalDevice, objectBufferMemories[_frameIndex], 0, VK_WHOLE_SIZE, 0, &data);
+	objectBufferData[_frameIndex] = static_cast<skel::ObjectData*>(data);
+	objectBufferCapacities[_frameIndex] = _capacity;
+	objectBufferCurrent[_frameIndex] = false;
+
+	VkDescriptorBufferInfo bufferInfo = { objectBuffers[_frameIndex], 0, VK_WHOLE_SIZE };
+	VkWriteDescriptorSet write = skel::initializers::WriteDescriptorSet(globalDescriptorSets[_frameIndex], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &bufferInfo, 3);
+	vkUpdateDescriptorSets(device->logicalDevice, 1, &write, 0, nullptr);
+}
+
+// Brings the frame's object buffer up to date with the scene's changed entities and the camera
+// Entries are indexed by entity, which stays put while chunks reorder -- Each draw finds its entry with firstInstance
+void skel::Renderer::UpdateObjectBuffer(uint32_t _frameIndex)
+{
+	SKEL_PROFILE_FUNCTION();
+
+	drawChunks.clear();
+	if (scene == nullptr)
+		return;
+
+	// Picks up everything moved or created since the last frame
+	scene->Update();
+	drawChunks = scene->world.GetChunks<skel::LocalToWorld, skel::MeshRef, skel::Material, skel::WorldBounds, skel::Visibility>();
+
+	// Every frame slot's buffer needs each change -- A slot that falls far behind is rewritten whole instead
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		std::vector<skel::ecs::Entity>& pending = pendingObjectWrites[i];
+		if (pending.size() + scene->changedEntities.size() > scene->world.EntityCount())
+		{
+			pending.clear();
+			objectBufferCurrent[i] = false;
+		}
+		else
+		{
+			pending.insert(pending.end(), scene->changedEntities.begin(), scene->changedEntities.end());
+		}
+	}
+	scene->changedEntities.clear();
+
+	uint32_t capacity = scene->world.IndexCapacity();
+	if (capacity > objectBufferCapacities[_frameIndex])
+		CreateObjectBuffer(_frameIndex, std::max(capacity, objectBufferCapacities[_frameIndex] * 2));
+
+	skel::ObjectData* objects = objectBufferData[_frameIndex];
+	std::vector<skel::ecs::Entity>& pending = pendingObjectWrites[_frameIndex];
+	glm::mat4 viewProjection = cam->projection * cam->view;
+
+	// Every model-view-projection matrix depends on the camera
+	if (!objectBufferCurrent[_frameIndex] || viewProjection != objectBufferViewProjections[_frameIndex])
+	{
+		// Chunks write disjoint entries of the mapped buffer -- No staging copy
+		skel::ecs::ParallelFor(static_cast<uint32_t>(drawChunks.size()), [&](uint32_t _chunk) {
+			const DrawChunk& chunk = drawChunks[_chunk];
+			const skel::LocalToWorld* matrices = chunk.Get<skel::LocalToWorld>();
+			const skel::Material* materials = chunk.Get<skel::Material>();
+
+			// Batched through the stack, then scattered to the entities' entries
+			const uint32_t batchSize = 64;
+			glm::mat4 modelViewProjections[batchSize];
+			for (uint32_t first = 0; first < chunk.count; first += batchSize)
+			{
+				uint32_t count = std::min(batchSize, chunk.count - first);
+				skel::simd::MultiplyMatrices(viewProjection, &matrices[first].model, count, modelViewProjections);
+				for (uint32_t i = 0; i < count; i++)
+				{
+					skel::ObjectData& object = objects[chunk.entities[first + i].index];
+					object.model = matrices[first + i].model;
+					object.modelViewProjection = modelViewProjections[i];
+					object.materialIndex = materials[first + i].materialIndex;
+				}
+			}
+		});
+
+		objectBufferViewProjections[_frameIndex] = viewProjection;
+		objectBufferCurrent[_frameIndex] = true;
+	}
+	else
+	{
+		for (const auto& entity : pending)
+		{
+			// Destroyed since it changed
+			const skel::LocalToWorld* localToWorld = scene->world.Get<skel::LocalToWorld>(entity);
+			const skel::Material* material = scene->world.Get<skel::Material>(entity);
+			if (localToWorld == nullptr || material == nullptr)
+				continue;
+
+			skel::ObjectData& object = objects[entity.index];
+			object.model = localToWorld->model;
+			skel::simd::MultiplyMatrices(viewProjection, &localToWorld->model, 1, &object.modelViewProjection);
+			object.materialIndex = material->materialIndex;
+		}
+	}
+	pending.clear();
+}
+
+// Culls the scene's spatial indices against the camera's frustum and fills the draw lists
+// Static entities come from the BVH and moving ones from the loose octree, a whole cell or subtree at a time
+// What survives is occlusion culled on the GPU while the frame renders
+void skel::Renderer::CullObjects()
+{
+	SKEL_PROFILE_FUNCTION();
+
+	drawLists.resize(shaderDescriptors.size());
+	for (auto& list : drawLists)
+		list.clear();
+	cullingStats = {};
+	if (scene == nullptr)
+	{
+		occlusion.BeginFrame(currentFrame, 0);
+		return;
+	}
+
+	glm::mat4 viewProjection = cam->projection * cam->view;
+	skel::Frustum frustum = skel::Frustum::FromViewProjection(viewProjection);
+
+	visibleEntities.clear();
+	scene->CullFrustum(frustum, visibleEntities);
+
+	// Occluders in view are rasterized on worker threads, then everything in view is tested against them
+	// Runs while the GPU is still busy with the previous frame
+	occludedEntities.assign(visibleEntities.size(), 0);
+	if (softwareOcclusion.settings.enabled)
+	{
+		SKEL_PROFILE_SCOPE("SoftwareOcclusion");
+
+		softwareOcclusion.Begin(viewProjection);
+		scene->world.ForEachChunk<skel::Occluder, skel::LocalToWorld, skel::MeshRef, skel::WorldBounds>(
+			[&](skel::ecs::ChunkView<skel::Occluder, skel::LocalToWorld, skel::MeshRef, skel::WorldBounds>& _chunk) {
+				const skel::LocalToWorld* matrices = _chunk.Get<skel::LocalToWorld>();
+				const skel::MeshRef* meshes = _chunk.Get<skel::MeshRef>();
+				const skel::WorldBounds* bounds = _chunk.Get<skel::WorldBounds>();
+				for (uint32_t i = 0; i < _chunk.count; i++)
+					if (meshes[i].mesh != nullptr && skel::IsVisible(frustum, bounds[i]))
+						softwareOcclusion.AddOccluder(*meshes[i].mesh, matrices[i].model);
+			});
+		cullingStats.occluders = softwareOcclusion.occluderCount;
+
+		if (softwareOcclusion.HasOccluders())
+		{
+			softwareOcclusion.Rasterize();
+
+			const uint32_t batchSize = 256;
+			uint32_t count = static_cast<uint32_t>(visibleEntities.size());
+			skel::ecs::ParallelFor((count + batchSize - 1) / batchSize, [&](uint32_t _batch) {
+				uint32_t end = std::min(count, (_batch + 1) * batchSize);
+				for (uint32_t i = _batch * batchSize; i < end; i++)
+				{
+					// Occluders are never hidden by each other -- Their boxes can sit right at their own depth
+					const skel::WorldBounds* bounds = scene->world.Get<skel::WorldBounds>(visibleEntities[i]);
+					occludedEntities[i] = bounds != nullptr && !scene->world.Has<skel::Occluder>(visibleEntities[i]) &&
+						softwareOcclusion.IsOccluded(*bounds) ? 1 : 0;
+				}
+			}, 1);
+		}
+	}
+
+	// Hidden unless an index found it -- Chunks clear their own visibilities
+	skel::ecs::ParallelFor(static_cast<uint32_t>(drawChunks.size()), [&](uint32_t _chunk) {
+		const DrawChunk& chunk = drawChunks[_chunk];
+		skel::Visibility* visibilities = chunk.Get<skel::Visibility>();
+		std::fill(visibilities, visibilities + chunk.count, skel::Visibility{ 0 });
+	});
+	for (const auto& chunk : drawChunks)
+		cullingStats.total += chunk.count;
+
+	for (uint32_t i = 0; i < static_cast<uint32_t>(visibleEntities.size()); i++)
+	{
+		// The BVH may hold entities destroyed since its last rebuild, and neither index knows what is drawn
+		skel::ecs::Entity entity = visibleEntities[i];
+		skel::Visibility* visibility = scene->world.Get<skel::Visibility>(entity);
+		const skel::MeshRef* mesh = scene->world.Get<skel::MeshRef>(entity);
+		const skel::Material* material = scene->world.Get<skel::Material>(entity);
+		const skel::WorldBounds* bounds = scene->world.Get<skel::WorldBounds>(entity);
+		if (visibility == nullptr || mesh == nullptr || material == nullptr || bounds == nullptr || !scene->world.Has<skel::LocalToWorld>(entity))
+			continue;
+
+		if (occludedEntities[i])
+		{
+			cullingStats.occluded++;
+			continue;
+		}
+
+		visibility->visible = 1;
+		if (mesh->mesh == nullptr || material->shaderType >= drawLists.size())
+			continue;
+
+		drawLists[material->shaderType].push_back({ mesh->mesh, material->descriptorSet, entity.index, *bounds });
+		cullingStats.visible++;
+	}
+
+	// The indices return entities in spatial order -- Grouped by mesh again so each mesh binds its buffers once
+	for (auto& list : drawLists)
+	{
+		std::sort(list.begin(), list.end(), [](const DrawItem& _a, const DrawItem& _b) {
+			return _a.mesh != _b.mesh ? std::less<const Mesh*>()(_a.mesh, _b.mesh) : _a.objectIndex < _b.objectIndex;
+		});
+	}
+
+	// Every draw gets a command in each occlusion phase, in draw list order -- The GPU decides their instance counts
+	skel::OcclusionCulling::FrameSlot& slot = occlusion.BeginFrame(currentFrame, cullingStats.visible);
+	occlusion.ReserveVisibility(scene->world.IndexCapacity(), device->timeline.lastSubmitted);
+
+	uint32_t index = 0;
+	for (const auto& list : drawLists)
+	{
+		for (const auto& item : list)
+		{
+			slot.candidates[index] = { glm::vec3(item.bounds.sphere), item.objectIndex, glm::vec3(item.bounds.extents), 0 };
+
+			// firstInstance selects the entity's object buffer entry (gl_InstanceIndex)
+			VkDrawIndexedIndirectCommand command = { static_cast<uint32_t>(item.mesh->indices.size()), 0, 0, 0, item.objectIndex };
+			slot.commands[index] = command;
+			slot.commands[cullingStats.visible + index] = command;
+			index++;
+		}
+	}
+}
+
 // Creates a swapchain and its images as rendering canvases
-void skel::Renderer::CreateSwapchain()
+void skel::Renderer::CreateSwapchain(VkSwapchainKHR _oldSwapchain /*= VK_NULL_HANDLE*/)
 {
+	if (headless)
+	{
+		CreateOffscreenImages();
+		return;
+	}
+
 	SurfaceProperties properties = GetSurfaceProperties(device->physicalDevice);
 	VkSurfaceFormatKHR format;
 	VkPresentModeKHR presentMode;
 	VkExtent2D extent;
 	GetIdealSurfaceProperties(properties, format, presentMode, extent);
+	framePacer.activePresentMode = presentMode;
 
 	uint32_t imageCount = properties.capabilities.minImageCount + 1;
 	if (properties.capabilities.maxImageCount > 0 && imageCount > properties.capabilities.maxImageCount)
@@ -489,6 +1182,7 @@ void skel::Renderer::CreateSwapchain()
 		createInfo.queueFamilyIndexCount = 2;
 		createInfo.pQueueFamilyIndices = sharingIndices;
 	}
+	createInfo.oldSwapchain = _oldSwapchain;
 
 	CheckResultCritical(
 		vkCreateSwapchainKHR(device->logicalDevice, &createInfo, nullptr, &swapchain),
@@ -501,6 +1195,10 @@ void skel::Renderer::CreateSwapchain()
 	swapchainImages.resize(imageCount);
 	swapchainImageViews.resize(imageCount);
 	vkGetSwapchainImagesKHR(device->logicalDevice, swapchain, &imageCount, swapchainImages.data());
+	// Frames rendered to the old images are covered by the frame slots' timeline values
+	imageTimelineValues.assign(imageCount, 0);
+	swapchainImagesPresented.assign(imageCount, 0);
+	swapchainImagesUnpresented = imageCount;
 
 	swapchainExtent = extent;
 	swapchainFormat = format.format;
@@ -511,6 +1209,88 @@ void skel::Renderer::CreateSwapchain()
 	}
 }
 
+// Creates a ring of color images that stand in for the swapchain when rendering headless
+void skel::Renderer::CreateOffscreenImages()
+{
+	swapchainExtent = headlessExtent;
+	swapchainFormat = VK_FORMAT_B8G8R8A8_SRGB;
+
+	uint32_t imageCount = MAX_FRAMES_IN_FLIGHT;
+	swapchainImages.resize(imageCount);
+	swapchainImageViews.resize(imageCount);
+	offscreenImageMemories.resize(imageCount);
+	imageTimelineValues.resize(imageCount, 0);
+
+	for (uint32_t i = 0; i < imageCount; i++)
+	{
+		skel::CreateImage(
+			device,
+			swapchainExtent.width,
+			swapchainExtent.height,
+			swapchainFormat,
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			swapchainImages[i],
+			offscreenImageMemories[i]
+		);
+		swapchainImageViews[i] = CreateImageView(device, swapchainImages[i], swapchainFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+	}
+}
+
+// Copies the most recently rendered headless frame to _pixels -- Tightly packed BGRA8 rows
+// Blocks until the frame and the copy have completed
+void skel::Renderer::ReadbackFrame(std::vector<uint8_t>& _pixels)
+{
+	if (!headless)
+		throw std::runtime_error("Frame readback is only supported when rendering headless");
+
+	VkDeviceSize size = (VkDeviceSize)swapchainExtent.width * swapchainExtent.height * 4;
+	VkBuffer readbackBuffer;
+	VkDeviceMemory readbackMemory;
+	device->CreateBuffer(
+		size,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		readbackBuffer,
+		readbackMemory
+	);
+
+	VkCommandBuffer commandBuffer = device->BeginSingleTimeCommands(graphicsCommandPoolIndex);
+
+	// Make the render pass' color writes visible to the copy
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = swapchainImages[lastRenderedImage];
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.layerCount = 1;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy region = {};
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = { swapchainExtent.width, swapchainExtent.height, 1 };
+	vkCmdCopyImageToBuffer(commandBuffer, swapchainImages[lastRenderedImage], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+
+	device->EndSingleTimeCommands(commandBuffer, graphicsCommandPoolIndex, device->graphicsQueue);
+
+	_pixels.resize(static_cast<size_t>(size));
+	void* data;
+	vkMapMemory(device->logicalDevice, readbackMemory, 0, size, 0, &data);
+	memcpy(_pixels.data(), data, static_cast<size_t>(size));
+	vkUnmapMemory(device->logicalDevice, readbackMemory);
+
+	vkDestroyBuffer(device->logicalDevice, readbackBuffer, nullptr);
+	vkFreeMemory(device->logicalDevice, readbackMemory, nullptr);
+}
+
 // Finds a surface with ideal format, present mode, and extent properties
 void skel::Renderer::GetIdealSurfaceProperties(
 	SurfaceProperties _properties,
@@ -535,7 +1315,7 @@ void skel::Renderer::GetIdealSurfaceProperties(
 	_presentMode = VK_PRESENT_MODE_FIFO_KHR;
 	for (const auto& m : _properties.presentModes)
 	{
-		if (m == VK_PRESENT_MODE_MAILBOX_KHR)
+		if (m == framePacer.settings.presentMode)
 		{
 			_presentMode = m;
 			break;
@@ -582,6 +1362,7 @@ VkImageView skel::Renderer::CreateImageView(VulkanDevice* _device, VkImage _imag
 }
 
 // Specify what types of attachments will be accessed by the graphics pipeline
+// The frame graph creates the render passes that are actually begun -- This one only needs to be compatible with them
 void skel::Renderer::CreateRenderPass()
 {
 	// Describes the swapchain images' color
@@ -593,7 +1374,8 @@ void skel::Renderer::CreateRenderPass()
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	// Offscreen images are left ready for readback
+	colorAttachment.finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 	VkAttachmentReference colorAttachmentReference = {};
 	colorAttachmentReference.attachment = 0;
@@ -626,6 +1408,9 @@ void skel::Renderer::CreateRenderPass()
 	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
 	dependency.dstSubpass = 0;
 	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	// The previous readback of an offscreen image must finish before it is drawn over
+	if (headless)
+		dependency.srcStageMask |= VK_PIPELINE_STAGE_TRANSFER_BIT;
 	dependency.srcAccessMask = 0;
 	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
@@ -665,6 +1450,7 @@ VkFormat skel::Renderer::FindSupportedFormat(const std::vector<VkFormat>& _candi
 // Binds shader uniforms
 void skel::Renderer::CreatePipelineLayout(VkPipelineLayout& _pipelineLayout, VkDescriptorSetLayout* _shaderLayouts, uint32_t _count /*= 1*/)
 {
+	// Per-draw data lives in the global object buffer -- No push constants
 	VkPipelineLayoutCreateInfo createInfo =
 		skel::initializers::PipelineLayoutCreateInfo(
 			_shaderLayouts,
@@ -686,24 +1472,13 @@ void skel::Renderer::CreateGraphicsPipeline(
 	)
 {
 // ===== Viewport =====
-	VkViewport viewport = {};
-	viewport.width = (float)swapchainExtent.width;
-	viewport.height = (float)swapchainExtent.height;
-	viewport.x = 0;
-	viewport.y = 0;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	VkRect2D scissor = {};
-	scissor.extent = swapchainExtent;
-	scissor.offset = { 0, 0 };
-
+	// Viewport & scissor are dynamic -- Set while recording so resizing keeps the pipeline
 	VkPipelineViewportStateCreateInfo viewportState =
 		skel::initializers::PipelineViewportStateCreateInfo(
 			1,
-			&viewport,
+			nullptr,
 			1,
-			&scissor
+			nullptr
 		);
 
 // ===== Vertex Input =====
@@ -760,10 +1535,15 @@ void skel::Renderer::CreateGraphicsPipeline(
 
 // ===== Dynamic =====
 // States of the pipeline that change frequently (ex: the viewport resizing)
+	std::array<VkDynamicState, 2> dynamicStates = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+
 	VkPipelineDynamicStateCreateInfo dynamicState =
 		skel::initializers::PipelineDynamicStateCreateInfo(
-			0,
-			nullptr
+			static_cast<uint32_t>(dynamicStates.size()),
+			dynamicStates.data()
 		);
 
 // ===== Pipeline Creation =====
@@ -809,7 +1589,7 @@ void skel::Renderer::CreateGraphicsPipeline(
 	pipelineCreateInfo.layout = _pipelineLayout;
 
 	CheckResultCritical(
-		vkCreateGraphicsPipelines(device->logicalDevice, nullptr, 1, &pipelineCreateInfo, nullptr, &_pipeline),
+		vkCreateGraphicsPipelines(device->logicalDevice, pipelineCache.cache, 1, &pipelineCreateInfo, nullptr, &_pipeline),
 		"Failed to create unlit pipeline"
 		);
 
@@ -817,6 +1597,34 @@ void skel::Renderer::CreateGraphicsPipeline(
 	vkDestroyShaderModule(device->logicalDevice, fragShaderModule, nullptr);
 }
 
+// Creates a compute pipeline from a single shader -- Shares the graphics pipelines' cache
+void skel::Renderer::CreateComputePipeline(
+	const char* _shaderDir,
+	const VkPipelineLayout& _pipelineLayout,
+	VkPipeline& _pipeline
+	)
+{
+	std::vector<char> shaderFile = LoadFile(_shaderDir);
+	VkShaderModule shaderModule = CreateShaderModule(shaderFile);
+
+	VkComputePipelineCreateInfo pipelineCreateInfo =
+		skel::initializers::ComputePipelineCreateInfo(
+			_pipelineLayout
+		);
+	pipelineCreateInfo.stage =
+		skel::initializers::PipelineShaderStageCreateInfo(
+			VK_SHADER_STAGE_COMPUTE_BIT,
+			shaderModule
+		);
+
+	CheckResultCritical(
+		vkCreateComputePipelines(device->logicalDevice, pipelineCache.cache, 1, &pipelineCreateInfo, nullptr, &_pipeline),
+		"Failed to create compute pipeline"
+		);
+
+	vkDestroyShaderModule(device->logicalDevice, shaderModule, nullptr);
+}
+
 // Create a pipeline usable object for shader code
 VkShaderModule skel::Renderer::CreateShaderModule(const std::vector<char> _code)
 {
@@ -834,48 +1642,89 @@ VkShaderModule skel::Renderer::CreateShaderModule(const std::vector<char> _code)
 	return tmpShaderModule;
 }
 
-// Creates an image and view for the depth texture
-void skel::Renderer::CreateDepthResources()
+// Declares the frame's passes and compiles them against the current swapchain
+void skel::Renderer::BuildFrameGraph()
 {
-	VkFormat depthFormat = FindDepthFormat();
-
-	skel::CreateImage(
-		device,
-		swapchainExtent.width,
-		swapchainExtent.height,
-		depthFormat,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		depthImage,
-		depthImageMemory
-	);
-	depthImageView = skel::CreateImageView(device, depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
-}
-
-// Specifies the image view(s) to bind to renderpass attachments
-void skel::Renderer::CreateFrameBuffers()
-{
-	swapchainFrameBuffers.resize((uint32_t)swapchainImages.size());
-
-	VkFramebufferCreateInfo createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-	createInfo.width = swapchainExtent.width;
-	createInfo.height = swapchainExtent.height;
-	createInfo.renderPass = renderpass;
-	createInfo.layers = 1;
-
-	for (uint32_t i = 0; i < (uint32_t)swapchainImages.size(); i++)
-	{
-		std::array<VkImageView, 2> attachments = { swapchainImageViews[i], depthImageView };
-		createInfo.attachmentCount = (uint32_t)attachments.size();
-		createInfo.pAttachments = attachments.data();
-
-		CheckResultCritical(
-			vkCreateFramebuffer(device->logicalDevice, &createInfo, nullptr, &swapchainFrameBuffers[i]),
-			"Failed to create framebuffer"
-			);
-	}
+	// Swapchain images arrive through the acquire semaphore, which is waited on at color output
+	backbufferHandle = frameGraph.ImportImage(
+		"Backbuffer",
+		swapchainFormat,
+		swapchainExtent,
+		VK_IMAGE_ASPECT_COLOR_BIT,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+		headless ? VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+		);
+	depthHandle = frameGraph.CreateImage("Depth", FindDepthFormat(), swapchainExtent, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+	VkExtent2D pyramidExtent = skel::OcclusionCulling::PyramidExtent(swapchainExtent);
+	uint32_t pyramidLevels = skel::OcclusionCulling::PyramidLevels(pyramidExtent);
+	pyramidHandle = frameGraph.CreateImage("HiZ", VK_FORMAT_R32_SFLOAT, pyramidExtent, VK_IMAGE_ASPECT_COLOR_BIT, pyramidLevels);
+
+	// Set every frame -- The commands are per frame slot, and the visibility buffer grows
+	drawCommandsHandle = frameGraph.ImportBuffer("DrawCommands", occlusion.slots[0].commandBuffer, VK_WHOLE_SIZE);
+	visibilityHandle = frameGraph.ImportBuffer("Visibility", occlusion.visibilityBuffer, VK_WHOLE_SIZE);
+
+	// Two-phase occlusion culling -- What was visible last frame is drawn, its depth reduced to a pyramid,
+	// and everything else tested against the pyramid and drawn on top
+	frameGraph.AddPass(
+		"OcclusionEarly",
+		[&](skel::RenderGraphBuilder& _builder) {
+			_builder.ReadBuffer(visibilityHandle, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+			_builder.WriteBuffer(drawCommandsHandle, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+		},
+		[&](VkCommandBuffer _commandBuffer) {
+			occlusion.RecordEarly(_commandBuffer, currentFrame, transientDescriptors);
+		});
+
+	frameGraph.AddPass(
+		"Forward",
+		[&](skel::RenderGraphBuilder& _builder) {
+			_builder.WriteColor(backbufferHandle, VK_ATTACHMENT_LOAD_OP_CLEAR, { 0.02f, 0.025f, 0.03f, 1.0f });
+			_builder.WriteDepth(depthHandle, VK_ATTACHMENT_LOAD_OP_CLEAR);
+			_builder.ReadBuffer(drawCommandsHandle, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+		},
+		[&](VkCommandBuffer _commandBuffer) {
+			DrawRenderableObjects(_commandBuffer, 0);
+		});
+
+	frameGraph.AddPass(
+		"HiZ",
+		[&](skel::RenderGraphBuilder& _builder) {
+			_builder.ReadTexture(depthHandle, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+			_builder.WriteStorageImage(pyramidHandle, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		},
+		[&](VkCommandBuffer _commandBuffer) {
+			occlusion.RecordPyramid(_commandBuffer, currentFrame, transientDescriptors, frameGraph.GetImageView(depthHandle), swapchainExtent);
+		});
+
+	frameGraph.AddPass(
+		"OcclusionLate",
+		[&](skel::RenderGraphBuilder& _builder) {
+			_builder.ReadTexture(pyramidHandle, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+			_builder.WriteBuffer(visibilityHandle, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+			_builder.WriteBuffer(drawCommandsHandle, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+		},
+		[&](VkCommandBuffer _commandBuffer) {
+			occlusion.RecordLate(_commandBuffer, currentFrame, transientDescriptors, frameGraph.GetImageView(pyramidHandle), cam->projection * cam->view);
+		});
+
+	frameGraph.AddPass(
+		"ForwardLate",
+		[&](skel::RenderGraphBuilder& _builder) {
+			_builder.WriteColor(backbufferHandle, VK_ATTACHMENT_LOAD_OP_LOAD);
+			_builder.WriteDepth(depthHandle, VK_ATTACHMENT_LOAD_OP_LOAD);
+			_builder.ReadBuffer(drawCommandsHandle, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+		},
+		[&](VkCommandBuffer _commandBuffer) {
+			DrawRenderableObjects(_commandBuffer, 1);
+		});
+
+	frameGraph.SetOutput(backbufferHandle);
+	frameGraph.Compile(device);
+	frameGraph.PrintStats();
+
+	occlusion.CreatePyramidViews(frameGraph.GetImage(pyramidHandle), pyramidExtent, pyramidLevels);
 }
 
 // Allocates space for a set of rendering command buffers
@@ -884,74 +1733,129 @@ void skel::Renderer::CreateAndBeginCommandBuffers()
 	AllocateCommandBuffers(VK_COMMAND_BUFFER_LEVEL_PRIMARY, graphicsCommandPoolIndex, commandBuffers);
 }
 
-void skel::Renderer::RecordRenderingCommandBuffers(std::vector<std::vector<Object*>*>* _renderableObjects /*= nullptr*/)
+// Sets the scene whose entities are drawn every frame
+void skel::Renderer::SetScene(skel::Scene* _scene)
 {
-	if (_renderableObjects != nullptr)
-	{
-		renderableObjects = _renderableObjects;
-	}
-	else if (renderableObjects == nullptr)
-	{
-		return;
-	}
+	scene = _scene;
+}
 
-	vkDeviceWaitIdle(device->logicalDevice);
-	vkResetCommandPool(device->logicalDevice, device->commandPools[graphicsCommandPoolIndex], 0);
+// Records the draw commands for one swapchain image
+// Recorded every frame so the draw lists are current
+void skel::Renderer::RecordRenderingCommandBuffer(uint32_t _imageIndex)
+{
+	SKEL_PROFILE_FUNCTION();
 
-	std::array<VkClearValue, 2> clearValues = {};
-	clearValues[0].color = { 0.02f, 0.025f, 0.03f, 1.0f };
-	clearValues[1].depthStencil = { 1.0f, 0 };
+	VkCommandBuffer& commandBuffer = commandBuffers[_imageIndex];
 
 	VkCommandBufferBeginInfo beginInfo = {};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 	beginInfo.pInheritanceInfo = nullptr;
 
-	VkRenderPassBeginInfo renderPassBeginInfo = {};
-	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassBeginInfo.renderPass = renderpass;
-	renderPassBeginInfo.renderArea.offset = { 0, 0 };
-	renderPassBeginInfo.renderArea.extent = swapchainExtent;
-	renderPassBeginInfo.clearValueCount = (uint32_t)clearValues.size();
-	renderPassBeginInfo.pClearValues = clearValues.data();
+	// Begin recording a command
+	CheckResultCritical(
+		vkBeginCommandBuffer(commandBuffer, &beginInfo),
+		"Failed to begin command buffer"
+	);
 
-	uint32_t commandCount = (uint32_t)swapchainFrameBuffers.size();
+	framePacer.BeginFrame(commandBuffer, currentFrame);
+	gpuProfiler.BeginFrame(commandBuffer, currentFrame, frameNumber);
 
-	for (uint32_t i = 0; i < commandCount; i++)
-	{
-		// Begin recording a command
-		CheckResultCritical(
-			vkBeginCommandBuffer(commandBuffers[i], &beginInfo),
-			"Failed to begin command buffer"
-		);
+	frameGraph.SetImportedImage(backbufferHandle, swapchainImages[_imageIndex], swapchainImageViews[_imageIndex]);
+	frameGraph.SetImportedBuffer(drawCommandsHandle, occlusion.slots[currentFrame].commandBuffer);
+	frameGraph.SetImportedBuffer(visibilityHandle, occlusion.visibilityBuffer);
+	frameGraph.Execute(commandBuffer, &gpuProfiler);
 
-		renderPassBeginInfo.framebuffer = swapchainFrameBuffers[i];
-		vkCmdBeginRenderPass(commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	gpuProfiler.EndFrame(commandBuffer);
+	framePacer.EndFrame(commandBuffer, currentFrame);
 
-		for (uint32_t j = 0; j < static_cast<uint32_t>(renderableObjects->size()); j++)
-		{
-			std::vector<Object*>* objectGeneration = (*renderableObjects)[j];
-			if (static_cast<uint32_t>(objectGeneration->size()) == 0)
-				continue;
+	// Complete the recording
+	EndCommandBuffer(commandBuffer);
+}
+
+// Draws the draw lists with one occlusion phase's indirect commands -- Expects to be inside a render pass
+// Draws culled by the phase keep their commands, with no instances
+void skel::Renderer::DrawRenderableObjects(VkCommandBuffer _commandBuffer, uint32_t _phase)
+{
+	VkViewport viewport = {};
+	viewport.width = (float)swapchainExtent.width;
+	viewport.height = (float)swapchainExtent.height;
+	viewport.x = 0;
+	viewport.y = 0;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+
+	VkRect2D scissor = {};
+	scissor.extent = swapchainExtent;
+	scissor.offset = { 0, 0 };
 
-			uint32_t generationShaderType = (*objectGeneration)[0]->shader.type;
+	vkCmdSetViewport(_commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(_commandBuffer, 0, 1, &scissor);
 
-			vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[generationShaderType]);
+	if (scene == nullptr)
+		return;
 
-			for (auto& obj : *objectGeneration)
+	// The phase's commands follow each other in draw list order
+	const skel::OcclusionCulling::FrameSlot& slot = occlusion.slots[currentFrame];
+	const VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+	uint32_t firstCommand = _phase == 0 ? 0 : slot.candidateCount;
+	// Without multiDrawIndirect every command is its own draw
+	uint32_t maxDrawCount = device->enabledFeatures.multiDrawIndirect ? device->properties.limits.maxDrawIndirectCount : 1;
+
+	// One pipeline zone per shader, one batch zone per run of draws sharing a mesh
+	// The draw lists were filled by CullObjects
+	uint32_t batch = 0;
+	for (uint32_t shaderType = 0; shaderType < static_cast<uint32_t>(drawLists.size()); shaderType++)
+	{
+		const std::vector<DrawItem>& drawList = drawLists[shaderType];
+		uint32_t drawCount = static_cast<uint32_t>(drawList.size());
+		uint32_t listCommand = firstCommand;
+		firstCommand += drawCount;
+		if (drawList.empty())
+			continue;
+
+		VkPipelineLayout layout = pipelineLayouts[shaderType];
+		gpuProfiler.BeginZone(_commandBuffer, shaderDescriptors[shaderType]->shaderName, "pipeline");
+		vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[shaderType]);
+		vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &globalDescriptorSets[currentFrame], 0, nullptr);
+
+		// The lists are sorted by mesh -- Each run sharing a mesh and per-draw set is one indirect draw
+		const Mesh* boundMesh = nullptr;
+		for (uint32_t first = 0; first < drawCount;)
+		{
+			const DrawItem& item = drawList[first];
+			uint32_t end = first + 1;
+			while (end < drawCount && drawList[end].mesh == item.mesh && drawList[end].descriptorSet == item.descriptorSet)
+				end++;
+
+			if (item.mesh != boundMesh)
 			{
-				obj->Draw(commandBuffers[i], pipelineLayouts[generationShaderType]);
+				if (boundMesh != nullptr)
+					gpuProfiler.EndZone(_commandBuffer);
+				gpuProfiler.BeginZone(_commandBuffer, "Batch " + std::to_string(batch++), "batch");
+
+				VkDeviceSize offsets[] = { 0 };
+				vkCmdBindVertexBuffers(_commandBuffer, 0, 1, &item.mesh->vertexBuffer, offsets);
+				vkCmdBindIndexBuffer(_commandBuffer, item.mesh->indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+				boundMesh = item.mesh;
 			}
+			if (item.descriptorSet != VK_NULL_HANDLE)
+				vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 1, 1, &item.descriptorSet, 0, nullptr);
+
+			for (uint32_t i = first; i < end; i += maxDrawCount)
+				vkCmdDrawIndexedIndirect(_commandBuffer, slot.commandBuffer, (listCommand + i) * stride, std::min(maxDrawCount, end - i), static_cast<uint32_t>(stride));
+			first = end;
 		}
 
-		// Complete the recording
-		EndCommandBuffer(commandBuffers[i]);
+		gpuProfiler.EndZone(_commandBuffer);	// Batch
+		gpuProfiler.EndZone(_commandBuffer);	// Pipeline
 	}
 }
 
 // Allocate memory for command recording
 uint32_t skel::Renderer::AllocateCommandBuffers(VkCommandBufferLevel _level, uint32_t _commandPoolIndex, std::vector<VkCommandBuffer>& _buffers)
 {
-	uint32_t size = (uint32_t)swapchainFrameBuffers.size();
+	uint32_t size = (uint32_t)swapchainImages.size();
 	_buffers.resize(size);
 
 	VkCommandBufferAllocateInfo allocInfo = {};
@@ -970,8 +1874,6 @@ uint32_t skel::Renderer::AllocateCommandBuffers(VkCommandBufferLevel _level, uin
 
 void skel::Renderer::EndCommandBuffer(VkCommandBuffer& _buffer)
 {
-	vkCmdEndRenderPass(_buffer);
-
 	CheckResultCritical(
 		vkEndCommandBuffer(_buffer),
 		"Failed to record command buffer"
@@ -988,7 +1890,8 @@ VkFormat skel::Renderer::FindDepthFormat()
 	return FindSupportedFormat(
 		{ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
 		VK_IMAGE_TILING_OPTIMAL,
-		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+		// Sampled to build the occlusion pyramid
+		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
 	);
 }
 
@@ -1021,3 +1924,68 @@ void skel::Renderer::AddShader(
 	newShader.CreateLayoutBindingsAndPool(device->logicalDevice, _bindings, _objectCount);
 }
 
+// Loads a texture into the bindless texture array -- Returns its index
+// _directory is from the base texture resource folder
+uint32_t skel::Renderer::LoadTexture(const char* _directory)
+{
+	uint32_t index = materials.LoadTexture(device, _directory);
+
+	// Update-after-bind allows writing sets that in-flight frames are using
+	for (const auto& set : globalDescriptorSets)
+		materials.WriteTextureDescriptor(device->logicalDevice, set, 4, index);
+
+	return index;
+}
+
+// Reserves a slot in the bindless texture array and streams the texture into it -- Returns its index right away
+// In-flight frames may be sampling the placeholder, so each frame slot's set is rewritten when it is recorded next
+uint32_t skel::Renderer::StreamTexture(const char* _directory)
+{
+	uint32_t index = materials.ReserveTexture();
+	for (const auto& set : globalDescriptorSets)
+		materials.WriteTextureDescriptor(device->logicalDevice, set, 4, index);
+
+	streamer.LoadTexture(_directory, [this, index](skel::StreamRequest& _request) {
+		*materials.textures[index] = _request.texture;
+		_request.texture = {};
+		for (auto& pending : pendingTextureWrites)
+			pending.push_back(index);
+	});
+
+	return index;
+}
+
+// Adds a material to the material buffer -- Returns its index
+uint32_t skel::Renderer::CreateMaterial(const skel::MaterialInfo& _material)
+{
+	return materials.AddMaterial(device, _material);
+}
+
+// Allocates a set that is valid until this frame slot is rendered again
+VkDescriptorSet skel::Renderer::AllocateTransientDescriptorSet(VkDescriptorSetLayout _layout)
+{
+	return transientDescriptors.Allocate(device->logicalDevice, currentFrame, _layout);
+}
+
+// Sums the pool usage of every descriptor allocator
+skel::DescriptorAllocatorStats skel::Renderer::GetDescriptorStats()
+{
+	skel::DescriptorAllocatorStats total = transientDescriptors.stats;
+	for (const auto& descriptor : shaderDescriptors)
+	{
+		const skel::DescriptorAllocatorStats& stats = descriptor->allocator.stats;
+		total.poolsCreated  += stats.poolsCreated;
+		total.poolResets    += stats.poolResets;
+		total.setsAllocated += stats.setsAllocated;
+		total.setsRecycled  += stats.setsRecycled;
+		total.setsInUse     += stats.setsInUse;
+		total.setsFree      += stats.setsFree;
+	}
+	return total;
+}
+
+// Writes the pipeline cache to disk so the next run skips shader compilation
+void skel::Renderer::SavePipelineCache()
+{
+	pipelineCache.Save(device->logicalDevice);
+}
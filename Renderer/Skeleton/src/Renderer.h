@@ -3,6 +3,7 @@
 #include <iostream>
 #include <vector>
 #include <unordered_map>
+#include <chrono>
 
 #include "Common.h"
 #include "VulkanDevice.h"
@@ -12,6 +13,17 @@
 #include "Mesh.h"
 #include "Texture.h"
 #include "Camera.h"
+#include "Materials.h"
+#include "Lights.h"
+#include "PipelineCache.h"
+#include "FramePacing.h"
+#include "RenderGraph.h"
+#include "GpuProfiler.h"
+#include "AsyncCompute.h"
+#include "Culling.h"
+#include "OcclusionCulling.h"
+#include "SoftwareOcclusion.h"
+#include "AssetStreaming.h"
 
 #define CheckResultCritical(x, message)			\
 	VkResult vkFunctionResult = x;				\
@@ -51,6 +63,15 @@ public:
 		VkPipeline pipeline;
 	};
 
+	// Milliseconds -- Written to the benchmark report instead of printed every run
+	struct StartupStats
+	{
+		float timeToFirstFrame = 0.0f;	// From renderer creation to the first frame's submission
+		bool warmPipelineCache = false;	// The cache file was loaded and matched this device
+		uint32_t swapchainRecreates = 0;
+		float lastRecreateTime = 0.0f;
+	};
+
 // ------------------------------------------- //
 // Member variables
 // ------------------------------------------- //
@@ -60,7 +81,8 @@ public:
 	std::vector<const char*> instanceExtensions = {};
 	std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
-	std::vector<std::vector<Object*>*>* renderableObjects;
+	// Entities with a LocalToWorld, MeshRef, Material, WorldBounds, and Visibility are drawn every frame they are in view
+	skel::Scene* scene = nullptr;
 
 // ------------------------------------------- //
 // Listeners
@@ -73,7 +95,13 @@ public:
 // ------------------------------------------- //
 
 	SDL_Window* window;
-	bool windowResized;
+	bool windowResized = false;
+
+	// Headless rendering -- Offscreen images stand in for the swapchain's images
+	bool headless = false;
+	VkExtent2D headlessExtent = {};
+	std::vector<VkDeviceMemory> offscreenImageMemories;
+	uint32_t lastRenderedImage = 0;
 	Camera* cam;
 
 	VkInstance instance;
@@ -82,35 +110,120 @@ public:
 	uint32_t graphicsCommandPoolIndex;
 
 	VkSwapchainKHR swapchain;
+	// Replaced swapchains -- Their presents aren't tracked by the timeline, so they live until every image
+	// of the current swapchain has been presented once and one of them comes back from an acquire
+	std::vector<VkSwapchainKHR> retiredSwapchains;
+	std::vector<uint8_t> swapchainImagesPresented;
+	uint32_t swapchainImagesUnpresented = 0;
 	std::vector<VkImage> swapchainImages;
 	std::vector<VkImageView> swapchainImageViews;
-	std::vector<VkFramebuffer> swapchainFrameBuffers;
 	VkExtent2D swapchainExtent;
 	VkFormat swapchainFormat;
 
-	VkImage depthImage;
-	VkImageView depthImageView;
-	VkDeviceMemory depthImageMemory;
+	// Passes, attachments, and barriers for a frame -- Rebuilt with the swapchain
+	skel::RenderGraph frameGraph;
+	skel::RenderGraphHandle backbufferHandle;
+	skel::RenderGraphHandle depthHandle;
+	skel::RenderGraphHandle pyramidHandle;
+	skel::RenderGraphHandle drawCommandsHandle;	// The frame slot's indirect commands
+	skel::RenderGraphHandle visibilityHandle;
 
 	std::vector<skel::ShaderDescriptorInformation*> shaderDescriptors;
+	// Only used to create pipelines -- Compatible with the frame graph's render passes
 	VkRenderPass renderpass;
+
+	// Frame-wide shader data (descriptor set 0)
+	VkDescriptorSetLayout globalDescriptorSetLayout;
+	VkDescriptorPool globalDescriptorPool;
+	std::vector<VkDescriptorSet> globalDescriptorSets;
+	std::vector<VkBuffer> cameraBuffers;
+	std::vector<VkDeviceMemory> cameraBufferMemories;
+	std::vector<VkBuffer> lightBuffers;
+	std::vector<VkDeviceMemory> lightBufferMemories;
+
+	// Every drawable entity's matrices & material index, indexed by entity -- Persistently mapped, grown on demand
+	// Only changed entries are rewritten, unless the camera moved
+	std::vector<VkBuffer> objectBuffers;
+	std::vector<VkDeviceMemory> objectBufferMemories;
+	std::vector<skel::ObjectData*> objectBufferData;
+	std::vector<uint32_t> objectBufferCapacities;	// Entries
+	std::vector<glm::mat4> objectBufferViewProjections;	// The camera the buffer's matrices were written with
+	std::vector<bool> objectBufferCurrent;	// False until fully written
+	std::vector<std::vector<skel::ecs::Entity>> pendingObjectWrites;	// Changes a frame slot's buffer hasn't seen yet
+
+	// The draw query's chunks -- Valid for the frame being recorded
+	typedef skel::ecs::ChunkView<skel::LocalToWorld, skel::MeshRef, skel::Material, skel::WorldBounds, skel::Visibility> DrawChunk;
+	std::vector<DrawChunk> drawChunks;
+
+	// One visible entity's draw -- objectIndex is its object buffer entry
+	struct DrawItem
+	{
+		const Mesh* mesh;
+		VkDescriptorSet descriptorSet;
+		uint32_t objectIndex;
+		skel::WorldBounds bounds;	// Tested against the depth pyramid
+	};
+	// Per shader type, in chunk order -- Only entities that survived culling
+	std::vector<std::vector<DrawItem>> drawLists;
+	std::vector<skel::ecs::Entity> visibleEntities;		// From the scene's spatial indices
+	std::vector<uint8_t> occludedEntities;				// Per visible entity -- Hidden by the software occlusion buffer
+	// Occluder entities in view, rasterized on the CPU -- Hides draws before they reach the GPU
+	skel::SoftwareOcclusion softwareOcclusion;
+	skel::CullingStats cullingStats;
+	// Hides frustum-visible draws behind the depth of what was visible last frame -- Every draw is indirect
+	skel::OcclusionCulling occlusion;
+
+	// Descriptor sets that only live for one frame
+	skel::TransientDescriptorAllocator transientDescriptors;
+
+	// Bindless textures and the material buffer
+	skel::MaterialLibrary materials;
+	// Streamed textures that arrived -- Written to each frame slot's set when that slot is recorded next
+	std::vector<std::vector<uint32_t>> pendingTextureWrites;
+	// Reads & decodes files on workers, then uploads them without waiting -- Used by objects and StreamTexture
+	skel::AssetStreamer streamer;
+	// Copied to the frame's light buffer before it is rendered
+	skel::lights::ShaderLights lights = {};
+
+	// Loaded from disk on startup so pipeline creation can skip shader compilation
+	skel::PipelineCache pipelineCache;
 	std::vector<VkPipelineLayout> pipelineLayouts;
 	std::vector<VkPipeline> pipelines;
 
 	// Synchronization
-	const uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+	// Per-frame objects are created for the most frames the pacer allows
+	// framePacer.settings.framesInFlight decides how many are rotated through
+	static const uint32_t MAX_FRAMES_IN_FLIGHT = skel::FramePacer::maxFramesInFlight;
+	skel::FramePacer framePacer;
+	// Per pass, pipeline, and batch GPU times -- Uses the same frame slots
+	skel::GpuProfiler gpuProfiler;
+	bool frameWaited = false;
 	uint32_t currentFrame = 0;
+	uint64_t frameNumber = 0;
 	std::vector<VkSemaphore> imageAvailableSemaphores;
 	std::vector<VkSemaphore> renderCompleteSemaphores;
-	std::vector<VkFence> inFlightFences;
-	std::vector<VkFence> imageIsInFlight;
+	// Timeline values signaled by the last submission of each frame slot and swapchain image
+	std::vector<uint64_t> frameTimelineValues;
+	std::vector<uint64_t> imageTimelineValues;
 
 	std::vector<VkCommandBuffer> commandBuffers;
 
+	// Compute passes submitted to the compute queue before each frame's rendering
+	skel::AsyncCompute asyncCompute;
+
+	// Used to report time-to-first-frame
+	std::chrono::high_resolution_clock::time_point creationTime;
+	StartupStats startupStats;
+
 public:
 	Renderer(SDL_Window*, Camera*);
+	// Headless -- Renders offscreen at a fixed extent without a window, surface, or presentation
+	Renderer(VkExtent2D, Camera*);
 	~Renderer();
 
+	// Creates everything that doesn't depend on the swapchain
+	void CreateVulkanObjects();
+
 	// Creates the render pipeline & components
 	void Initialize();
 
@@ -120,9 +233,36 @@ public:
 	void RecreateRenderer();
 	void CreateRenderer();
 	void CleanupRenderer();
-
+	// Render pass & pipelines -- Survive a resize unless the surface format changes
+	void CreatePipelines();
+	void CleanupPipelines();
+	// Swapchain, frame graph, and command buffers
+	void CreateSwapchainResources();
+	void CleanupSwapchainResources();
+	// Hands the swapchain-sized objects to the deletion queue -- Destroyed once the frames using them complete
+	void RetireSwapchainResources(uint64_t);
+	// Destroys the retired swapchains once the presentation engine is done with them
+	void ReleaseRetiredSwapchains();
+
+	// Waits for the next frame slot to be free and paces the CPU -- Call before sampling input
+	void WaitForNextFrame();
 	// Handles rendering and presentation to the window
 	void RenderFrame();
+	// Moves to the next frame slot
+	void AdvanceFrame();
+	// Copies the most recently rendered headless frame to host memory -- Tightly packed BGRA8 rows
+	void ReadbackFrame(std::vector<uint8_t>&);
+	// Applies a new frames-in-flight count, present mode, or latency mode
+	void SetFramePacing(const skel::FramePacingSettings&);
+	const skel::FramePacer& GetFramePacer() { return framePacer; }
+	skel::GpuProfiler& GetGpuProfiler() { return gpuProfiler; }
+	const skel::CullingStats& GetCullingStats() { return cullingStats; }
+	// A few frames old -- Read back when the frame slot is reused
+	const skel::OcclusionStats& GetOcclusionStats() { return occlusion.stats; }
+	const skel::AssetStreamerStats& GetStreamingStats() { return streamer.stats; }
+	const StartupStats& GetStartupStats() { return startupStats; }
+	// Runs every frame on the compute queue -- Rendering waits for it at the pass's consumer stages
+	void AddAsyncComputePass(const skel::AsyncComputePass& _pass) { asyncCompute.AddPass(_pass); }
 
 	// Basic initialization
 	// ==========================================
@@ -134,7 +274,7 @@ public:
 	// Selects a physical device and initializes a logical device
 	void CreateVulkanDevice();
 	// Determines the suitability of physical devices and selects the first suitable
-	uint32_t ChooseSuitableDevice(std::vector<VkPhysicalDevice>, uint32_t&, uint32_t&, uint32_t&);
+	uint32_t ChooseSuitableDevice(std::vector<VkPhysicalDevice>, uint32_t&, uint32_t&, uint32_t&, uint32_t&);
 	// Returns the index of the first queue with desired properties
 	uint32_t GetQueueFamilyIndex(std::vector<VkQueueFamilyProperties>, VkQueueFlags);
 	// Returns the index of the first queue that supports the surface -- Queries for WSI support
@@ -146,12 +286,25 @@ public:
 	void CreateSyncObjects();
 	// Create the basic command pool for rendering
 	void CreateCommandPools();
+	// Creates the frame-wide descriptor set (set 0) for every frame in flight
+	void CreateGlobalDescriptors();
+	// Copies the camera's matrices and the scene's lights into the frame's buffers
+	void UpdateFrameBuffers(uint32_t);
+	// (Re)creates a frame's object buffer with room for _capacity entries and points its global set at it
+	void CreateObjectBuffer(uint32_t, uint32_t);
+	// Brings the frame's object buffer up to date with the scene's changed entities and the camera
+	void UpdateObjectBuffer(uint32_t);
+	// Tests the draw query's world bounds against the camera's frustum, fills the draw lists, and writes their indirect commands
+	void CullObjects();
 
 	// Renderer creation
 	// ==========================================
 
 	// Creates a swapchain and its images as rendering canvases
-	void CreateSwapchain();
+	// Passing the swapchain being replaced lets presentation continue while the new one is created
+	void CreateSwapchain(VkSwapchainKHR = VK_NULL_HANDLE);
+	// Creates a ring of color images that stand in for the swapchain when rendering headless
+	void CreateOffscreenImages();
 	// Finds a surface with ideal format, present mode, and extent properties
 	void GetIdealSurfaceProperties(SurfaceProperties, VkSurfaceFormatKHR&, VkPresentModeKHR&, VkExtent2D&);
 	// Creates a compact image view object
@@ -164,16 +317,20 @@ public:
 	void CreatePipelineLayout(VkPipelineLayout&, VkDescriptorSetLayout*, uint32_t = 1);
 	// Define the properties for each stage of the graphics pipeline
 	void CreateGraphicsPipeline(const char*, const char*, const VkPipelineLayout&, VkPipeline&);
+	// Creates a compute pipeline from a single shader -- Shares the graphics pipelines' cache
+	void CreateComputePipeline(const char*, const VkPipelineLayout&, VkPipeline&);
 	// Create a pipeline usable object for shader code
 	VkShaderModule CreateShaderModule(const std::vector<char>);
-	// Creates an image and view for the depth texture
-	void CreateDepthResources();
-	// Specifies the image view(s) to bind to renderpass attachments
-	void CreateFrameBuffers();
+	// Declares the frame's passes and compiles them against the current swapchain
+	void BuildFrameGraph();
 	// Allocates space for, creates, and returns a set of rendering command buffers
 	void CreateAndBeginCommandBuffers();
-	// Records draw commands into the command buffers
-	void RecordRenderingCommandBuffers(std::vector<std::vector<Object*>*>* = nullptr);
+	// Sets the scene whose entities are drawn every frame
+	void SetScene(skel::Scene*);
+	// Records draw commands into the command buffer of one swapchain image
+	void RecordRenderingCommandBuffer(uint32_t);
+	// Draws the draw lists with the early (0) or late (1) occlusion phase's indirect commands -- Expects to be inside a render pass
+	void DrawRenderableObjects(VkCommandBuffer, uint32_t);
 	// Allocate memory for command recording
 	uint32_t AllocateCommandBuffers(VkCommandBufferLevel, uint32_t, std::vector<VkCommandBuffer>&);
 	void EndCommandBuffer(VkCommandBuffer&);
@@ -188,6 +345,20 @@ public:
 
 	void AddShader( const char*, const std::vector<VkDescriptorSetLayoutBinding>&, uint32_t);
 
+	// Loads a texture into the bindless texture array -- Returns its index
+	uint32_t LoadTexture(const char*);
+	// Same, without waiting for the file -- The index samples a white placeholder until the texture arrives
+	uint32_t StreamTexture(const char*);
+	// Adds a material to the material buffer -- Returns its index
+	uint32_t CreateMaterial(const skel::MaterialInfo&);
+
+	// Allocates a set that is valid until this frame slot is rendered again
+	VkDescriptorSet AllocateTransientDescriptorSet(VkDescriptorSetLayout);
+	// Writes the pipeline cache to disk so the next run skips shader compilation
+	void SavePipelineCache();
+	// Sums the pool usage of every descriptor allocator
+	skel::DescriptorAllocatorStats GetDescriptorStats();
+
 }; // Renderer
 
 } // namespace skel
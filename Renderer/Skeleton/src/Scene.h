@@ -0,0 +1,141 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+
+#include "ecs/ecs.h"
+#include "TransformHierarchy.h"
+#include "Bvh.h"
+#include "LooseOctree.h"
+
+namespace skel
+{
+	// The entities the renderer draws and the structures kept over them
+	struct Scene
+	{
+		ecs::World world;
+		TransformHierarchy transforms;
+
+		// Entities whose object data (matrices, material) changed -- The renderer consumes these every frame
+		std::vector<ecs::Entity> changedEntities;
+
+		// Every Static entity with WorldBounds -- Rebuilt whole by Update when one moves, is added, or is removed
+		Bvh staticBvh;
+		bool staticBvhDirty = false;
+
+		// Every other entity with WorldBounds in the transform hierarchy -- Kept current by Update as they move
+		LooseOctree dynamicIndex;
+
+		Scene() : transforms(&world) {}
+		Scene(const Scene&) = delete;
+		Scene& operator=(const Scene&) = delete;
+
+		// Recomputes the transforms that moved, then the spatial indices -- Call once per frame, before rendering
+		uint32_t Update()
+		{
+			size_t firstMoved = changedEntities.size();
+			uint32_t updated = transforms.Update(changedEntities);
+
+			for (size_t i = firstMoved; i < changedEntities.size(); i++)
+			{
+				ecs::Entity entity = changedEntities[i];
+				if (world.Has<Static>(entity))
+				{
+					staticBvhDirty = true;
+					continue;
+				}
+
+				const WorldBounds* bounds = world.Get<WorldBounds>(entity);
+				if (bounds)
+					dynamicIndex.Move(entity, *bounds);
+			}
+			if (staticBvhDirty)
+				RebuildStaticBvh();
+
+			return updated;
+		}
+
+		// Removes the entity from the scene's structures and destroys it
+		void Destroy(ecs::Entity _entity)
+		{
+			staticBvhDirty |= world.Has<Static>(_entity);
+			dynamicIndex.Remove(_entity);
+			transforms.Remove(_entity);
+			world.Destroy(_entity);
+		}
+
+		// Re-uploads an entity's object data without moving it (ex: a new material)
+		void MarkChanged(ecs::Entity _entity)
+		{
+			changedEntities.push_back(_entity);
+		}
+
+		// Static entities are culled & picked through the BVH -- Moving one rebuilds it
+		void SetStatic(ecs::Entity _entity, bool _static)
+		{
+			if (!world.IsAlive(_entity) || world.Has<Static>(_entity) == _static)
+				return;
+
+			if (_static)
+			{
+				world.Add(_entity, Static());
+				dynamicIndex.Remove(_entity);
+			}
+			else
+			{
+				world.Remove<Static>(_entity);
+				const WorldBounds* bounds = world.Get<WorldBounds>(_entity);
+				if (bounds && transforms.Contains(_entity))
+					dynamicIndex.Move(_entity, *bounds);
+			}
+			staticBvhDirty = true;
+		}
+
+		// Queries
+		// ==========================================
+
+		// The closest entity whose world box the ray hits
+		BvhHit Raycast(const glm::vec3& _origin, const glm::vec3& _direction, float _maxDistance = FLT_MAX)
+		{
+			BvhHit hit = staticBvh.Raycast(_origin, _direction, _maxDistance);
+			if (!world.IsAlive(hit.entity))
+				hit = BvhHit();
+
+			BvhHit dynamicHit = dynamicIndex.Raycast(_origin, _direction, std::min(hit.distance, _maxDistance));
+			return dynamicHit.distance < hit.distance ? dynamicHit : hit;
+		}
+
+		// Appends every entity whose world box is within _radius of _center -- Ex: the objects a light reaches
+		void QuerySphere(const glm::vec3& _center, float _radius, std::vector<ecs::Entity>& _found)
+		{
+			size_t first = _found.size();
+			staticBvh.QuerySphere(_center, _radius, _found);
+			_found.erase(std::remove_if(_found.begin() + first, _found.end(), [this](ecs::Entity _entity) { return !world.IsAlive(_entity); }), _found.end());
+
+			dynamicIndex.QuerySphere(_center, _radius, _found);
+		}
+
+		// Appends every entity in the frustum
+		void CullFrustum(const Frustum& _frustum, std::vector<ecs::Entity>& _visible) const
+		{
+			staticBvh.CullFrustum(_frustum, _visible);
+			dynamicIndex.CullFrustum(_frustum, _visible);
+		}
+
+	private:
+		void RebuildStaticBvh()
+		{
+			staticBvhDirty = false;
+
+			std::vector<WorldBounds> bounds;
+			std::vector<ecs::Entity> entities;
+			world.ForEachChunk<Static, WorldBounds>([&](ecs::ChunkView<Static, WorldBounds>& _chunk) {
+				bounds.insert(bounds.end(), _chunk.Get<WorldBounds>(), _chunk.Get<WorldBounds>() + _chunk.count);
+				entities.insert(entities.end(), _chunk.entities, _chunk.entities + _chunk.count);
+			});
+			staticBvh.Build(bounds.data(), entities.data(), static_cast<uint32_t>(bounds.size()));
+		}
+	}; // Scene
+
+} // namespace skel
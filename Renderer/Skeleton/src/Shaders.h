@@ -7,6 +7,7 @@
 #include "Initializers.h"
 #include "VulkanDevice.h"
 #include "Lights.h"
+#include "Descriptors.h"
 
 #include "ecs/ecs.h"
 
@@ -22,7 +23,9 @@ namespace skel
 	{
 	public:
 		skel::ShaderTypes type;
-		VkDescriptorSet descriptorSet;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		// The allocator descriptorSet is returned to on cleanup
+		skel::DescriptorAllocator* descriptorAllocator = nullptr;
 
 		std::vector<BufferComponent*> buffers = {};
 		std::vector<TextureComponent*> textures = {};
@@ -82,11 +85,18 @@ namespace skel
 
 		void Cleanup(VkDevice& _device)
 		{
+			if (descriptorAllocator != nullptr)
+			{
+				descriptorAllocator->Release(descriptorSet);
+				descriptorAllocator = nullptr;
+				descriptorSet = VK_NULL_HANDLE;
+			}
+
 			for (auto buffer : buffers)
 			{
 				vkDestroyBuffer(_device, buffer->buffer, nullptr);
 				vkFreeMemory(_device, buffer->memory, nullptr);
-				free(buffer);
+				delete buffer;
 			}
 
 			for (auto& tex : textures)
@@ -95,7 +105,7 @@ namespace skel
 				vkDestroyImageView(_device, tex->view, nullptr);
 				vkDestroySampler(_device, tex->sampler, nullptr);
 				vkFreeMemory(_device, tex->memory, nullptr);
-				free(tex);
+				delete tex;
 			}
 		}
 	}; // Base Shader
@@ -106,15 +116,14 @@ namespace skel
 		const char* shaderName;
 		std::vector<VkDescriptorSetLayoutBinding> bindings;
 		VkDescriptorSetLayout descriptorSetLayout;
-		VkDescriptorPool descriptorPool;
-		uint32_t poolSize = 1;
-		uint32_t boundObjects = 0;
+		skel::DescriptorAllocator allocator;
 
 		ShaderDescriptorInformation(const char* _name)
 		{
 			shaderName = _name;
 		}
 
+		// _objectCount is the number of sets each pool in the allocator's chain holds
 		void CreateLayoutBindingsAndPool(
 			VkDevice& _device,
 			const std::vector<VkDescriptorSetLayoutBinding>& _bindings,
@@ -134,49 +143,18 @@ namespace skel
 			if (vkCreateDescriptorSetLayout(_device, &layoutCreateInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
 				throw std::runtime_error("Failed to create a descriptor set layout");
 
-			CreateDescriptorPool(_device, _objectCount);
-		}
-
-		void CreateDescriptorPool(VkDevice& _device, uint32_t _poolSize)
-		{
-			// Create Descriptor Pool
-			// ==============================
-			uint32_t bindingsCount = static_cast<uint32_t>(bindings.size());
-
-			std::vector<VkDescriptorPoolSize> poolSizes(bindingsCount);
-			for (uint32_t i = 0; i < bindingsCount; i++)
-			{
-				poolSizes[i] = skel::initializers::DescriptorPoolSize(bindings[i].descriptorType, _poolSize);
-			}
-
-			VkDescriptorPoolCreateInfo poolCreateInfo = {};
-			poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-			poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-			poolCreateInfo.pPoolSizes = poolSizes.data();
-			poolCreateInfo.maxSets = _poolSize;
-
-			if (vkCreateDescriptorPool(_device, &poolCreateInfo, nullptr, &descriptorPool) != VK_SUCCESS)
-				throw std::runtime_error("Failed to create descriptor pool");
-
-			poolSize = _poolSize;
+			// Pools are created on first allocation
+			allocator.Create(descriptorSetLayout, bindings, _objectCount);
 		}
 
 		void CreateDescriptorSets(VkDevice& _device, skel::BaseShader& _shaderInfo)
 		{
-			// Resize the pool to allow additional objects
-			if (boundObjects >= poolSize)
-			{
-				CreateDescriptorPool(_device, poolSize * 2);
-			}
+			// Bindless shaders read everything from the global set
+			if (bindings.empty())
+				return;
 
-			VkDescriptorSetAllocateInfo allocInfo = {};
-			allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-			allocInfo.descriptorPool = descriptorPool;
-			allocInfo.descriptorSetCount = 1;
-			allocInfo.pSetLayouts = &descriptorSetLayout;
-
-			if (vkAllocateDescriptorSets(_device, &allocInfo, &_shaderInfo.descriptorSet) != VK_SUCCESS)
-				throw std::runtime_error("Failed to create descriptor sets");
+			_shaderInfo.descriptorSet = allocator.Allocate(_device);
+			_shaderInfo.descriptorAllocator = &allocator;
 
 			std::vector<VkWriteDescriptorSet> descriptorWrites;
 			std::vector<VkDescriptorBufferInfo> bufferInfos;
@@ -184,14 +162,12 @@ namespace skel
 			_shaderInfo.GetDescriptorWriteSets(descriptorWrites, bufferInfos, imageInfos);
 
 			vkUpdateDescriptorSets(_device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
-
-			boundObjects++;
 		}
 
 		void Cleanup(VkDevice& _device)
 		{
 			vkDestroyDescriptorSetLayout(_device, descriptorSetLayout, nullptr);
-			vkDestroyDescriptorPool(_device, descriptorPool, nullptr);
+			allocator.Cleanup(_device);
 		}
 	}; // ShaderDescriptorInfo
 
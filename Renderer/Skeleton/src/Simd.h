@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// Vector backend -- SSE on x86 (with an AVX2 path picked at runtime), NEON on ARM, plain floats otherwise
+// Define SKEL_SIMD_SCALAR to force the plain float backend
+#if !defined(SKEL_SIMD_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+	#define SKEL_SIMD_SSE 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#endif
+	// GCC & Clang only emit AVX2 instructions in functions marked for it -- MSVC emits them anywhere
+	#if defined(__GNUC__) || defined(__clang__)
+		#define SKEL_SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+	#else
+		#define SKEL_SIMD_TARGET_AVX2
+	#endif
+#elif !defined(SKEL_SIMD_SCALAR) && (defined(__ARM_NEON) || defined(_M_ARM64))
+	#define SKEL_SIMD_NEON 1
+	#include <arm_neon.h>
+#endif
+
+namespace skel
+{
+namespace simd
+{
+// ==============================================
+// Float4
+// ==============================================
+
+#if defined(SKEL_SIMD_SSE)
+	typedef __m128 Float4;
+
+	inline Float4 Load4(const float* _p) { return _mm_loadu_ps(_p); }
+	inline void Store4(float* _p, Float4 _v) { _mm_storeu_ps(_p, _v); }
+	inline Float4 Splat(float _f) { return _mm_set1_ps(_f); }
+	inline Float4 Add(Float4 _a, Float4 _b) { return _mm_add_ps(_a, _b); }
+	inline Float4 Sub(Float4 _a, Float4 _b) { return _mm_sub_ps(_a, _b); }
+	inline Float4 Mul(Float4 _a, Float4 _b) { return _mm_mul_ps(_a, _b); }
+	inline Float4 MulAdd(Float4 _a, Float4 _b, Float4 _c) { return _mm_add_ps(_mm_mul_ps(_a, _b), _c); }
+	inline Float4 Min(Float4 _a, Float4 _b) { return _mm_min_ps(_a, _b); }
+
+	// Masks are all ones or all zeros per lane
+	inline Float4 Less(Float4 _a, Float4 _b) { return _mm_cmplt_ps(_a, _b); }
+	inline Float4 Or(Float4 _a, Float4 _b) { return _mm_or_ps(_a, _b); }
+	inline int MoveMask(Float4 _mask) { return _mm_movemask_ps(_mask); }	// Lane i -> bit i
+
+	inline void Transpose4(Float4& _a, Float4& _b, Float4& _c, Float4& _d)
+	{
+		_MM_TRANSPOSE4_PS(_a, _b, _c, _d);
+	}
+
+	// Four packed vec3s (12 floats) split into x, y, & z lanes
+	inline void LoadVec3x4(const float* _p, Float4& _x, Float4& _y, Float4& _z)
+	{
+		__m128 a = _mm_loadu_ps(_p);		// x0 y0 z0 x1
+		__m128 b = _mm_loadu_ps(_p + 4);	// y1 z1 x2 y2
+		__m128 c = _mm_loadu_ps(_p + 8);	// z2 x3 y3 z3
+
+		__m128 x01 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 3, 0));	// x0 x1 x2 y1
+		__m128 x23 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));	// x2 x2 x3 x3
+		_x = _mm_shuffle_ps(x01, x23, _MM_SHUFFLE(2, 0, 1, 0));
+
+		__m128 y01 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 0, 1, 1));	// y0 y0 y1 y2
+		__m128 y23 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));	// y2 y2 y3 y3
+		_y = _mm_shuffle_ps(y01, y23, _MM_SHUFFLE(2, 0, 2, 0));
+
+		__m128 z01 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));	// z0 z0 z1 z1
+		__m128 z23 = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0));	// z2 z2 z3 z3
+		_z = _mm_shuffle_ps(z01, z23, _MM_SHUFFLE(2, 0, 2, 0));
+	}
+
+#elif defined(SKEL_SIMD_NEON)
+	typedef float32x4_t Float4;
+
+	inline Float4 Load4(const float* _p) { return vld1q_f32(_p); }
+	inline void Store4(float* _p, Float4 _v) { vst1q_f32(_p, _v); }
+	inline Float4 Splat(float _f) { return vdupq_n_f32(_f); }
+	inline Float4 Add(Float4 _a, Float4 _b) { return vaddq_f32(_a, _b); }
+	inline Float4 Sub(Float4 _a, Float4 _b) { return vsubq_f32(_a, _b); }
+	inline Float4 Mul(Float4 _a, Float4 _b) { return vmulq_f32(_a, _b); }
+	inline Float4 MulAdd(Float4 _a, Float4 _b, Float4 _c) { return vmlaq_f32(_c, _a, _b); }
+	inline Float4 Min(Float4 _a, Float4 _b) { return vminq_f32(_a, _b); }
+
+	// Masks are all ones or all zeros per lane
+	inline Float4 Less(Float4 _a, Float4 _b) { return vreinterpretq_f32_u32(vcltq_f32(_a, _b)); }
+	inline Float4 Or(Float4 _a, Float4 _b) { return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(_a), vreinterpretq_u32_f32(_b))); }
+	inline int MoveMask(Float4 _mask)	// Lane i -> bit i
+	{
+		uint32x4_t bits = vshrq_n_u32(vreinterpretq_u32_f32(_mask), 31);
+		return static_cast<int>(vgetq_lane_u32(bits, 0) | (vgetq_lane_u32(bits, 1) << 1) | (vgetq_lane_u32(bits, 2) << 2) | (vgetq_lane_u32(bits, 3) << 3));
+	}
+
+	inline void Transpose4(Float4& _a, Float4& _b, Float4& _c, Float4& _d)
+	{
+		float32x4x2_t ab = vtrnq_f32(_a, _b);
+		float32x4x2_t cd = vtrnq_f32(_c, _d);
+		_a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+		_b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+		_c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+		_d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+	}
+
+	// Four packed vec3s (12 floats) split into x, y, & z lanes
+	inline void LoadVec3x4(const float* _p, Float4& _x, Float4& _y, Float4& _z)
+	{
+		float32x4x3_t v = vld3q_f32(_p);
+		_x = v.val[0];
+		_y = v.val[1];
+		_z = v.val[2];
+	}
+
+#else
+	struct Float4 { float v[4]; };
+
+	inline Float4 Load4(const float* _p) { return { { _p[0], _p[1], _p[2], _p[3] } }; }
+	inline void Store4(float* _p, Float4 _v) { for (int i = 0; i < 4; i++) _p[i] = _v.v[i]; }
+	inline Float4 Splat(float _f) { return { { _f, _f, _f, _f } }; }
+	inline Float4 Add(Float4 _a, Float4 _b) { for (int i = 0; i < 4; i++) _a.v[i] += _b.v[i]; return _a; }
+	inline Float4 Sub(Float4 _a, Float4 _b) { for (int i = 0; i < 4; i++) _a.v[i] -= _b.v[i]; return _a; }
+	inline Float4 Mul(Float4 _a, Float4 _b) { for (int i = 0; i < 4; i++) _a.v[i] *= _b.v[i]; return _a; }
+	inline Float4 MulAdd(Float4 _a, Float4 _b, Float4 _c) { for (int i = 0; i < 4; i++) _c.v[i] += _a.v[i] * _b.v[i]; return _c; }
+	inline Float4 Min(Float4 _a, Float4 _b) { for (int i = 0; i < 4; i++) _a.v[i] = _a.v[i] < _b.v[i] ? _a.v[i] : _b.v[i]; return _a; }
+
+	// Masks are 1 or 0 per lane
+	inline Float4 Less(Float4 _a, Float4 _b) { for (int i = 0; i < 4; i++) _a.v[i] = _a.v[i] < _b.v[i] ? 1.0f : 0.0f; return _a; }
+	inline Float4 Or(Float4 _a, Float4 _b) { for (int i = 0; i < 4; i++) _a.v[i] = (_a.v[i] != 0.0f || _b.v[i] != 0.0f) ? 1.0f : 0.0f; return _a; }
+	inline int MoveMask(Float4 _mask) { int bits = 0; for (int i = 0; i < 4; i++) bits |= (_mask.v[i] != 0.0f ? 1 : 0) << i; return bits; }
+
+	inline void Transpose4(Float4& _a, Float4& _b, Float4& _c, Float4& _d)
+	{
+		Float4 rows[4] = { _a, _b, _c, _d };
+		for (int i = 0; i < 4; i++)
+		{
+			_a.v[i] = rows[i].v[0];
+			_b.v[i] = rows[i].v[1];
+			_c.v[i] = rows[i].v[2];
+			_d.v[i] = rows[i].v[3];
+		}
+	}
+
+	inline void LoadVec3x4(const float* _p, Float4& _x, Float4& _y, Float4& _z)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			_x.v[i] = _p[i * 3 + 0];
+			_y.v[i] = _p[i * 3 + 1];
+			_z.v[i] = _p[i * 3 + 2];
+		}
+	}
+#endif
+
+// ==============================================
+// Dispatch
+// ==============================================
+
+	enum class Path
+	{
+		Scalar,		// One element at a time
+		Vector4,	// SSE, NEON, or plain floats -- Four at a time
+		Avx2		// Eight at a time -- x86 with AVX2 & FMA only
+	};
+
+	inline bool DetectAvx2()
+	{
+	#if defined(SKEL_SIMD_SSE) && defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		__cpuid(info, 1);
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		// The OS must also save the YMM registers on context switches
+		if (!fma || !osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+			return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	#elif defined(SKEL_SIMD_SSE)
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	#else
+		return false;
+	#endif
+	}
+
+	// The widest path this CPU runs -- Checked once
+	inline Path BestPath()
+	{
+		static const Path path = DetectAvx2() ? Path::Avx2 : Path::Vector4;
+		return path;
+	}
+
+} // namespace simd
+} // namespace skel
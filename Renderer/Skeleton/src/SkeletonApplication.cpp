@@ -11,6 +11,21 @@ void skel::SkeletonApplication::Run()
 	Cleanup();
 }
 
+void skel::SkeletonApplication::RunHeadless(uint32_t _frameCount)
+{
+	headless = true;
+	headlessFrameCount = _frameCount;
+	Run();
+}
+
+void skel::SkeletonApplication::RunBenchmark(const skel::BenchmarkSettings& _settings, bool _headless /*= false*/)
+{
+	benchmark.Start(_settings);
+	headless = _headless;
+	headlessFrameCount = _settings.warmupFrames + _settings.frameCount;
+	Run();
+}
+
 void skel::SkeletonApplication::WindowResizeListener(SDL_Window* _window)
 {
 	int width, height;
@@ -22,6 +37,27 @@ void skel::SkeletonApplication::WindowResizeListener(SDL_Window* _window)
 
 void skel::SkeletonApplication::HandleInput()
 {
+	SKEL_PROFILE_FUNCTION();
+
+	// The camera follows the benchmark's path -- Only quitting is read from the window
+	if (benchmark.active)
+	{
+		SDL_Event e;
+		while (!headless && SDL_PollEvent(&e) != 0)
+			if (e.type == SDL_QUIT || (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE))
+				applicationShouldClose = true;
+
+		benchmark.ApplyCamera(cam, time.frameNumber);
+		return;
+	}
+
+	// No window to receive input from
+	if (headless)
+	{
+		cam->UpdateCameraView();
+		return;
+	}
+
 	SDL_Event e;
 	float camSpeed = 1.0f;
 	while (SDL_PollEvent(&e) != 0)
@@ -41,6 +77,64 @@ void skel::SkeletonApplication::HandleInput()
 				cam->pitch = -89.f;
 		}
 
+		// Writes every CPU zone recorded so far
+		if (e.type == SDL_KEYDOWN && e.key.repeat == 0 && e.key.keysym.sym == SDLK_F5)
+			SKEL_PROFILE_WRITE_TRACE(cpuTracePath);
+
+		// Toggles borderless fullscreen -- The swapchain is recreated from the old one without idling
+		if (e.type == SDL_KEYDOWN && e.key.repeat == 0 && e.key.keysym.sym == SDLK_F11)
+		{
+			fullscreen = !fullscreen;
+			SDL_SetWindowFullscreen(window, fullscreen ? SDL_WINDOW_FULLSCREEN_DESKTOP : 0);
+			renderer->windowResized = true;
+		}
+
+		// Captures the next 120 frames of GPU zones
+		if (e.type == SDL_KEYDOWN && e.key.repeat == 0 && e.key.keysym.sym == SDLK_F4)
+		{
+			renderer->GetGpuProfiler().CaptureTrace(gpuTracePath, 120);
+			std::printf("Capturing GPU trace...\n");
+		}
+
+		// Latency of every pacing mode used so far
+		if (e.type == SDL_KEYDOWN && e.key.repeat == 0 && e.key.keysym.sym == SDLK_F6)
+			renderer->GetFramePacer().PrintLatencyReport();
+
+		// Frame pacing -- F1 present mode, F2 frames in flight, F3 low latency
+		if (e.type == SDL_KEYDOWN && e.key.repeat == 0)
+		{
+			skel::FramePacingSettings pacing = renderer->GetFramePacer().settings;
+			bool pacingChanged = true;
+
+			switch (e.key.keysym.sym)
+			{
+			case SDLK_F1:
+			{
+				const VkPresentModeKHR modes[] = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+				uint32_t next = 0;
+				for (uint32_t i = 0; i < 4; i++)
+					if (modes[i] == pacing.presentMode)
+						next = (i + 1) % 4;
+				pacing.presentMode = modes[next];
+			} break;
+			case SDLK_F2:
+				pacing.framesInFlight = pacing.framesInFlight % skel::FramePacer::maxFramesInFlight + 1;
+				break;
+			case SDLK_F3:
+				pacing.lowLatency = !pacing.lowLatency;
+				break;
+			default:
+				pacingChanged = false;
+			}
+
+			if (pacingChanged)
+			{
+				renderer->SetFramePacing(pacing);
+				std::printf("Frame pacing: %s, %d frame(s) in flight, low latency %s\n",
+					skel::PresentModeName(pacing.presentMode), pacing.framesInFlight, pacing.lowLatency ? "on" : "off");
+			}
+		}
+
 		if (e.type == SDL_MOUSEBUTTONDOWN && e.button.button == 1)
 		{
 			static uint32_t x = e.button.x, y = e.button.y;
@@ -61,6 +155,21 @@ void skel::SkeletonApplication::HandleInput()
 				SDL_WarpMouseInWindow(window, x, y);
 			}
 		}
+
+		// Picks the object under the cursor -- Or under the screen's center while the mouse is held
+		if (e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_RIGHT)
+		{
+			int width = 0, height = 0;
+			SDL_GetWindowSize(window, &width, &height);
+			float x = SDL_GetRelativeMouseMode() ? width * 0.5f : static_cast<float>(e.button.x);
+			float y = SDL_GetRelativeMouseMode() ? height * 0.5f : static_cast<float>(e.button.y);
+
+			skel::BvhHit hit = scene.Raycast(cam->cameraPosition, cam->ScreenRay(x, y, static_cast<float>(width), static_cast<float>(height)));
+			if (hit.entity.IsNull())
+				std::printf("Picked nothing\n");
+			else
+				std::printf("Picked entity %u at %.2f units\n", hit.entity.index, hit.distance);
+		}
 	}
 
 	int count = 0;
@@ -90,10 +199,30 @@ void skel::SkeletonApplication::HandleInput()
 
 void skel::SkeletonApplication::Initialize()
 {
-	CreateWindow();
+	// Started before anything can queue a job, so this thread is thread 0
+	skel::jobs::GetScheduler();
+
 	cam = new skel::Camera((float)windowWidth / (float)windowHeight);
-	renderer = new skel::Renderer(window, cam);
+	if (headless)
+	{
+		renderer = new skel::Renderer(VkExtent2D{ (uint32_t)windowWidth, (uint32_t)windowHeight }, cam);
+	}
+	else
+	{
+		CreateWindow();
+		renderer = new skel::Renderer(window, cam);
+	}
+	renderer->SetScene(&scene);
 	ChildInitialize();
+
+	// Frames aren't held back by the display
+	if (benchmark.active)
+	{
+		skel::FramePacingSettings pacing = renderer->GetFramePacer().settings;
+		pacing.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+		renderer->SetFramePacing(pacing);
+	}
+
 	renderer->Initialize();
 }
 
@@ -126,6 +255,11 @@ void skel::SkeletonApplication::MainLoop()
 
 	while (!applicationShouldClose)
 	{
+		SKEL_PROFILE_SCOPE("MainLoop");
+
+		// Input is sampled in MainLoopCore, so pacing happens first
+		renderer->WaitForNextFrame();
+		auto coreStart = std::chrono::high_resolution_clock::now();
 		MainLoopCore();
 
 		auto current = std::chrono::high_resolution_clock::now();
@@ -133,12 +267,58 @@ void skel::SkeletonApplication::MainLoop()
 		time.totalTime = std::chrono::duration<float, std::chrono::seconds::period>(current - start).count();
 		old = current;
 
+		if (benchmark.active)
+		{
+			const skel::GpuProfiler& profiler = renderer->GetGpuProfiler();
+			benchmark.RecordFrame(
+				time.frameNumber,
+				time.deltaTime * 1000.0f,
+				std::chrono::duration<float, std::chrono::milliseconds::period>(current - coreStart).count(),
+				profiler.resultsFrame,
+				profiler.results.empty() ? 0.0f : static_cast<float>(profiler.results[0].duration)
+				);
+
+			// The scene advances by a fixed step, so every run renders the same frames
+			time.deltaTime = benchmark.settings.simulationStep;
+			time.totalTime = (time.frameNumber + 1) * benchmark.settings.simulationStep;
+
+			if (benchmark.IsFinished(time.frameNumber + 1))
+			{
+				const skel::Renderer::StartupStats& startup = renderer->GetStartupStats();
+				benchmark.WriteReport(
+					skel::PresentModeName(renderer->GetFramePacer().settings.presentMode),
+					renderer->swapchainExtent,
+					startup.timeToFirstFrame,
+					startup.warmPipelineCache,
+					startup.swapchainRecreates,
+					startup.lastRecreateTime
+					);
+				applicationShouldClose = true;
+			}
+		}
+
 		if (std::floor(time.totalTime) != prevTotalTime)
 		{
 			prevTotalTime = std::floor(time.totalTime);
-			std::printf("%5f (%4d FPS) : %6d\n", time.deltaTime, (int)(1 / time.deltaTime), time.frameNumber);
+			const skel::FramePacer& pacer = renderer->GetFramePacer();
+			const skel::CullingStats& culling = renderer->GetCullingStats();
+			const skel::OcclusionStats& occlusion = renderer->GetOcclusionStats();
+			std::printf("%5f (%4d FPS) : %6d | GPU %.2f ms, CPU %.2f ms, input-to-present %.2f ms | %u / %u objects visible, %u hidden by %u occluders, %.1f%% occluded on the GPU (%u early, %u late)\n",
+				time.deltaTime, (int)(1 / time.deltaTime), time.frameNumber, pacer.gpuTime, pacer.cpuTime, pacer.latency, culling.visible, culling.total,
+				culling.occluded, culling.occluders, occlusion.OccludedRatio() * 100.0f, occlusion.drawnEarly, occlusion.drawnLate);
+
+			const skel::AssetStreamerStats& streaming = renderer->GetStreamingStats();
+			if (streaming.decoding + streaming.uploading > 0)
+				std::printf("    Streaming %u decoding, %u uploading, %u done\n", streaming.decoding, streaming.uploading, streaming.completed);
+
+			for (const auto& zone : renderer->GetGpuProfiler().results)
+				if (zone.depth == 1)
+					std::printf("    %-16s %.3f ms\n", zone.name.c_str(), zone.duration);
 		}
 		time.frameNumber++;
+
+		if (headless && time.frameNumber >= headlessFrameCount)
+			applicationShouldClose = true;
 	}
 	vkDeviceWaitIdle(renderer->device->logicalDevice);
 }
@@ -147,12 +327,12 @@ void skel::SkeletonApplication::Cleanup()
 {
 	ChildCleanup();
 
-	renderer->CleanupRenderer();
-	free(renderer);
-
-	free(cam);
+	// Compares the pacing modes tried during the run
+	if (renderer->GetFramePacer().modeLatencies.size() > 1)
+		renderer->GetFramePacer().PrintLatencyReport();
 
-	SDL_DestroyWindow(window);
-	SDL_Quit();
+	// Waits for the streamer's jobs, saves the pipeline cache, and destroys the window
+	delete renderer;
+	delete cam;
 }
 
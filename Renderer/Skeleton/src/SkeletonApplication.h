@@ -8,6 +8,8 @@
 #include "Common.h"
 #include "Renderer.h"
 #include "Camera.h"
+#include "Benchmark.h"
+#include "JobSystem.h"
 
 namespace skel {
 
@@ -41,10 +43,19 @@ protected:
 // VARIABLES
 // ==============================================
 protected:
-	SDL_Window* window;
+	SDL_Window* window = nullptr;
 	SDL_Cursor* cursor;
 	bool applicationShouldClose = false;
+	bool fullscreen = false;
+
+	// Renders offscreen for a fixed number of frames -- No window, input, or presentation
+	bool headless = false;
+	uint32_t headlessFrameCount = 0;
+	// Scripted camera, fixed time step, and frame time recording
+	skel::Benchmark benchmark;
 	skel::Renderer* renderer;
+	// Every renderable's per-frame data and transform hierarchy -- Drawn by the renderer
+	skel::Scene scene;
 
 	skel::Camera* cam;
 
@@ -53,6 +64,10 @@ protected:
 // ==============================================
 public:
 	void Run();
+	// Runs without a window for _frameCount frames -- For hosts without a display
+	void RunHeadless(uint32_t _frameCount);
+	// Follows the settings' camera path without input, then writes a frame time report
+	void RunBenchmark(const skel::BenchmarkSettings& _settings, bool _headless = false);
 
 	//void CreateObject() {}
 	//void CreateShader() {}
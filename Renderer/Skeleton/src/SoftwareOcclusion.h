@@ -0,0 +1,370 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "ecs/ecs.h"
+#include "Mesh.h"
+#include "Simd.h"
+
+namespace skel
+{
+	// The occlusion buffer's resolution -- Low, since only large occluders are drawn into it
+	struct SoftwareOcclusionSettings
+	{
+		bool enabled = true;
+		uint32_t width = 320;	// Rounded up to whole tiles
+		uint32_t height = 192;
+	};
+
+	// A screen-space triangle, set up once and rasterized by every band it touches
+	// Buffer pixels have their centers at +0.5 -- x right, y in the projection's direction
+	struct OcclusionTriangle
+	{
+		float edgeA[3];		// Edge i is A x + B y + C, positive inside
+		float edgeB[3];
+		float edgeC[3];
+		float depthX;		// Depth plane, moved to each pixel's farthest corner
+		float depthY;
+		float depthC;
+		float maxDepth;		// The farthest vertex -- The plane never goes past it
+		int32_t minX, maxX, minY, maxY;	// Pixels whose centers the triangle may cover, inclusive
+	};
+
+// ==============================================
+// Kernels
+// ==============================================
+
+namespace simd
+{
+	// Keeps the nearest depth of every pixel in rows [_firstRow, _lastRow] whose center the triangle covers
+	inline void RasterizeTriangleRows(const OcclusionTriangle& _triangle, float* _depth, uint32_t _width, int32_t _firstRow, int32_t _lastRow)
+	{
+		for (int32_t y = _firstRow; y <= _lastRow; y++)
+		{
+			float py = static_cast<float>(y) + 0.5f;
+			float row0 = _triangle.edgeB[0] * py + _triangle.edgeC[0];
+			float row1 = _triangle.edgeB[1] * py + _triangle.edgeC[1];
+			float row2 = _triangle.edgeB[2] * py + _triangle.edgeC[2];
+			float rowDepth = _triangle.depthY * py + _triangle.depthC;
+			float* out = _depth + y * _width;
+
+			for (int32_t x = _triangle.minX; x <= _triangle.maxX; x++)
+			{
+				float px = static_cast<float>(x) + 0.5f;
+				if (_triangle.edgeA[0] * px + row0 < 0.0f || _triangle.edgeA[1] * px + row1 < 0.0f || _triangle.edgeA[2] * px + row2 < 0.0f)
+					continue;
+				float depth = std::min(_triangle.depthX * px + rowDepth, _triangle.maxDepth);
+				out[x] = std::min(out[x], depth);
+			}
+		}
+	}
+
+	// Whether any pixel of the rectangle is at or behind _depth -- Rows are _width apart
+	inline bool AnyDepthAtLeast(const float* _depth, uint32_t _width, int32_t _x0, int32_t _x1, int32_t _y0, int32_t _y1, float _value)
+	{
+		for (int32_t y = _y0; y <= _y1; y++)
+		{
+			const float* row = _depth + y * _width;
+			for (int32_t x = _x0; x <= _x1; x++)
+				if (row[x] >= _value)
+					return true;
+		}
+		return false;
+	}
+
+#if defined(SKEL_SIMD_SSE)
+	// Eight pixels of a row at a time -- Rows are padded to whole tiles, so blocks never leave the row
+	SKEL_SIMD_TARGET_AVX2 inline void RasterizeTriangleRows8(const OcclusionTriangle& _triangle, float* _depth, uint32_t _width, int32_t _firstRow, int32_t _lastRow)
+	{
+		const __m256 laneCenters = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 a0 = _mm256_set1_ps(_triangle.edgeA[0]);
+		const __m256 a1 = _mm256_set1_ps(_triangle.edgeA[1]);
+		const __m256 a2 = _mm256_set1_ps(_triangle.edgeA[2]);
+		const __m256 depthX = _mm256_set1_ps(_triangle.depthX);
+		const __m256 maxDepth = _mm256_set1_ps(_triangle.maxDepth);
+		int32_t firstX = _triangle.minX & ~7;
+
+		for (int32_t y = _firstRow; y <= _lastRow; y++)
+		{
+			float py = static_cast<float>(y) + 0.5f;
+			__m256 row0 = _mm256_set1_ps(_triangle.edgeB[0] * py + _triangle.edgeC[0]);
+			__m256 row1 = _mm256_set1_ps(_triangle.edgeB[1] * py + _triangle.edgeC[1]);
+			__m256 row2 = _mm256_set1_ps(_triangle.edgeB[2] * py + _triangle.edgeC[2]);
+			__m256 rowDepth = _mm256_set1_ps(_triangle.depthY * py + _triangle.depthC);
+			float* out = _depth + y * _width;
+
+			for (int32_t x = firstX; x <= _triangle.maxX; x += 8)
+			{
+				__m256 px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), laneCenters);
+				__m256 e0 = _mm256_add_ps(_mm256_mul_ps(a0, px), row0);
+				__m256 e1 = _mm256_add_ps(_mm256_mul_ps(a1, px), row1);
+				__m256 e2 = _mm256_add_ps(_mm256_mul_ps(a2, px), row2);
+				__m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ), _mm256_cmp_ps(e1, zero, _CMP_GE_OQ)), _mm256_cmp_ps(e2, zero, _CMP_GE_OQ));
+				if (_mm256_movemask_ps(inside) == 0)
+					continue;
+
+				__m256 depth = _mm256_min_ps(_mm256_add_ps(_mm256_mul_ps(depthX, px), rowDepth), maxDepth);
+				__m256 current = _mm256_loadu_ps(out + x);
+				_mm256_storeu_ps(out + x, _mm256_blendv_ps(current, _mm256_min_ps(current, depth), inside));
+			}
+		}
+	}
+
+	SKEL_SIMD_TARGET_AVX2 inline bool AnyDepthAtLeast8(const float* _depth, uint32_t _width, int32_t _x0, int32_t _x1, int32_t _y0, int32_t _y1, float _value)
+	{
+		const __m256 laneOffsets = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+		const __m256 value = _mm256_set1_ps(_value);
+		const __m256 first = _mm256_set1_ps(static_cast<float>(_x0));
+		const __m256 last = _mm256_set1_ps(static_cast<float>(_x1));
+		int32_t firstX = _x0 & ~7;
+
+		for (int32_t y = _y0; y <= _y1; y++)
+		{
+			const float* row = _depth + y * _width;
+			for (int32_t x = firstX; x <= _x1; x += 8)
+			{
+				// Only lanes inside [_x0, _x1]
+				__m256 lanes = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), laneOffsets);
+				__m256 valid = _mm256_and_ps(_mm256_cmp_ps(lanes, first, _CMP_GE_OQ), _mm256_cmp_ps(lanes, last, _CMP_LE_OQ));
+				__m256 behind = _mm256_cmp_ps(_mm256_loadu_ps(row + x), value, _CMP_GE_OQ);
+				if (_mm256_movemask_ps(_mm256_and_ps(valid, behind)) != 0)
+					return true;
+			}
+		}
+		return false;
+	}
+#endif
+} // namespace simd
+
+// ==============================================
+// Occlusion buffer
+// ==============================================
+
+	// Masked software occlusion culling -- A few large occluders are rasterized into a small depth buffer on the CPU,
+	// then bounds are tested against it before any draw is recorded. Needs nothing from the GPU
+	//  - Depth is written conservatively: only at covered pixel centers, and at the farthest point of each pixel
+	//  - Every 8 x 8 tile keeps its farthest depth, so most tests end at the tile level
+	//  - Rasterization splits the buffer into bands of tile rows across threads
+	struct SoftwareOcclusion
+	{
+		static const int32_t tileShift = 3;
+		static const uint32_t tileSize = 1 << tileShift;	// Pixels on a side
+
+		SoftwareOcclusionSettings settings;
+		simd::Path path = simd::BestPath();
+
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t tilesX = 0;
+		uint32_t tilesY = 0;
+		std::vector<float> depth;		// Per pixel, row major -- 1 where nothing was drawn
+		std::vector<float> tileDepth;	// The farthest depth in each tile
+
+		glm::mat4 viewProjection = glm::mat4(1.0f);
+		std::vector<OcclusionTriangle> triangles;
+		std::vector<glm::vec4> clipPositions;	// One occluder's vertices -- Reused
+		uint32_t occluderCount = 0;
+
+		// Starts a frame's buffer -- Resized if the settings changed
+		void Begin(const glm::mat4& _viewProjection)
+		{
+			uint32_t tileWidth = std::max(1u, (settings.width + tileSize - 1) / tileSize);
+			uint32_t tileHeight = std::max(1u, (settings.height + tileSize - 1) / tileSize);
+			if (tileWidth != tilesX || tileHeight != tilesY)
+			{
+				tilesX = tileWidth;
+				tilesY = tileHeight;
+				width = tilesX * tileSize;
+				height = tilesY * tileSize;
+				depth.resize(width * height);
+				tileDepth.resize(tilesX * tilesY);
+			}
+
+			viewProjection = _viewProjection;
+			triangles.clear();
+			occluderCount = 0;
+		}
+
+		bool HasOccluders() const { return !triangles.empty(); }
+
+		// Projects the mesh's triangles and sets them up -- Triangles crossing the near plane are left out
+		void AddOccluder(const Mesh& _mesh, const glm::mat4& _model)
+		{
+			glm::mat4 modelViewProjection = viewProjection * _model;
+			clipPositions.resize(_mesh.vertices.size());
+			for (size_t i = 0; i < _mesh.vertices.size(); i++)
+				clipPositions[i] = modelViewProjection * glm::vec4(_mesh.vertices[i].position, 1.0f);
+
+			for (size_t i = 0; i + 2 < _mesh.indices.size(); i += 3)
+				AddTriangle(clipPositions[_mesh.indices[i]], clipPositions[_mesh.indices[i + 1]], clipPositions[_mesh.indices[i + 2]]);
+			occluderCount++;
+		}
+
+		// Draws every added triangle, then finds each tile's farthest depth
+		void Rasterize()
+		{
+			ecs::ParallelFor(tilesY, [&](uint32_t _band) {
+				int32_t firstRow = static_cast<int32_t>(_band * tileSize);
+				int32_t lastRow = firstRow + static_cast<int32_t>(tileSize) - 1;
+				float* bandDepth = depth.data() + firstRow * width;
+				std::fill(bandDepth, bandDepth + tileSize * width, 1.0f);
+
+				for (const auto& triangle : triangles)
+				{
+					if (triangle.maxY < firstRow || triangle.minY > lastRow)
+						continue;
+
+					int32_t first = std::max(triangle.minY, firstRow);
+					int32_t last = std::min(triangle.maxY, lastRow);
+				#if defined(SKEL_SIMD_SSE)
+					if (path == simd::Path::Avx2)
+					{
+						simd::RasterizeTriangleRows8(triangle, depth.data(), width, first, last);
+						continue;
+					}
+				#endif
+					simd::RasterizeTriangleRows(triangle, depth.data(), width, first, last);
+				}
+
+				for (uint32_t tile = 0; tile < tilesX; tile++)
+				{
+					float farthest = 0.0f;
+					for (uint32_t y = 0; y < tileSize; y++)
+					{
+						const float* row = bandDepth + y * width + tile * tileSize;
+						for (uint32_t x = 0; x < tileSize; x++)
+							farthest = std::max(farthest, row[x]);
+					}
+					tileDepth[_band * tilesX + tile] = farthest;
+				}
+			}, 2);
+		}
+
+		// Whether the bounds' box is behind the occluders everywhere it covers
+		// Boxes crossing the near plane, or outside the buffer, are never occluded
+		bool IsOccluded(const WorldBounds& _bounds) const
+		{
+			// The corners are the center's clip position plus or minus each axis' extent
+			glm::vec4 center = viewProjection * glm::vec4(glm::vec3(_bounds.sphere), 1.0f);
+			glm::vec4 axisX = viewProjection[0] * _bounds.extents.x;
+			glm::vec4 axisY = viewProjection[1] * _bounds.extents.y;
+			glm::vec4 axisZ = viewProjection[2] * _bounds.extents.z;
+
+			glm::vec2 low(FLT_MAX);
+			glm::vec2 high(-FLT_MAX);
+			float nearest = 1.0f;
+			for (int i = 0; i < 8; i++)
+			{
+				glm::vec4 clip = center + ((i & 1) ? axisX : -axisX) + ((i & 2) ? axisY : -axisY) + ((i & 4) ? axisZ : -axisZ);
+				if (clip.z < 0.0f || clip.w <= 0.0f)
+					return false;
+
+				float inverseW = 1.0f / clip.w;
+				glm::vec2 ndc = glm::vec2(clip) * inverseW;
+				low = glm::min(low, ndc);
+				high = glm::max(high, ndc);
+				nearest = std::min(nearest, clip.z * inverseW);
+			}
+
+			// Every pixel the rectangle touches
+			int32_t x0 = std::max(0, static_cast<int32_t>(std::floor((low.x * 0.5f + 0.5f) * width)));
+			int32_t y0 = std::max(0, static_cast<int32_t>(std::floor((low.y * 0.5f + 0.5f) * height)));
+			int32_t x1 = std::min(static_cast<int32_t>(width) - 1, static_cast<int32_t>(std::floor((high.x * 0.5f + 0.5f) * width)));
+			int32_t y1 = std::min(static_cast<int32_t>(height) - 1, static_cast<int32_t>(std::floor((high.y * 0.5f + 0.5f) * height)));
+			if (x0 > x1 || y0 > y1)
+				return false;
+
+			// Tiles entirely in front of the box are skipped -- The others are checked pixel by pixel
+			for (int32_t ty = y0 >> tileShift; ty <= y1 >> tileShift; ty++)
+			{
+				for (int32_t tx = x0 >> tileShift; tx <= x1 >> tileShift; tx++)
+				{
+					if (nearest > tileDepth[ty * tilesX + tx])
+						continue;
+
+					int32_t px0 = std::max(x0, tx << tileShift);
+					int32_t px1 = std::min(x1, ((tx + 1) << tileShift) - 1);
+					int32_t py0 = std::max(y0, ty << tileShift);
+					int32_t py1 = std::min(y1, ((ty + 1) << tileShift) - 1);
+				#if defined(SKEL_SIMD_SSE)
+					if (path == simd::Path::Avx2)
+					{
+						if (simd::AnyDepthAtLeast8(depth.data(), width, px0, px1, py0, py1, nearest))
+							return false;
+						continue;
+					}
+				#endif
+					if (simd::AnyDepthAtLeast(depth.data(), width, px0, px1, py0, py1, nearest))
+						return false;
+				}
+			}
+			return true;
+		}
+
+	private:
+		void AddTriangle(const glm::vec4& _c0, const glm::vec4& _c1, const glm::vec4& _c2)
+		{
+			// Near plane crossings would need clipping -- Leaving them out only occludes less
+			if (_c0.w <= 0.0f || _c1.w <= 0.0f || _c2.w <= 0.0f || _c0.z < 0.0f || _c1.z < 0.0f || _c2.z < 0.0f)
+				return;
+
+			glm::vec3 v[3] = { ToScreen(_c0), ToScreen(_c1), ToScreen(_c2) };
+
+			// Both windings are drawn -- Counter-clockwise in buffer space from here on
+			float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+			if (std::abs(area) < 1e-6f)
+				return;
+			if (area < 0.0f)
+			{
+				std::swap(v[1], v[2]);
+				area = -area;
+			}
+
+			OcclusionTriangle triangle;
+			triangle.minX = std::max(0, static_cast<int32_t>(std::ceil(std::min(v[0].x, std::min(v[1].x, v[2].x)) - 0.5f)));
+			triangle.maxX = std::min(static_cast<int32_t>(width) - 1, static_cast<int32_t>(std::floor(std::max(v[0].x, std::max(v[1].x, v[2].x)) - 0.5f)));
+			triangle.minY = std::max(0, static_cast<int32_t>(std::ceil(std::min(v[0].y, std::min(v[1].y, v[2].y)) - 0.5f)));
+			triangle.maxY = std::min(static_cast<int32_t>(height) - 1, static_cast<int32_t>(std::floor(std::max(v[0].y, std::max(v[1].y, v[2].y)) - 0.5f)));
+			if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+				return;
+
+			// Edge i runs from vertex i to the next
+			for (int i = 0; i < 3; i++)
+			{
+				const glm::vec3& a = v[i];
+				const glm::vec3& b = v[(i + 1) % 3];
+				triangle.edgeA[i] = a.y - b.y;
+				triangle.edgeB[i] = b.x - a.x;
+				triangle.edgeC[i] = a.x * b.y - a.y * b.x;
+			}
+
+			// Depth is linear in screen space -- Pushed by half a pixel on each axis toward the far side
+			float depthX = ((v[1].z - v[0].z) * (v[2].y - v[0].y) - (v[2].z - v[0].z) * (v[1].y - v[0].y)) / area;
+			float depthY = ((v[2].z - v[0].z) * (v[1].x - v[0].x) - (v[1].z - v[0].z) * (v[2].x - v[0].x)) / area;
+			triangle.depthX = depthX;
+			triangle.depthY = depthY;
+			triangle.depthC = v[0].z - depthX * v[0].x - depthY * v[0].y + 0.5f * (std::abs(depthX) + std::abs(depthY));
+			triangle.maxDepth = std::max(v[0].z, std::max(v[1].z, v[2].z));
+
+			triangles.push_back(triangle);
+		}
+
+		glm::vec3 ToScreen(const glm::vec4& _clip) const
+		{
+			float inverseW = 1.0f / _clip.w;
+			return glm::vec3(
+				(_clip.x * inverseW * 0.5f + 0.5f) * width,
+				(_clip.y * inverseW * 0.5f + 0.5f) * height,
+				_clip.z * inverseW
+				);
+		}
+	}; // SoftwareOcclusion
+
+} // namespace skel
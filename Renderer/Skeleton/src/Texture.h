@@ -12,7 +12,8 @@
 namespace skel
 {
 	// Transforms the input image's layout for copying data into
-	inline void TransitionImageLayout(VulkanDevice* _device, VkImage _image, VkFormat _format, VkImageLayout _oldLayout, VkImageLayout _newLayout)
+	// Returns the timeline value that signals the transition's completion
+	inline uint64_t TransitionImageLayout(VulkanDevice* _device, VkImage _image, VkFormat _format, VkImageLayout _oldLayout, VkImageLayout _newLayout)
 	{
 		VkCommandBuffer commandBuffer = _device->BeginSingleTimeCommands(_device->graphicsCommandPoolIndex);
 
@@ -50,7 +51,7 @@ namespace skel
 			throw std::invalid_argument("Unsupported layout transition");
 
 		vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-		_device->EndSingleTimeCommands(commandBuffer, _device->graphicsCommandPoolIndex, _device->graphicsQueue);
+		return _device->SubmitSingleTimeCommands(commandBuffer, _device->graphicsCommandPoolIndex, _device->graphicsQueue);
 	}
 
 	inline void CreateTextureSampler(VulkanDevice* _device, VkSampler& _imageSampler)
@@ -77,7 +78,7 @@ namespace skel
 			throw std::runtime_error("Failed to create texture sampler");
 	}
 
-	inline VkImageView CreateImageView(VulkanDevice* _device, VkImage _image, VkFormat _format, VkImageAspectFlags _aspectFlags)
+	inline VkImageView CreateImageView(VulkanDevice* _device, VkImage _image, VkFormat _format, VkImageAspectFlags _aspectFlags, uint32_t _mipLevels = 1, uint32_t _baseMipLevel = 0)
 	{
 		VkImageViewCreateInfo viewInfo = {};
 		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -85,8 +86,8 @@ namespace skel
 		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
 		viewInfo.format = _format;
 		viewInfo.subresourceRange.aspectMask = _aspectFlags;
-		viewInfo.subresourceRange.baseMipLevel = 0;
-		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseMipLevel = _baseMipLevel;
+		viewInfo.subresourceRange.levelCount = _mipLevels;
 		viewInfo.subresourceRange.baseArrayLayer = 0;
 		viewInfo.subresourceRange.layerCount = 1;
 
@@ -103,8 +104,9 @@ namespace skel
 		_imageView = CreateImageView(_device, _image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
 	}
 
-	// Defines and executes a command to copy the buffer to the image
-	inline void CopyBufferToImage(VulkanDevice* _device, VkBuffer _buffer, VkImage _image, uint32_t _width, uint32_t _height)
+	// Defines and submits a command to copy the buffer to the image
+	// Returns the timeline value that signals the copy's completion
+	inline uint64_t CopyBufferToImage(VulkanDevice* _device, VkBuffer _buffer, VkImage _image, uint32_t _width, uint32_t _height)
 	{
 		VkCommandBuffer commandBuffer = _device->BeginSingleTimeCommands(_device->transientPoolIndex);
 
@@ -121,7 +123,7 @@ namespace skel
 
 		vkCmdCopyBufferToImage(commandBuffer, _buffer, _image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 
-		_device->EndSingleTimeCommands(commandBuffer, _device->transientPoolIndex, _device->transferQueue);
+		return _device->SubmitSingleTimeCommands(commandBuffer, _device->transientPoolIndex, _device->transferQueue);
 	}
 
 	// Returns the index of the first memory type on the GPU with the desired filter and properties
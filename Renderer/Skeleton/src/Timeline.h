@@ -0,0 +1,186 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include <vulkan/vulkan.h>
+
+namespace skel
+{
+	// A wait on another timeline's value -- How work on one timeline consumes another's results
+	struct TimelineWait
+	{
+		VkSemaphore semaphore;
+		uint64_t value;
+		VkPipelineStageFlags stages;	// The stages of this submission that wait
+	};
+
+	// A single monotonically increasing timeline semaphore signaled by every queue submission
+	// Anything submitted is done once the completed value reaches the value its submission returned
+	struct GpuTimeline
+	{
+		VkSemaphore semaphore = VK_NULL_HANDLE;
+		uint64_t lastSubmitted = 0;
+		uint64_t completed = 0;		// Cached -- Refreshed by CompletedValue
+		VkQueue lastQueue = VK_NULL_HANDLE;
+		std::mutex submitMutex;
+
+		void Create(VkDevice _device)
+		{
+			VkSemaphoreTypeCreateInfo typeInfo = {};
+			typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+			typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+			typeInfo.initialValue = 0;
+
+			VkSemaphoreCreateInfo createInfo = {};
+			createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			createInfo.pNext = &typeInfo;
+
+			if (vkCreateSemaphore(_device, &createInfo, nullptr, &semaphore) != VK_SUCCESS)
+				throw std::runtime_error("Failed to create timeline semaphore");
+		}
+
+		// Submits a batch that also signals the timeline's next value -- Returns that value
+		// _submitInfo's own wait & signal semaphores must be binary
+		// A batch on a different queue than the previous one waits for it, so values signal in order
+		uint64_t Submit(VkQueue _queue, const VkSubmitInfo& _submitInfo, VkFence _fence = VK_NULL_HANDLE)
+		{
+			return Submit(_queue, _submitInfo, std::vector<TimelineWait>(), _fence);
+		}
+
+		// Same, but the batch also waits for values of other timelines
+		uint64_t Submit(VkQueue _queue, const VkSubmitInfo& _submitInfo, const std::vector<TimelineWait>& _timelineWaits, VkFence _fence = VK_NULL_HANDLE)
+		{
+			std::lock_guard<std::mutex> lock(submitMutex);
+
+			uint64_t value = lastSubmitted + 1;
+
+			std::vector<VkSemaphore> waitSemaphores(_submitInfo.pWaitSemaphores, _submitInfo.pWaitSemaphores + _submitInfo.waitSemaphoreCount);
+			std::vector<VkPipelineStageFlags> waitStages(_submitInfo.pWaitDstStageMask, _submitInfo.pWaitDstStageMask + _submitInfo.waitSemaphoreCount);
+			std::vector<uint64_t> waitValues(_submitInfo.waitSemaphoreCount, 0);
+			if (lastQueue != VK_NULL_HANDLE && lastQueue != _queue && lastSubmitted > 0)
+			{
+				waitSemaphores.push_back(semaphore);
+				waitStages.push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+				waitValues.push_back(lastSubmitted);
+			}
+			for (const auto& wait : _timelineWaits)
+			{
+				if (wait.value == 0)
+					continue;
+				waitSemaphores.push_back(wait.semaphore);
+				waitStages.push_back(wait.stages);
+				waitValues.push_back(wait.value);
+			}
+
+			std::vector<VkSemaphore> signalSemaphores(_submitInfo.pSignalSemaphores, _submitInfo.pSignalSemaphores + _submitInfo.signalSemaphoreCount);
+			std::vector<uint64_t> signalValues(_submitInfo.signalSemaphoreCount, 0);
+			signalSemaphores.push_back(semaphore);
+			signalValues.push_back(value);
+
+			VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+			timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+			timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+			timelineInfo.pWaitSemaphoreValues = waitValues.data();
+			timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+			timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+			VkSubmitInfo submitInfo = _submitInfo;
+			submitInfo.pNext = &timelineInfo;
+			submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+			submitInfo.pWaitSemaphores = waitSemaphores.data();
+			submitInfo.pWaitDstStageMask = waitStages.data();
+			submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+			submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+			if (vkQueueSubmit(_queue, 1, &submitInfo, _fence) != VK_SUCCESS)
+				throw std::runtime_error("Failed to submit to the timeline");
+
+			lastSubmitted = value;
+			lastQueue = _queue;
+			return value;
+		}
+
+		// Lets a submission to another timeline wait for this one to reach _value
+		TimelineWait WaitFor(uint64_t _value, VkPipelineStageFlags _stages) const
+		{
+			return { semaphore, _value, _stages };
+		}
+
+		// The value signaled by the next submission -- Use to stamp work recorded for it
+		uint64_t PendingValue()
+		{
+			return lastSubmitted + 1;
+		}
+
+		uint64_t CompletedValue(VkDevice _device)
+		{
+			vkGetSemaphoreCounterValue(_device, semaphore, &completed);
+			return completed;
+		}
+
+		bool IsComplete(VkDevice _device, uint64_t _value)
+		{
+			return _value <= completed || _value <= CompletedValue(_device);
+		}
+
+		// Blocks until the timeline reaches _value
+		void Wait(VkDevice _device, uint64_t _value, uint64_t _timeout = UINT64_MAX)
+		{
+			if (IsComplete(_device, _value))
+				return;
+
+			VkSemaphoreWaitInfo waitInfo = {};
+			waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+			waitInfo.semaphoreCount = 1;
+			waitInfo.pSemaphores = &semaphore;
+			waitInfo.pValues = &_value;
+			vkWaitSemaphores(_device, &waitInfo, _timeout);
+		}
+
+		void Cleanup(VkDevice _device)
+		{
+			vkDestroySemaphore(_device, semaphore, nullptr);
+			semaphore = VK_NULL_HANDLE;
+		}
+	}; // GpuTimeline
+
+	// Destroys resources once the timeline passes the last value that used them
+	struct DeletionQueue
+	{
+		struct Entry
+		{
+			uint64_t value;
+			std::function<void()> destroy;
+		};
+
+		std::deque<Entry> entries;
+
+		// Entries are expected in increasing value order
+		void Push(uint64_t _value, std::function<void()> _destroy)
+		{
+			entries.push_back({ _value, std::move(_destroy) });
+		}
+
+		// Runs every entry the GPU is finished with
+		void Collect(uint64_t _completedValue)
+		{
+			while (!entries.empty() && entries.front().value <= _completedValue)
+			{
+				entries.front().destroy();
+				entries.pop_front();
+			}
+		}
+
+		// Runs every entry -- The device must be idle
+		void Flush()
+		{
+			for (auto& entry : entries)
+				entry.destroy();
+			entries.clear();
+		}
+	}; // DeletionQueue
+
+} // namespace skel
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "Simd.h"
+
+namespace skel
+{
+namespace simd
+{
+// ==============================================
+// Model matrices
+// ==============================================
+
+	// Translation * rotation * scale, from the quaternion directly -- The reference the vector paths match
+	inline void ComposeModelMatrix(const glm::vec3& _position, const glm::quat& _rotation, const glm::vec3& _scale, glm::mat4& _out)
+	{
+		float x2 = _rotation.x * 2.0f, y2 = _rotation.y * 2.0f, z2 = _rotation.z * 2.0f;
+		float xx = _rotation.x * x2, yy = _rotation.y * y2, zz = _rotation.z * z2;
+		float xy = _rotation.x * y2, xz = _rotation.x * z2, yz = _rotation.y * z2;
+		float wx = _rotation.w * x2, wy = _rotation.w * y2, wz = _rotation.w * z2;
+
+		_out[0] = glm::vec4((1.0f - (yy + zz)) * _scale.x, (xy + wz) * _scale.x, (xz - wy) * _scale.x, 0.0f);
+		_out[1] = glm::vec4((xy - wz) * _scale.y, (1.0f - (xx + zz)) * _scale.y, (yz + wx) * _scale.y, 0.0f);
+		_out[2] = glm::vec4((xz + wy) * _scale.z, (yz - wx) * _scale.z, (1.0f - (xx + yy)) * _scale.z, 0.0f);
+		_out[3] = glm::vec4(_position, 1.0f);
+	}
+
+	// Lanes hold one component of four matrices' column -- Transposed, each lane group is one matrix's column
+	inline void StoreColumn4(Float4 _x, Float4 _y, Float4 _z, Float4 _w, glm::mat4* _out, int _column)
+	{
+		Transpose4(_x, _y, _z, _w);
+		Store4(&_out[0][_column][0], _x);
+		Store4(&_out[1][_column][0], _y);
+		Store4(&_out[2][_column][0], _z);
+		Store4(&_out[3][_column][0], _w);
+	}
+
+	// Four transforms -> four model matrices
+	inline void ComposeModelMatrices4(const glm::vec3* _positions, const glm::quat* _rotations, const glm::vec3* _scales, glm::mat4* _out)
+	{
+		// Quaternions are stored x, y, z, w
+		Float4 qx = Load4(&_rotations[0].x);
+		Float4 qy = Load4(&_rotations[1].x);
+		Float4 qz = Load4(&_rotations[2].x);
+		Float4 qw = Load4(&_rotations[3].x);
+		Transpose4(qx, qy, qz, qw);
+
+		Float4 px, py, pz, sx, sy, sz;
+		LoadVec3x4(&_positions[0].x, px, py, pz);
+		LoadVec3x4(&_scales[0].x, sx, sy, sz);
+
+		Float4 zero = Splat(0.0f);
+		Float4 one = Splat(1.0f);
+		Float4 two = Splat(2.0f);
+
+		Float4 x2 = Mul(qx, two), y2 = Mul(qy, two), z2 = Mul(qz, two);
+		Float4 xx = Mul(qx, x2), yy = Mul(qy, y2), zz = Mul(qz, z2);
+		Float4 xy = Mul(qx, y2), xz = Mul(qx, z2), yz = Mul(qy, z2);
+		Float4 wx = Mul(qw, x2), wy = Mul(qw, y2), wz = Mul(qw, z2);
+
+		StoreColumn4(Mul(Sub(one, Add(yy, zz)), sx), Mul(Add(xy, wz), sx), Mul(Sub(xz, wy), sx), zero, _out, 0);
+		StoreColumn4(Mul(Sub(xy, wz), sy), Mul(Sub(one, Add(xx, zz)), sy), Mul(Add(yz, wx), sy), zero, _out, 1);
+		StoreColumn4(Mul(Add(xz, wy), sz), Mul(Sub(yz, wx), sz), Mul(Sub(one, Add(xx, yy)), sz), zero, _out, 2);
+		StoreColumn4(px, py, pz, one, _out, 3);
+	}
+
+#if defined(SKEL_SIMD_SSE)
+	// Two groups of four, one per 128 bit lane -- Matrices 0-3 land in the low lanes, 4-7 in the high
+	SKEL_SIMD_TARGET_AVX2 inline void StoreColumn8(__m256 _x, __m256 _y, __m256 _z, __m256 _w, glm::mat4* _out, int _column)
+	{
+		__m256 t0 = _mm256_unpacklo_ps(_x, _y);
+		__m256 t1 = _mm256_unpackhi_ps(_x, _y);
+		__m256 t2 = _mm256_unpacklo_ps(_z, _w);
+		__m256 t3 = _mm256_unpackhi_ps(_z, _w);
+		__m256 r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+		__m256 r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+		_mm_storeu_ps(&_out[0][_column][0], _mm256_castps256_ps128(r0));
+		_mm_storeu_ps(&_out[1][_column][0], _mm256_castps256_ps128(r1));
+		_mm_storeu_ps(&_out[2][_column][0], _mm256_castps256_ps128(r2));
+		_mm_storeu_ps(&_out[3][_column][0], _mm256_castps256_ps128(r3));
+		_mm_storeu_ps(&_out[4][_column][0], _mm256_extractf128_ps(r0, 1));
+		_mm_storeu_ps(&_out[5][_column][0], _mm256_extractf128_ps(r1, 1));
+		_mm_storeu_ps(&_out[6][_column][0], _mm256_extractf128_ps(r2, 1));
+		_mm_storeu_ps(&_out[7][_column][0], _mm256_extractf128_ps(r3, 1));
+	}
+
+	// Eight packed vec3s split into x, y, & z lanes
+	SKEL_SIMD_TARGET_AVX2 inline void LoadVec3x8(const float* _p, __m256& _x, __m256& _y, __m256& _z)
+	{
+		__m128 x0, y0, z0, x1, y1, z1;
+		LoadVec3x4(_p, x0, y0, z0);
+		LoadVec3x4(_p + 12, x1, y1, z1);
+		_x = _mm256_insertf128_ps(_mm256_castps128_ps256(x0), x1, 1);
+		_y = _mm256_insertf128_ps(_mm256_castps128_ps256(y0), y1, 1);
+		_z = _mm256_insertf128_ps(_mm256_castps128_ps256(z0), z1, 1);
+	}
+
+	// Eight transforms -> eight model matrices
+	SKEL_SIMD_TARGET_AVX2 inline void ComposeModelMatrices8(const glm::vec3* _positions, const glm::quat* _rotations, const glm::vec3* _scales, glm::mat4* _out)
+	{
+		// Two quaternions per load -- Quaternions 0-3 go to the low lanes, 4-7 to the high
+		__m256 q01 = _mm256_loadu_ps(&_rotations[0].x);
+		__m256 q23 = _mm256_loadu_ps(&_rotations[2].x);
+		__m256 q45 = _mm256_loadu_ps(&_rotations[4].x);
+		__m256 q67 = _mm256_loadu_ps(&_rotations[6].x);
+		__m256 r0 = _mm256_permute2f128_ps(q01, q45, 0x20);	// q0 | q4
+		__m256 r1 = _mm256_permute2f128_ps(q01, q45, 0x31);	// q1 | q5
+		__m256 r2 = _mm256_permute2f128_ps(q23, q67, 0x20);	// q2 | q6
+		__m256 r3 = _mm256_permute2f128_ps(q23, q67, 0x31);	// q3 | q7
+
+		__m256 t0 = _mm256_unpacklo_ps(r0, r1);
+		__m256 t1 = _mm256_unpackhi_ps(r0, r1);
+		__m256 t2 = _mm256_unpacklo_ps(r2, r3);
+		__m256 t3 = _mm256_unpackhi_ps(r2, r3);
+		__m256 qx = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 qy = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+		__m256 qz = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 qw = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+		__m256 px, py, pz, sx, sy, sz;
+		LoadVec3x8(&_positions[0].x, px, py, pz);
+		LoadVec3x8(&_scales[0].x, sx, sy, sz);
+
+		__m256 zero = _mm256_setzero_ps();
+		__m256 one = _mm256_set1_ps(1.0f);
+
+		__m256 x2 = _mm256_add_ps(qx, qx), y2 = _mm256_add_ps(qy, qy), z2 = _mm256_add_ps(qz, qz);
+		__m256 xx = _mm256_mul_ps(qx, x2), yy = _mm256_mul_ps(qy, y2), zz = _mm256_mul_ps(qz, z2);
+		__m256 xy = _mm256_mul_ps(qx, y2), xz = _mm256_mul_ps(qx, z2), yz = _mm256_mul_ps(qy, z2);
+		__m256 wx = _mm256_mul_ps(qw, x2), wy = _mm256_mul_ps(qw, y2), wz = _mm256_mul_ps(qw, z2);
+
+		StoreColumn8(
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx),
+			_mm256_mul_ps(_mm256_add_ps(xy, wz), sx),
+			_mm256_mul_ps(_mm256_sub_ps(xz, wy), sx),
+			zero, _out, 0);
+		StoreColumn8(
+			_mm256_mul_ps(_mm256_sub_ps(xy, wz), sy),
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy),
+			_mm256_mul_ps(_mm256_add_ps(yz, wx), sy),
+			zero, _out, 1);
+		StoreColumn8(
+			_mm256_mul_ps(_mm256_add_ps(xz, wy), sz),
+			_mm256_mul_ps(_mm256_sub_ps(yz, wx), sz),
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz),
+			zero, _out, 2);
+		StoreColumn8(px, py, pz, one, _out, 3);
+	}
+
+	SKEL_SIMD_TARGET_AVX2 inline uint32_t ComposeModelMatricesAvx2(const glm::vec3* _positions, const glm::quat* _rotations, const glm::vec3* _scales, uint32_t _count, glm::mat4* _out)
+	{
+		uint32_t i = 0;
+		for (; i + 8 <= _count; i += 8)
+			ComposeModelMatrices8(_positions + i, _rotations + i, _scales + i, _out + i);
+		return i;
+	}
+#endif
+
+	// Packed arrays of _count positions, unit quaternions, & scales -> _count model matrices
+	inline void ComposeModelMatrices(const glm::vec3* _positions, const glm::quat* _rotations, const glm::vec3* _scales, uint32_t _count, glm::mat4* _out, Path _path = BestPath())
+	{
+		uint32_t i = 0;
+	#if defined(SKEL_SIMD_SSE)
+		if (_path == Path::Avx2)
+			i = ComposeModelMatricesAvx2(_positions, _rotations, _scales, _count, _out);
+	#endif
+		if (_path != Path::Scalar)
+			for (; i + 4 <= _count; i += 4)
+				ComposeModelMatrices4(_positions + i, _rotations + i, _scales + i, _out + i);
+
+		for (; i < _count; i++)
+			ComposeModelMatrix(_positions[i], _rotations[i], _scales[i], _out[i]);
+	}
+
+// ==============================================
+// Matrix products
+// ==============================================
+
+	// _out = _lhs * _rhs, _lhs given as its four columns
+	inline void MultiplyMatrix4(const Float4* _lhs, const glm::mat4& _rhs, float* _out)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			Float4 column = Mul(_lhs[0], Splat(_rhs[j][0]));
+			column = MulAdd(_lhs[1], Splat(_rhs[j][1]), column);
+			column = MulAdd(_lhs[2], Splat(_rhs[j][2]), column);
+			column = MulAdd(_lhs[3], Splat(_rhs[j][3]), column);
+			Store4(_out + j * 4, column);
+		}
+	}
+
+#if defined(SKEL_SIMD_SSE)
+	// Two output columns per instruction -- _lhs's columns are repeated in both lanes
+	SKEL_SIMD_TARGET_AVX2 inline void MultiplyMatricesAvx2(const glm::mat4& _lhs, const glm::mat4* _matrices, uint32_t _count, char* _out, size_t _outStride)
+	{
+		__m256 l0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&_lhs[0][0]));
+		__m256 l1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&_lhs[1][0]));
+		__m256 l2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&_lhs[2][0]));
+		__m256 l3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&_lhs[3][0]));
+
+		for (uint32_t i = 0; i < _count; i++)
+		{
+			const float* rhs = &_matrices[i][0][0];
+			float* out = reinterpret_cast<float*>(_out + i * _outStride);
+			for (int j = 0; j < 4; j += 2)
+			{
+				__m256 columns = _mm256_loadu_ps(rhs + j * 4);
+				__m256 result = _mm256_mul_ps(l0, _mm256_permute_ps(columns, _MM_SHUFFLE(0, 0, 0, 0)));
+				result = _mm256_fmadd_ps(l1, _mm256_permute_ps(columns, _MM_SHUFFLE(1, 1, 1, 1)), result);
+				result = _mm256_fmadd_ps(l2, _mm256_permute_ps(columns, _MM_SHUFFLE(2, 2, 2, 2)), result);
+				result = _mm256_fmadd_ps(l3, _mm256_permute_ps(columns, _MM_SHUFFLE(3, 3, 3, 3)), result);
+				_mm256_storeu_ps(out + j * 4, result);
+			}
+		}
+	}
+#endif
+
+	// _lhs * _matrices[i] for every matrix, written _outStride bytes apart -- Results can land inside larger structs
+	inline void MultiplyMatrices(const glm::mat4& _lhs, const glm::mat4* _matrices, uint32_t _count, void* _out, size_t _outStride = sizeof(glm::mat4), Path _path = BestPath())
+	{
+		char* out = static_cast<char*>(_out);
+
+	#if defined(SKEL_SIMD_SSE)
+		if (_path == Path::Avx2)
+		{
+			MultiplyMatricesAvx2(_lhs, _matrices, _count, out, _outStride);
+			return;
+		}
+	#endif
+
+		if (_path == Path::Scalar)
+		{
+			for (uint32_t i = 0; i < _count; i++)
+			{
+				glm::mat4 result = _lhs * _matrices[i];
+				std::memcpy(out + i * _outStride, &result, sizeof(glm::mat4));
+			}
+			return;
+		}
+
+		Float4 lhs[4] = { Load4(&_lhs[0][0]), Load4(&_lhs[1][0]), Load4(&_lhs[2][0]), Load4(&_lhs[3][0]) };
+		for (uint32_t i = 0; i < _count; i++)
+			MultiplyMatrix4(lhs, _matrices[i], reinterpret_cast<float*>(out + i * _outStride));
+	}
+
+} // namespace simd
+} // namespace skel
@@ -0,0 +1,285 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include "ecs/ecs.h"
+#include "TransformBatch.h"
+#include "Culling.h"
+
+namespace skel
+{
+	// A missing node or parent
+	static const uint32_t noTransformNode = UINT32_MAX;
+
+	// Parent/child transforms kept in pre-order arrays -- A parent always comes before its children,
+	// and a node's subtree is the contiguous range [node, node + subtreeSize)
+	// Only subtrees under a changed node are recomputed, so a frame where nothing moved costs nothing
+	class TransformHierarchy
+	{
+	private:
+		ecs::World* world;
+
+		// Per node, in pre-order
+		std::vector<ecs::Entity> entities;		// Null for nodes removed since the last rebuild
+		std::vector<uint32_t> parents;			// Node index, or noTransformNode for roots
+		std::vector<uint32_t> subtreeSizes;		// Including the node itself
+		std::vector<glm::mat4> localMatrices;
+		std::vector<glm::mat4> worldMatrices;
+		std::vector<uint8_t> dirty;				// Local transform changed since the last update
+
+		// Per entity index
+		std::vector<uint32_t> nodes;				// Node index, or noTransformNode
+		std::vector<ecs::Entity> parentEntities;	// The links the order is rebuilt from
+
+		std::vector<ecs::Entity> dirtyEntities;
+		std::vector<uint32_t> dirtyNodes;
+		bool orderChanged = false;
+
+	public:
+		explicit TransformHierarchy(ecs::World* _world) : world(_world) {}
+
+		// Adds an entity with Position, Rotation, Scale, & LocalToWorld components -- Bounds & WorldBounds are optional
+		void Add(ecs::Entity _entity, ecs::Entity _parent = ecs::Entity())
+		{
+			if (_entity.index >= nodes.size())
+			{
+				nodes.resize(_entity.index + 1, noTransformNode);
+				parentEntities.resize(_entity.index + 1);
+			}
+			if (nodes[_entity.index] != noTransformNode)
+				throw std::runtime_error("Entity is already in the transform hierarchy");
+
+			// A new root at the end keeps the order valid -- Only parenting needs a rebuild
+			nodes[_entity.index] = static_cast<uint32_t>(entities.size());
+			parentEntities[_entity.index] = ecs::Entity();
+			entities.push_back(_entity);
+			parents.push_back(noTransformNode);
+			subtreeSizes.push_back(1);
+			localMatrices.push_back(glm::mat4(1.0f));
+			worldMatrices.push_back(glm::mat4(1.0f));
+			dirty.push_back(0);
+
+			MarkDirty(_entity);
+			if (!_parent.IsNull())
+				SetParent(_entity, _parent);
+		}
+
+		// The entity's children become roots at the next update -- Their local transforms are kept
+		void Remove(ecs::Entity _entity)
+		{
+			if (!Contains(_entity))
+				return;
+
+			// Dropped at the next rebuild
+			uint32_t node = nodes[_entity.index];
+			entities[node] = ecs::Entity();
+			dirty[node] = 0;
+			nodes[_entity.index] = noTransformNode;
+			parentEntities[_entity.index] = ecs::Entity();
+			orderChanged = true;
+		}
+
+		// A null parent makes the entity a root
+		void SetParent(ecs::Entity _entity, ecs::Entity _parent)
+		{
+			if (!Contains(_entity) || (!_parent.IsNull() && !Contains(_parent)))
+				throw std::runtime_error("Transform parent & child must both be in the hierarchy");
+
+			for (ecs::Entity ancestor = _parent; Contains(ancestor); ancestor = parentEntities[ancestor.index])
+				if (ancestor == _entity)
+					throw std::runtime_error("Transform parent would create a cycle");
+
+			parentEntities[_entity.index] = _parent;
+			orderChanged = true;
+			MarkDirty(_entity);
+		}
+
+		// Call after changing the entity's Position, Rotation, or Scale -- Its subtree is recomputed at the next update
+		void MarkDirty(ecs::Entity _entity)
+		{
+			if (!Contains(_entity))
+				return;
+
+			uint32_t node = nodes[_entity.index];
+			if (!dirty[node])
+			{
+				dirty[node] = 1;
+				dirtyEntities.push_back(_entity);
+			}
+		}
+
+		bool Contains(ecs::Entity _entity) const
+		{
+			return _entity.index < nodes.size() && nodes[_entity.index] != noTransformNode && entities[nodes[_entity.index]] == _entity;
+		}
+
+		ecs::Entity GetParent(ecs::Entity _entity) const
+		{
+			return Contains(_entity) ? parentEntities[_entity.index] : ecs::Entity();
+		}
+
+		// As of the last update
+		const glm::mat4& GetWorldMatrix(ecs::Entity _entity) const
+		{
+			return worldMatrices[nodes[_entity.index]];
+		}
+
+		uint32_t NodeCount() const { return static_cast<uint32_t>(entities.size()); }
+
+		// Recomputes the subtree of every dirty node, writing each recomputed entity's LocalToWorld & WorldBounds
+		// Recomputed entities are appended to _changed -- Returns how many there were
+		uint32_t Update(std::vector<ecs::Entity>& _changed)
+		{
+			if (orderChanged)
+				Rebuild();
+			if (dirtyEntities.empty())
+				return 0;
+
+			dirtyNodes.clear();
+			for (const auto& entity : dirtyEntities)
+				if (Contains(entity))
+					dirtyNodes.push_back(nodes[entity.index]);
+			dirtyEntities.clear();
+			std::sort(dirtyNodes.begin(), dirtyNodes.end());
+
+			// A dirty node inside an already recomputed subtree was handled with it
+			uint32_t updated = 0;
+			uint32_t subtreeEnd = 0;
+			for (const auto& node : dirtyNodes)
+			{
+				if (node < subtreeEnd)
+					continue;
+
+				subtreeEnd = node + subtreeSizes[node];
+				for (uint32_t i = node; i < subtreeEnd; i++)
+				{
+					if (entities[i].IsNull())
+						continue;
+					UpdateNode(i);
+					_changed.push_back(entities[i]);
+					updated++;
+				}
+			}
+			return updated;
+		}
+
+	private:
+		void UpdateNode(uint32_t _node)
+		{
+			ecs::Entity entity = entities[_node];
+			if (dirty[_node])
+			{
+				const Position* position = world->Get<Position>(entity);
+				const Rotation* rotation = world->Get<Rotation>(entity);
+				const Scale* scale = world->Get<Scale>(entity);
+				if (position && rotation && scale)
+					simd::ComposeModelMatrix(position->value, rotation->value, scale->value, localMatrices[_node]);
+				dirty[_node] = 0;
+			}
+
+			// The parent was recomputed first, if it changed at all
+			uint32_t parent = parents[_node];
+			worldMatrices[_node] = parent == noTransformNode ? localMatrices[_node] : worldMatrices[parent] * localMatrices[_node];
+
+			LocalToWorld* localToWorld = world->Get<LocalToWorld>(entity);
+			if (localToWorld)
+				localToWorld->model = worldMatrices[_node];
+
+			const Bounds* bounds = world->Get<Bounds>(entity);
+			WorldBounds* worldBounds = world->Get<WorldBounds>(entity);
+			if (bounds && worldBounds)
+				*worldBounds = TransformBounds(*bounds, worldMatrices[_node]);
+		}
+
+		// Re-sorts the nodes into pre-order from the parent links -- Siblings keep their current order
+		void Rebuild()
+		{
+			orderChanged = false;
+			uint32_t count = static_cast<uint32_t>(entities.size());
+
+			// Children of removed nodes become roots
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (entities[i].IsNull())
+					continue;
+				ecs::Entity& parent = parentEntities[entities[i].index];
+				if (!parent.IsNull() && !Contains(parent))
+				{
+					parent = ecs::Entity();
+					MarkDirty(entities[i]);
+				}
+			}
+
+			std::vector<uint32_t> firstChild(count, noTransformNode);
+			std::vector<uint32_t> nextSibling(count, noTransformNode);
+			for (uint32_t i = count; i-- > 0;)
+			{
+				if (entities[i].IsNull())
+					continue;
+				ecs::Entity parent = parentEntities[entities[i].index];
+				if (parent.IsNull())
+					continue;
+				uint32_t parentNode = nodes[parent.index];
+				nextSibling[i] = firstChild[parentNode];
+				firstChild[parentNode] = i;
+			}
+
+			std::vector<uint32_t> order;
+			order.reserve(count);
+			std::vector<uint32_t> stack;
+			for (uint32_t root = 0; root < count; root++)
+			{
+				if (entities[root].IsNull() || !parentEntities[entities[root].index].IsNull())
+					continue;
+
+				stack.push_back(root);
+				while (!stack.empty())
+				{
+					uint32_t node = stack.back();
+					stack.pop_back();
+					order.push_back(node);
+
+					// Pushed in reverse so the first child is visited first
+					size_t firstPushed = stack.size();
+					for (uint32_t child = firstChild[node]; child != noTransformNode; child = nextSibling[child])
+						stack.push_back(child);
+					std::reverse(stack.begin() + firstPushed, stack.end());
+				}
+			}
+
+			Permute(entities, order);
+			Permute(localMatrices, order);
+			Permute(worldMatrices, order);
+			Permute(dirty, order);
+
+			// A parent's new index is already set when its children are reached
+			parents.assign(order.size(), noTransformNode);
+			subtreeSizes.assign(order.size(), 1);
+			for (uint32_t i = 0; i < static_cast<uint32_t>(order.size()); i++)
+			{
+				nodes[entities[i].index] = i;
+				ecs::Entity parent = parentEntities[entities[i].index];
+				if (!parent.IsNull())
+					parents[i] = nodes[parent.index];
+			}
+
+			// Children come after their parent, so sizes accumulate back to front
+			for (uint32_t i = static_cast<uint32_t>(order.size()); i-- > 0;)
+				if (parents[i] != noTransformNode)
+					subtreeSizes[parents[i]] += subtreeSizes[i];
+		}
+
+		template<typename T>
+		static void Permute(std::vector<T>& _values, const std::vector<uint32_t>& _order)
+		{
+			std::vector<T> sorted;
+			sorted.reserve(_order.size());
+			for (const auto& index : _order)
+				sorted.push_back(_values[index]);
+			_values.swap(sorted);
+		}
+	}; // TransformHierarchy
+
+} // namespace skel
@@ -2,9 +2,12 @@
 
 #include <iostream>
 #include <vector>
+#include <cstring>
 
 #include <vulkan/vulkan.h>
 
+#include "Timeline.h"
+
 struct VulkanDevice
 {
 // ==============================================
@@ -13,9 +16,13 @@ struct VulkanDevice
 	VkPhysicalDevice physicalDevice;
 	VkDevice logicalDevice;
 	VkPhysicalDeviceProperties properties;
+	VkPhysicalDeviceVulkan12Properties properties12;
 	VkPhysicalDeviceFeatures features;
+	VkPhysicalDeviceVulkan12Features features12;
 	VkPhysicalDeviceFeatures enabledFeatures;
+	VkPhysicalDeviceVulkan12Features enabledFeatures12;
 	std::vector<const char*> enabledExtensions;
+	bool presentWaitEnabled = false;	// VK_KHR_present_id & VK_KHR_present_wait
 	std::vector<VkQueueFamilyProperties> queueProperties;
 	std::vector<VkExtensionProperties> extensionProperties;
 
@@ -27,10 +34,20 @@ struct VulkanDevice
 		uint32_t graphics;
 		uint32_t transfer;
 		uint32_t present;
+		uint32_t compute;
 	} queueFamilyIndices;
 	VkQueue graphicsQueue;
 	VkQueue transferQueue;
 	VkQueue presentQueue;
+	VkQueue computeQueue;
+	// The compute family differs from the graphics family -- Its work can overlap rendering
+	bool asyncComputeEnabled = false;
+
+	// Signaled by every submission -- Resources are reclaimed by comparing against its completed value
+	skel::GpuTimeline timeline;
+	skel::DeletionQueue deletionQueue;
+	// Signaled by compute queue submissions only -- Sharing the main timeline would serialize them with rendering
+	skel::GpuTimeline computeTimeline;
 
 // ==============================================
 // Initialization
@@ -43,6 +60,24 @@ struct VulkanDevice
 		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
 		vkGetPhysicalDeviceFeatures(physicalDevice, &features);
 		enabledFeatures = {};
+
+		// Vulkan 1.2 properties & features (descriptor indexing, etc.)
+		properties12 = {};
+		properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+		VkPhysicalDeviceProperties2 properties2 = {};
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties2.pNext = &properties12;
+		vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+		features12 = {};
+		features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		VkPhysicalDeviceFeatures2 features2 = {};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &features12;
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+		enabledFeatures12 = {};
+		enabledFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
 		std::cout << properties.deviceName << std::endl;
 
 		uint32_t queuesCount;
@@ -65,20 +100,54 @@ struct VulkanDevice
 		createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
 		enabledFeatures.samplerAnisotropy = VK_TRUE;
+		// Occlusion culling draws every run of a mesh with one indirect call when it can
+		enabledFeatures.multiDrawIndirect = features.multiDrawIndirect;
 		createInfo.pEnabledFeatures = &enabledFeatures;
 
-		// Define the queues to create
-		uint32_t i = 0;
+		// Bindless textures
+		enabledFeatures12.runtimeDescriptorArray = VK_TRUE;
+		enabledFeatures12.descriptorBindingPartiallyBound = VK_TRUE;
+		enabledFeatures12.descriptorBindingVariableDescriptorCount = VK_TRUE;
+		enabledFeatures12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+		enabledFeatures12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+		// GPU timeline
+		enabledFeatures12.timelineSemaphore = VK_TRUE;
+		createInfo.pNext = &enabledFeatures12;
+
+#if defined(VK_KHR_present_wait) && defined(VK_KHR_present_id)
+		// Frame pacing
+		VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {};
+		presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+		presentIdFeatures.presentId = VK_TRUE;
+		VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {};
+		presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+		presentWaitFeatures.presentWait = VK_TRUE;
+		if (presentWaitEnabled)
+		{
+			presentIdFeatures.pNext = &presentWaitFeatures;
+			enabledFeatures12.pNext = &presentIdFeatures;
+		}
+#endif
+
+		// Define the queues to create -- One per distinct family
 		const float priority = 1.0f;
-		const uint32_t queueIndices[] = { queueFamilyIndices.graphics, queueFamilyIndices.transfer, queueFamilyIndices.present };
-		std::printf("graphics: %d, transfer: %d, presentation: %d\n", queueFamilyIndices.graphics, queueFamilyIndices.transfer, queueFamilyIndices.present);
-		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos(3);
-		for (auto& ci : queueCreateInfos)
+		const uint32_t queueIndices[] = { queueFamilyIndices.graphics, queueFamilyIndices.transfer, queueFamilyIndices.present, queueFamilyIndices.compute };
+		std::printf("graphics: %d, transfer: %d, presentation: %d, compute: %d\n", queueFamilyIndices.graphics, queueFamilyIndices.transfer, queueFamilyIndices.present, queueFamilyIndices.compute);
+		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+		for (const auto& index : queueIndices)
 		{
+			bool duplicate = false;
+			for (const auto& ci : queueCreateInfos)
+				duplicate |= ci.queueFamilyIndex == index;
+			if (duplicate)
+				continue;
+
+			VkDeviceQueueCreateInfo ci = {};
 			ci.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 			ci.pQueuePriorities = &priority;
 			ci.queueCount = 1;
-			ci.queueFamilyIndex = queueIndices[i++];
+			ci.queueFamilyIndex = index;
+			queueCreateInfos.push_back(ci);
 		}
 		createInfo.queueCreateInfoCount = (uint32_t)queueCreateInfos.size();
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
@@ -89,8 +158,13 @@ struct VulkanDevice
 		vkGetDeviceQueue(logicalDevice, queueFamilyIndices.graphics, 0, &graphicsQueue);
 		vkGetDeviceQueue(logicalDevice, queueFamilyIndices.transfer, 0, &transferQueue);
 		vkGetDeviceQueue(logicalDevice, queueFamilyIndices.present, 0, &presentQueue);
+		vkGetDeviceQueue(logicalDevice, queueFamilyIndices.compute, 0, &computeQueue);
+		asyncComputeEnabled = queueFamilyIndices.compute != queueFamilyIndices.graphics;
 
 		transientPoolIndex = CreateCommandPool(queueFamilyIndices.transfer, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+		timeline.Create(logicalDevice);
+		computeTimeline.Create(logicalDevice);
 	}
 
 // ==============================================
@@ -100,6 +174,10 @@ struct VulkanDevice
 	// Destroys this logical device & its command pools
 	void Cleanup()
 	{
+		deletionQueue.Flush();
+		timeline.Cleanup(logicalDevice);
+		computeTimeline.Cleanup(logicalDevice);
+
 		for (const auto& pool : commandPools)
 			vkDestroyCommandPool(logicalDevice, pool, nullptr);
 
@@ -115,6 +193,80 @@ struct VulkanDevice
 // Runtime
 // ==============================================
 
+	// Returns true if the Vulkan 1.2 features required for bindless textures are supported
+	static bool SupportsBindless(VkPhysicalDevice _device)
+	{
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(_device, &deviceProperties);
+		if (deviceProperties.apiVersion < VK_API_VERSION_1_2)
+			return false;
+
+		VkPhysicalDeviceVulkan12Features supported12 = {};
+		supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		VkPhysicalDeviceFeatures2 supported = {};
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supported.pNext = &supported12;
+		vkGetPhysicalDeviceFeatures2(_device, &supported);
+
+		return supported12.runtimeDescriptorArray
+			&& supported12.descriptorBindingPartiallyBound
+			&& supported12.descriptorBindingVariableDescriptorCount
+			&& supported12.descriptorBindingSampledImageUpdateAfterBind
+			&& supported12.shaderSampledImageArrayNonUniformIndexing;
+	}
+
+	// Returns true if timeline semaphores (Vulkan 1.2) are supported
+	static bool SupportsTimelineSemaphore(VkPhysicalDevice _device)
+	{
+		VkPhysicalDeviceVulkan12Features supported12 = {};
+		supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		VkPhysicalDeviceFeatures2 supported = {};
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supported.pNext = &supported12;
+		vkGetPhysicalDeviceFeatures2(_device, &supported);
+
+		return supported12.timelineSemaphore;
+	}
+
+	// Destroys everything the GPU has finished with
+	void CollectGarbage()
+	{
+		deletionQueue.Collect(timeline.CompletedValue(logicalDevice));
+	}
+
+	// Returns true if the device exposes the named extension
+	bool HasExtension(const char* _name)
+	{
+		for (const auto& extension : extensionProperties)
+			if (std::strcmp(extension.extensionName, _name) == 0)
+				return true;
+		return false;
+	}
+
+	// Returns true if VK_KHR_present_id & VK_KHR_present_wait can be enabled
+	// Always false when the Vulkan headers predate the extensions
+	bool SupportsPresentWait()
+	{
+#if defined(VK_KHR_present_wait) && defined(VK_KHR_present_id)
+		if (!HasExtension(VK_KHR_PRESENT_ID_EXTENSION_NAME) || !HasExtension(VK_KHR_PRESENT_WAIT_EXTENSION_NAME))
+			return false;
+
+		VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {};
+		presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+		VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {};
+		presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+		presentIdFeatures.pNext = &presentWaitFeatures;
+		VkPhysicalDeviceFeatures2 supported = {};
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supported.pNext = &presentIdFeatures;
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &supported);
+
+		return presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+#else
+		return false;
+#endif
+	}
+
 	// Returns the index of the first queue family that meets the input requirements
 	int FindQueueFamilyIndex(VkQueueFlagBits _flag)
 	{
@@ -123,7 +275,7 @@ struct VulkanDevice
 		{
 			if (_flag & queueProperties[i].queueFlags)
 			{
-				if (_flag == VK_QUEUE_TRANSFER_BIT)
+				if (_flag == VK_QUEUE_TRANSFER_BIT || _flag == VK_QUEUE_COMPUTE_BIT)
 				{
 					if ((queueProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0)
 						return i;
@@ -157,7 +309,8 @@ struct VulkanDevice
 	}
 
 	// Creates a buffer of the given properties, and allocates and binds its memory
-	void CreateBuffer(VkDeviceSize _bufferSize, VkBufferUsageFlags _bufferUsage, VkMemoryPropertyFlags _memoryProperties, VkBuffer& _buffer, VkDeviceMemory& _memory)
+	// Buffers shared with compute are concurrent across the graphics & compute families -- No ownership transfers needed
+	void CreateBuffer(VkDeviceSize _bufferSize, VkBufferUsageFlags _bufferUsage, VkMemoryPropertyFlags _memoryProperties, VkBuffer& _buffer, VkDeviceMemory& _memory, bool _sharedWithCompute = false)
 	{
 		VkBufferCreateInfo bufferInfo = {};
 		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -165,6 +318,14 @@ struct VulkanDevice
 		bufferInfo.usage = _bufferUsage;
 		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+		uint32_t sharedFamilies[] = { queueFamilyIndices.graphics, queueFamilyIndices.compute };
+		if (_sharedWithCompute && asyncComputeEnabled)
+		{
+			bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			bufferInfo.queueFamilyIndexCount = 2;
+			bufferInfo.pQueueFamilyIndices = sharedFamilies;
+		}
+
 		if (vkCreateBuffer(logicalDevice, &bufferInfo, nullptr, &_buffer) != VK_SUCCESS)
 			throw std::runtime_error("Failed to create buffer");
 
@@ -197,7 +358,8 @@ struct VulkanDevice
 		throw std::runtime_error("Failed to find suitable memory type");
 	}
 
-	void CopyBuffer(VkBuffer _src, VkBuffer _dst, VkDeviceSize _size)
+	// Returns the timeline value that signals the copy's completion
+	uint64_t CopyBuffer(VkBuffer _src, VkBuffer _dst, VkDeviceSize _size)
 	{
 		VkCommandBuffer commandBuffer = BeginSingleTimeCommands(transientPoolIndex);
 
@@ -207,7 +369,7 @@ struct VulkanDevice
 		copyRegion.size = _size;
 		vkCmdCopyBuffer(commandBuffer, _src, _dst, 1, &copyRegion);
 
-		EndSingleTimeCommands(commandBuffer, transientPoolIndex, transferQueue);
+		return SubmitSingleTimeCommands(commandBuffer, transientPoolIndex, transferQueue);
 	}
 
 	// Maps buffer memory and copies input data to it
@@ -240,8 +402,9 @@ struct VulkanDevice
 		return commandBuffer;
 	}
 
-	// Finish recording and execute a single use command
-	void EndSingleTimeCommands(VkCommandBuffer& _commandBuffer, uint32_t _poolIndex, VkQueue _queue)
+	// Finish recording and submit a single use command without waiting for it
+	// Returns the timeline value that signals its completion -- The command buffer is freed after it
+	uint64_t SubmitSingleTimeCommands(VkCommandBuffer _commandBuffer, uint32_t _poolIndex, VkQueue _queue)
 	{
 		// Finish recording commands
 		vkEndCommandBuffer(_commandBuffer);
@@ -252,16 +415,29 @@ struct VulkanDevice
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &_commandBuffer;
 
-// TODO : Use transfer queue & a fence (not queueWaitIdle)
-		vkQueueSubmit(_queue, 1, &submitInfo, VK_NULL_HANDLE);
-		vkQueueWaitIdle(_queue);
+		uint64_t value = timeline.Submit(_queue, submitInfo);
+
 		// Destroy command
-		vkFreeCommandBuffers(logicalDevice, commandPools[_poolIndex], 1, &_commandBuffer);
+		VkDevice device = logicalDevice;
+		VkCommandPool pool = commandPools[_poolIndex];
+		deletionQueue.Push(value, [device, pool, _commandBuffer]() {
+			VkCommandBuffer commandBuffer = _commandBuffer;
+			vkFreeCommandBuffers(device, pool, 1, &commandBuffer);
+		});
+
+		return value;
+	}
+
+	// Finish recording and execute a single use command -- Blocks until it completes
+	void EndSingleTimeCommands(VkCommandBuffer& _commandBuffer, uint32_t _poolIndex, VkQueue _queue)
+	{
+		timeline.Wait(logicalDevice, SubmitSingleTimeCommands(_commandBuffer, _poolIndex, _queue));
 	}
 
 	// Creates a buffer in GPU memory for the input data
 	// Copies the input data into the buffer with a staging buffer
-	void CreateAndFillBuffer(const void* _data, VkDeviceSize _size, VkBuffer& _buffer, VkDeviceMemory& _memory, VkBufferUsageFlags _usage, VkMemoryPropertyFlags _memProps)
+	// Returns the timeline value that signals the copy's completion
+	uint64_t CreateAndFillBuffer(const void* _data, VkDeviceSize _size, VkBuffer& _buffer, VkDeviceMemory& _memory, VkBufferUsageFlags _usage, VkMemoryPropertyFlags _memProps)
 	{
 		VkBuffer stagingBuffer;
 		VkDeviceMemory stagingBufferMemory;
@@ -283,10 +459,21 @@ struct VulkanDevice
 			_memory
 		);
 
-		CopyBuffer(stagingBuffer, _buffer, _size);
+		uint64_t copied = CopyBuffer(stagingBuffer, _buffer, _size);
+
+		// The copy is still in flight -- Free the staging buffer once it completes
+		DestroyBufferAfter(copied, stagingBuffer, stagingBufferMemory);
+		return copied;
+	}
 
-		vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
-		vkFreeMemory(logicalDevice, stagingBufferMemory, nullptr);
+	// Destroys a buffer once the timeline reaches _value
+	void DestroyBufferAfter(uint64_t _value, VkBuffer _buffer, VkDeviceMemory _memory)
+	{
+		VkDevice device = logicalDevice;
+		deletionQueue.Push(_value, [device, _buffer, _memory]() {
+			vkDestroyBuffer(device, _buffer, nullptr);
+			vkFreeMemory(device, _memory, nullptr);
+		});
 	}
 
 };
@@ -1,8 +1,23 @@
 #pragma once
 
+#include <vector>
+#include <memory>
+#include <tuple>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <unordered_map>
+#include <type_traits>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <vulkan/vulkan.h>
 
+#include "../JobSystem.h"
+
 enum ComponentTypes
 {
 	SKEL_COMPONENT_BUFFER = 0,
@@ -17,7 +32,7 @@ struct ECSComponent
 template<typename T>
 struct BaseComponent : public ECSComponent
 {
-	
+
 };
 
 struct BufferComponent : public BaseComponent<BufferComponent>
@@ -34,3 +49,524 @@ struct TextureComponent : public BaseComponent<TextureComponent>
 	VkSampler sampler;
 };
 
+struct Mesh;
+
+namespace skel
+{
+// ==============================================
+// Render components
+// ==============================================
+
+	// The transform is stored as three components, so each chunk holds packed arrays the batch kernels read directly
+	// See skel::simd::ComposeModelMatrices
+	struct Position {
+		glm::vec3 value = { 0.0f, 0.0f, 0.0f };
+	};
+
+	// Unit quaternion -- Built once from Euler angles, never per frame
+	struct Rotation {
+		glm::quat value = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	};
+
+	struct Scale {
+		glm::vec3 value = { 1.0f, 1.0f, 1.0f };
+	};
+
+	static_assert(sizeof(Position) == sizeof(glm::vec3) && sizeof(Rotation) == sizeof(glm::quat) && sizeof(Scale) == sizeof(glm::vec3),
+		"Transform components must pack into plain arrays");
+
+	// The model matrix built from Position, Rotation, & Scale
+	struct LocalToWorld {
+		glm::mat4 model = glm::mat4(1.0f);
+	};
+
+	// Not owned -- The mesh outlives every entity that draws it
+	struct MeshRef {
+		Mesh* mesh = nullptr;
+	};
+
+	// Which pipeline draws the entity, and what it reads
+	struct Material {
+		uint32_t shaderType = 0;		// skel::ShaderTypes
+		uint32_t materialIndex = 0;		// Into the bindless material buffer
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;	// Per-object set (set 1), if the shader has one
+	};
+
+	// Object-space bounding box, and the sphere around its center
+	struct Bounds {
+		glm::vec3 min = { 0.0f, 0.0f, 0.0f };
+		glm::vec3 max = { 0.0f, 0.0f, 0.0f };
+		float radius = 0.0f;
+	};
+
+	// Bounds in world space, written with LocalToWorld -- Two vec4s so culling loads them four or eight at a time
+	struct WorldBounds {
+		glm::vec4 sphere = { 0.0f, 0.0f, 0.0f, 0.0f };	// Center xyz, radius w
+		glm::vec4 extents = { 0.0f, 0.0f, 0.0f, 0.0f };	// Half size of the world-axis box around the same center
+	};
+
+	// Tag -- The entity rarely moves, so the scene keeps it in a BVH instead of culling it one by one
+	struct Static {};
+
+	// Tag -- The entity's mesh is drawn into the CPU occlusion buffer, hiding what is behind it
+	// Meant for a few large, simple meshes (walls, terrain, buildings)
+	struct Occluder {};
+
+	// Written by culling, read when draws are recorded
+	struct Visibility {
+		uint32_t visible = 1;
+	};
+
+namespace ecs
+{
+// ==============================================
+// Entities & components
+// ==============================================
+
+	// An index into the world's records -- The generation tells a reused index from the entity that held it
+	struct Entity
+	{
+		uint32_t index = UINT32_MAX;
+		uint32_t generation = 0;
+
+		bool operator==(const Entity& _other) const { return index == _other.index && generation == _other.generation; }
+		bool operator!=(const Entity& _other) const { return !(*this == _other); }
+		bool IsNull() const { return index == UINT32_MAX; }
+	};
+
+	// A component's bit in an archetype signature -- At most 64 component types
+	static const uint32_t maxComponentTypes = 64;
+	typedef uint64_t Signature;
+
+	struct ComponentInfo
+	{
+		uint32_t size;
+		uint32_t alignment;
+	};
+
+	inline std::vector<ComponentInfo>& ComponentInfos()
+	{
+		static std::vector<ComponentInfo> infos;
+		return infos;
+	}
+
+	inline uint32_t RegisterComponent(uint32_t _size, uint32_t _alignment)
+	{
+		std::vector<ComponentInfo>& infos = ComponentInfos();
+		if (infos.size() >= maxComponentTypes)
+			throw std::runtime_error("Too many ECS component types");
+
+		infos.push_back({ _size, _alignment });
+		return static_cast<uint32_t>(infos.size()) - 1;
+	}
+
+	// Ids are handed out on first use -- Register components before iterating from several threads
+	// Components are moved with memcpy, so they must be trivially copyable
+	template<typename T>
+	inline uint32_t ComponentId()
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "ECS components must be trivially copyable");
+		static const uint32_t id = RegisterComponent(static_cast<uint32_t>(sizeof(T)), static_cast<uint32_t>(alignof(T)));
+		return id;
+	}
+
+	template<typename... Ts>
+	inline Signature SignatureOf()
+	{
+		Signature signature = 0;
+		int expand[] = { 0, (signature |= (Signature(1) << ComponentId<Ts>()), 0)... };
+		(void)expand;
+		return signature;
+	}
+
+// ==============================================
+// Threading
+// ==============================================
+
+	// _function(i) for i in [0, _count) on the job system's threads -- Runs on the calling thread below 2 * _minPerThread
+	// Ranges are split and stolen by idle workers, so uneven items balance themselves
+	template<typename F>
+	inline void ParallelFor(uint32_t _count, F&& _function, uint32_t _minPerThread = 4)
+	{
+		jobs::ParallelFor(_count, std::forward<F>(_function), _minPerThread);
+	}
+
+// ==============================================
+// Storage
+// ==============================================
+
+	// A fixed block holding every component of up to `capacity` entities, one array per component (SoA)
+	struct Chunk
+	{
+		static const uint32_t size = 16 * 1024;
+		static const uint32_t alignment = 64;	// Cache line -- Every array starts on one
+
+		std::unique_ptr<uint8_t[]> storage;
+		uint8_t* data;
+		uint32_t count = 0;
+
+		Chunk() : storage(new uint8_t[size + alignment])
+		{
+			uintptr_t address = reinterpret_cast<uintptr_t>(storage.get());
+			data = reinterpret_cast<uint8_t*>((address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+		}
+	};
+
+	// Every entity with exactly one set of components
+	// Chunks stay dense -- Only the last one has free rows
+	struct Archetype
+	{
+		Signature signature;
+		std::vector<uint32_t> components;	// Ids, ascending
+		uint32_t offsets[maxComponentTypes];	// Array offset within a chunk, by component id
+		uint32_t entityOffset = 0;
+		uint32_t capacity = 0;				// Entities per chunk
+		uint32_t entityCount = 0;
+		std::vector<std::unique_ptr<Chunk>> chunks;
+
+		explicit Archetype(Signature _signature) : signature(_signature)
+		{
+			const std::vector<ComponentInfo>& infos = ComponentInfos();
+
+			uint32_t rowSize = sizeof(Entity);
+			for (uint32_t id = 0; id < maxComponentTypes; id++)
+			{
+				offsets[id] = UINT32_MAX;
+				if (signature & (Signature(1) << id))
+				{
+					components.push_back(id);
+					rowSize += infos[id].size;
+				}
+			}
+
+			// Room for each array to be padded up to a cache line
+			uint32_t padding = static_cast<uint32_t>(components.size() + 1) * Chunk::alignment;
+			capacity = (Chunk::size - padding) / rowSize;
+			if (capacity == 0)
+				throw std::runtime_error("ECS components are too large for a chunk");
+
+			uint32_t offset = 0;
+			entityOffset = offset;
+			offset += capacity * sizeof(Entity);
+			for (const auto& id : components)
+			{
+				offset = (offset + Chunk::alignment - 1) & ~(Chunk::alignment - 1);
+				offsets[id] = offset;
+				offset += capacity * infos[id].size;
+			}
+		}
+
+		bool Has(uint32_t _id) const { return offsets[_id] != UINT32_MAX; }
+
+		Entity* Entities(Chunk* _chunk) const { return reinterpret_cast<Entity*>(_chunk->data + entityOffset); }
+
+		uint8_t* Component(Chunk* _chunk, uint32_t _id, uint32_t _row) const
+		{
+			return _chunk->data + offsets[_id] + _row * ComponentInfos()[_id].size;
+		}
+	};
+
+	// Iteration over one chunk -- Arrays of `count` entities and components, in the order requested
+	template<typename... Ts>
+	struct ChunkView
+	{
+		Entity* entities;
+		uint32_t count;
+		std::tuple<Ts*...> arrays;
+
+		template<typename T>
+		T* Get() const { return std::get<T*>(arrays); }
+	};
+
+// ==============================================
+// World
+// ==============================================
+
+	// Owns every entity and its components, grouped by archetype
+	// Creating, destroying, or changing an entity's components while iterating is not allowed
+	class World
+	{
+	private:
+		struct Record
+		{
+			Archetype* archetype = nullptr;
+			uint32_t chunk = 0;
+			uint32_t row = 0;
+			uint32_t generation = 0;
+		};
+
+		// Matching archetypes for a set of required components -- Extended as archetypes are created
+		struct Query
+		{
+			std::vector<Archetype*> archetypes;
+			size_t archetypesSeen = 0;
+		};
+
+		std::vector<std::unique_ptr<Archetype>> archetypes;
+		std::unordered_map<Signature, Archetype*> archetypeLookup;
+		std::unordered_map<Signature, Query> queries;
+
+		std::vector<Record> records;
+		std::vector<uint32_t> freeIndices;
+		uint32_t aliveCount = 0;
+
+	public:
+		World() = default;
+		World(const World&) = delete;
+		World& operator=(const World&) = delete;
+
+		// Entities & components
+		// ==========================================
+
+		template<typename... Ts>
+		Entity Create(const Ts&... _components)
+		{
+			Entity entity = AllocateEntity();
+			Record& record = records[entity.index];
+			Place(entity, GetArchetype(SignatureOf<Ts...>()));
+
+			int expand[] = { 0, (Write(record, _components), 0)... };
+			(void)expand;
+			return entity;
+		}
+
+		void Destroy(Entity _entity)
+		{
+			if (!IsAlive(_entity))
+				return;
+
+			Record& record = records[_entity.index];
+			RemoveRow(record.archetype, record.chunk, record.row);
+			record.archetype = nullptr;
+			record.generation++;
+			freeIndices.push_back(_entity.index);
+			aliveCount--;
+		}
+
+		bool IsAlive(Entity _entity) const
+		{
+			return _entity.index < records.size()
+				&& records[_entity.index].generation == _entity.generation
+				&& records[_entity.index].archetype != nullptr;
+		}
+
+		template<typename T>
+		bool Has(Entity _entity) const
+		{
+			return IsAlive(_entity) && records[_entity.index].archetype->Has(ComponentId<T>());
+		}
+
+		// nullptr if the entity doesn't have the component -- Valid until the entity's components change
+		template<typename T>
+		T* Get(Entity _entity)
+		{
+			if (!Has<T>(_entity))
+				return nullptr;
+
+			const Record& record = records[_entity.index];
+			return reinterpret_cast<T*>(record.archetype->Component(record.archetype->chunks[record.chunk].get(), ComponentId<T>(), record.row));
+		}
+
+		// Moves the entity to the archetype with the component -- Overwrites it if already present
+		template<typename T>
+		void Add(Entity _entity, const T& _component)
+		{
+			if (!IsAlive(_entity))
+				return;
+
+			Record& record = records[_entity.index];
+			if (!record.archetype->Has(ComponentId<T>()))
+				Move(_entity, GetArchetype(record.archetype->signature | SignatureOf<T>()));
+			Write(record, _component);
+		}
+
+		template<typename T>
+		void Remove(Entity _entity)
+		{
+			if (!Has<T>(_entity))
+				return;
+
+			Move(_entity, GetArchetype(records[_entity.index].archetype->signature & ~SignatureOf<T>()));
+		}
+
+		uint32_t EntityCount() const { return aliveCount; }
+		// Every entity's index is below this -- Indices are reused, so it only grows to the peak entity count
+		uint32_t IndexCapacity() const { return static_cast<uint32_t>(records.size()); }
+
+		// Queries
+		// ==========================================
+
+		// _function(ChunkView<Ts...>&) for every non-empty chunk with all of Ts
+		template<typename... Ts, typename F>
+		void ForEachChunk(F&& _function)
+		{
+			const Query& query = GetQuery(SignatureOf<Ts...>());
+			for (const auto& archetype : query.archetypes)
+			{
+				for (const auto& chunk : archetype->chunks)
+				{
+					if (chunk->count == 0)
+						continue;
+					ChunkView<Ts...> view = MakeView<Ts...>(archetype, chunk.get());
+					_function(view);
+				}
+			}
+		}
+
+		// _function(Ts&...) for every entity with all of Ts
+		template<typename... Ts, typename F>
+		void Each(F&& _function)
+		{
+			ForEachChunk<Ts...>([&](ChunkView<Ts...>& _view) {
+				for (uint32_t i = 0; i < _view.count; i++)
+					_function(_view.template Get<Ts>()[i]...);
+			});
+		}
+
+		// Every non-empty chunk with all of Ts, in ForEachChunk's order
+		template<typename... Ts>
+		std::vector<ChunkView<Ts...>> GetChunks()
+		{
+			std::vector<ChunkView<Ts...>> views;
+			const Query& query = GetQuery(SignatureOf<Ts...>());
+			for (const auto& archetype : query.archetypes)
+				for (const auto& chunk : archetype->chunks)
+					if (chunk->count > 0)
+						views.push_back(MakeView<Ts...>(archetype, chunk.get()));
+			return views;
+		}
+
+		// ForEachChunk spread across threads -- _function must only touch its own chunk
+		// Small queries run on the calling thread
+		template<typename... Ts, typename F>
+		void ParallelForEachChunk(F&& _function, uint32_t _minChunksPerThread = 4)
+		{
+			std::vector<ChunkView<Ts...>> views = GetChunks<Ts...>();
+			ParallelFor(static_cast<uint32_t>(views.size()), [&](uint32_t _index) { _function(views[_index]); }, _minChunksPerThread);
+		}
+
+		// Entities with all of Ts
+		template<typename... Ts>
+		uint32_t Count()
+		{
+			uint32_t count = 0;
+			for (const auto& archetype : GetQuery(SignatureOf<Ts...>()).archetypes)
+				count += archetype->entityCount;
+			return count;
+		}
+
+	private:
+		// Storage
+		// ==========================================
+
+		Entity AllocateEntity()
+		{
+			aliveCount++;
+			if (!freeIndices.empty())
+			{
+				uint32_t index = freeIndices.back();
+				freeIndices.pop_back();
+				return { index, records[index].generation };
+			}
+
+			records.push_back(Record());
+			return { static_cast<uint32_t>(records.size()) - 1, 0 };
+		}
+
+		Archetype* GetArchetype(Signature _signature)
+		{
+			auto found = archetypeLookup.find(_signature);
+			if (found != archetypeLookup.end())
+				return found->second;
+
+			archetypes.emplace_back(new Archetype(_signature));
+			archetypeLookup[_signature] = archetypes.back().get();
+			return archetypes.back().get();
+		}
+
+		const Query& GetQuery(Signature _signature)
+		{
+			Query& query = queries[_signature];
+			for (; query.archetypesSeen < archetypes.size(); query.archetypesSeen++)
+			{
+				Archetype* archetype = archetypes[query.archetypesSeen].get();
+				if ((archetype->signature & _signature) == _signature)
+					query.archetypes.push_back(archetype);
+			}
+			return query;
+		}
+
+		// Appends a row for the entity -- Its components are left uninitialized
+		void Place(Entity _entity, Archetype* _archetype)
+		{
+			if (_archetype->chunks.empty() || _archetype->chunks.back()->count == _archetype->capacity)
+				_archetype->chunks.emplace_back(new Chunk());
+
+			Chunk* chunk = _archetype->chunks.back().get();
+			Record& record = records[_entity.index];
+			record.archetype = _archetype;
+			record.chunk = static_cast<uint32_t>(_archetype->chunks.size()) - 1;
+			record.row = chunk->count++;
+			_archetype->Entities(chunk)[record.row] = _entity;
+			_archetype->entityCount++;
+		}
+
+		// Fills the hole with the archetype's last entity, keeping its chunks dense
+		void RemoveRow(Archetype* _archetype, uint32_t _chunk, uint32_t _row)
+		{
+			Chunk* hole = _archetype->chunks[_chunk].get();
+			Chunk* last = _archetype->chunks.back().get();
+			uint32_t lastRow = last->count - 1;
+
+			if (hole != last || _row != lastRow)
+			{
+				Entity moved = _archetype->Entities(last)[lastRow];
+				_archetype->Entities(hole)[_row] = moved;
+				for (const auto& id : _archetype->components)
+					std::memcpy(_archetype->Component(hole, id, _row), _archetype->Component(last, id, lastRow), ComponentInfos()[id].size);
+
+				records[moved.index].chunk = _chunk;
+				records[moved.index].row = _row;
+			}
+
+			last->count--;
+			_archetype->entityCount--;
+			if (last->count == 0)
+				_archetype->chunks.pop_back();
+		}
+
+		// Copies the components both archetypes share -- New ones are left uninitialized
+		void Move(Entity _entity, Archetype* _destination)
+		{
+			Record& record = records[_entity.index];
+			Archetype* source = record.archetype;
+			Chunk* sourceChunk = source->chunks[record.chunk].get();
+			uint32_t sourceChunkIndex = record.chunk;
+			uint32_t sourceRow = record.row;
+
+			Place(_entity, _destination);
+			Chunk* destinationChunk = _destination->chunks[record.chunk].get();
+			for (const auto& id : source->components)
+				if (_destination->Has(id))
+					std::memcpy(_destination->Component(destinationChunk, id, record.row), source->Component(sourceChunk, id, sourceRow), ComponentInfos()[id].size);
+
+			// The record now points at the destination -- Only the entity filling the hole is updated
+			RemoveRow(source, sourceChunkIndex, sourceRow);
+		}
+
+		template<typename T>
+		void Write(const Record& _record, const T& _component)
+		{
+			Chunk* chunk = _record.archetype->chunks[_record.chunk].get();
+			std::memcpy(_record.archetype->Component(chunk, ComponentId<T>(), _record.row), &_component, sizeof(T));
+		}
+
+		template<typename... Ts>
+		ChunkView<Ts...> MakeView(Archetype* _archetype, Chunk* _chunk)
+		{
+			return { _archetype->Entities(_chunk), _chunk->count, std::make_tuple(reinterpret_cast<Ts*>(_chunk->data + _archetype->offsets[ComponentId<Ts>()])...) };
+		}
+	}; // World
+
+} // namespace ecs
+} // namespace skel